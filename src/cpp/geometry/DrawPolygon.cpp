@@ -13,4 +13,37 @@ namespace rir
 		return fillPolygonFunctor(pts, size, f, r);
 	}
 
-}
\ No newline at end of file
+	std::vector<PixelSpan> polygonSpans(const Point *pts, size_t size, const Rect &rect)
+	{
+		// pixels are visited row by row with increasing x inside each filled segment
+		struct Fun
+		{
+			std::vector<PixelSpan> spans;
+			void operator()(signed_integral x, signed_integral y)
+			{
+				if (spans.size() && spans.back().y == y && spans.back().x1 == x)
+					++spans.back().x1;
+				else
+					spans.push_back(PixelSpan{y, x, x + 1});
+			}
+		};
+		Fun f;
+		fillPolygonFunctor(pts, size, f, rect);
+
+		// merge overlapping spans
+		std::vector<PixelSpan> &spans = f.spans;
+		std::sort(spans.begin(), spans.end(), [](const PixelSpan &a, const PixelSpan &b)
+				  { return a.y < b.y || (a.y == b.y && a.x0 < b.x0); });
+		size_t count = 0;
+		for (size_t i = 0; i < spans.size(); ++i)
+		{
+			if (count && spans[count - 1].y == spans[i].y && spans[i].x0 <= spans[count - 1].x1)
+				spans[count - 1].x1 = std::max(spans[count - 1].x1, spans[i].x1);
+			else
+				spans[count++] = spans[i];
+		}
+		spans.resize(count);
+		return std::move(spans);
+	}
+
+}
@@ -426,6 +426,22 @@ namespace rir
 		return fillPolygonFunctor(pts, size, fill, Rect(0, (signed_integral)img.width, 0, (signed_integral)img.height));
 	}
 
+	/**
+	Horizontal run of pixels [x0, x1) on row y
+	*/
+	struct PixelSpan
+	{
+		signed_integral y;
+		signed_integral x0;
+		signed_integral x1;
+	};
+
+	/**
+	Returns the pixels inside given polygon as a list of non overlapping spans sorted by row then column.
+	The spans cover exactly the pixels drawn by drawPolygon() when clipped to \a rect.
+	*/
+	GEOMETRY_EXPORT std::vector<PixelSpan> polygonSpans(const Point *pts, size_t size, const Rect &rect);
+
 	/**
 	Returns the polygon area in pixels.
 	*/
@@ -0,0 +1,255 @@
+#include "PolygonIndex.h"
+#include "SIMD.h"
+
+#include <cmath>
+
+namespace rir
+{
+	static bool pointInPolygon(const PolygonF &poly, double x, double y)
+	{
+		bool inside = false;
+		for (size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++)
+		{
+			const PointF &a = poly[i];
+			const PointF &b = poly[j];
+			if ((a.y() > y) != (b.y() > y) && x < a.x() + (y - a.y()) * (b.x() - a.x()) / (b.y() - a.y()))
+				inside = !inside;
+		}
+		return inside;
+	}
+
+	static int orientation(const PointF &a, const PointF &b, const PointF &c)
+	{
+		const double v = (b.x() - a.x()) * (c.y() - a.y()) - (b.y() - a.y()) * (c.x() - a.x());
+		return v > 0 ? 1 : (v < 0 ? -1 : 0);
+	}
+	static bool onSegment(const PointF &a, const PointF &b, const PointF &p)
+	{
+		return p.x() >= std::min(a.x(), b.x()) && p.x() <= std::max(a.x(), b.x()) &&
+			   p.y() >= std::min(a.y(), b.y()) && p.y() <= std::max(a.y(), b.y());
+	}
+	static bool segmentsIntersect(const PointF &p1, const PointF &p2, const PointF &q1, const PointF &q2)
+	{
+		const int o1 = orientation(p1, p2, q1);
+		const int o2 = orientation(p1, p2, q2);
+		const int o3 = orientation(q1, q2, p1);
+		const int o4 = orientation(q1, q2, p2);
+		if (o1 != o2 && o3 != o4)
+			return true;
+		return (o1 == 0 && onSegment(p1, p2, q1)) || (o2 == 0 && onSegment(p1, p2, q2)) ||
+			   (o3 == 0 && onSegment(q1, q2, p1)) || (o4 == 0 && onSegment(q1, q2, p2));
+	}
+
+	PolygonIndex::PolygonIndex(const std::vector<PolygonF> &polygons)
+		: m_polygons(polygons), m_band_height(1), m_sse2(detectInstructionSet().HW_SSE2)
+	{
+#ifndef __SSE2__
+		m_sse2 = false;
+#endif
+		// remove closing point, edges are implicitly closed
+		size_t valid = 0;
+		double heights = 0;
+		for (size_t i = 0; i < m_polygons.size(); ++i)
+		{
+			if (m_polygons[i].size() > 1)
+				openPolygon(m_polygons[i]);
+			m_rects.push_back(polygonRect(m_polygons[i]));
+			if (m_polygons[i].size() < 3)
+				continue;
+			m_rect = valid == 0 ? m_rects.back() : m_rect.unite(m_rects.back());
+			heights += m_rects.back().height();
+			++valid;
+		}
+		if (valid == 0)
+			return;
+
+		// 2 bands per mean polygon height, so that a band only overlaps the polygons close to it. At most 4096 bands.
+		size_t band_count = 1;
+		const double mean_height = heights / valid;
+		if (m_rect.height() > 0 && mean_height > 0)
+			band_count = (size_t)std::max(1., std::min(4096., std::ceil(2 * m_rect.height() / mean_height)));
+		if (m_rect.height() > 0)
+			m_band_height = m_rect.height() / band_count;
+		m_bands.resize(band_count);
+
+		struct Edge
+		{
+			double y1, y2, x1, slope;
+		};
+		std::vector<Edge> poly_edges;
+		std::vector<std::vector<size_t>> band_edges(band_count);
+		for (size_t p = 0; p < m_polygons.size(); ++p)
+		{
+			const PolygonF &poly = m_polygons[p];
+			if (poly.size() < 3)
+				continue;
+
+			poly_edges.clear();
+			for (size_t b = 0; b < band_count; ++b)
+				band_edges[b].clear();
+
+			for (size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++)
+			{
+				PointF a = poly[j];
+				PointF c = poly[i];
+				if (a.y() == c.y())
+					continue; // horizontal edges never cross the ray
+				if (a.y() > c.y())
+					std::swap(a, c);
+				const size_t e = poly_edges.size();
+				poly_edges.push_back(Edge{a.y(), c.y(), a.x(), (c.x() - a.x()) / (c.y() - a.y())});
+				for (int b = band(a.y()), end = band(c.y()); b <= end; ++b)
+					band_edges[b].push_back(e);
+			}
+
+			// store edges band by band so that each entry is contiguous
+			for (size_t b = 0; b < band_count; ++b)
+			{
+				if (band_edges[b].empty())
+					continue;
+				BandEntry entry;
+				entry.polygon = (int)p;
+				entry.start = m_y1.size();
+				entry.count = band_edges[b].size();
+				for (size_t e : band_edges[b])
+				{
+					m_y1.push_back(poly_edges[e].y1);
+					m_y2.push_back(poly_edges[e].y2);
+					m_x1.push_back(poly_edges[e].x1);
+					m_slope.push_back(poly_edges[e].slope);
+				}
+				m_bands[b].push_back(entry);
+			}
+		}
+	}
+
+	int PolygonIndex::band(double y) const
+	{
+		int b = (int)((y - m_rect.ymin) / m_band_height);
+		if (b < 0)
+			return 0;
+		if (b >= (int)m_bands.size())
+			return (int)m_bands.size() - 1;
+		return b;
+	}
+
+	bool PolygonIndex::contains(const BandEntry &e, double x, double y) const
+	{
+		const RectF &r = m_rects[e.polygon];
+		if (x < r.xmin || x > r.xmax)
+			return false;
+
+		const double *y1 = m_y1.data() + e.start;
+		const double *y2 = m_y2.data() + e.start;
+		const double *x1 = m_x1.data() + e.start;
+		const double *slope = m_slope.data() + e.start;
+		int crossings = 0;
+		size_t i = 0;
+
+		if (m_sse2)
+		{
+#ifdef __SSE2__
+			const __m128d vx = _mm_set1_pd(x);
+			const __m128d vy = _mm_set1_pd(y);
+			for (; i + 2 <= e.count; i += 2)
+			{
+				// y1 <= y < y2 && x < x1 + (y - y1) * slope
+				const __m128d a = _mm_loadu_pd(y1 + i);
+				const __m128d in_y = _mm_and_pd(_mm_cmple_pd(a, vy), _mm_cmplt_pd(vy, _mm_loadu_pd(y2 + i)));
+				const __m128d xe = _mm_add_pd(_mm_loadu_pd(x1 + i), _mm_mul_pd(_mm_sub_pd(vy, a), _mm_loadu_pd(slope + i)));
+				const int mask = _mm_movemask_pd(_mm_and_pd(in_y, _mm_cmplt_pd(vx, xe)));
+				crossings += (mask & 1) + (mask >> 1);
+			}
+#endif
+		}
+		for (; i < e.count; ++i)
+		{
+			if (y1[i] <= y && y < y2[i] && x < x1[i] + (y - y1[i]) * slope[i])
+				++crossings;
+		}
+		return (crossings & 1) != 0;
+	}
+
+	bool PolygonIndex::contains(int polygon, double x, double y) const
+	{
+		if (m_bands.empty() || y < m_rect.ymin || y > m_rect.ymax)
+			return false;
+		const std::vector<BandEntry> &entries = m_bands[band(y)];
+		auto it = std::lower_bound(entries.begin(), entries.end(), polygon, [](const BandEntry &e, int p)
+								   { return e.polygon < p; });
+		if (it == entries.end() || it->polygon != polygon)
+			return false;
+		return contains(*it, x, y);
+	}
+
+	int PolygonIndex::find(double x, double y) const
+	{
+		if (m_bands.empty() || y < m_rect.ymin || y > m_rect.ymax)
+			return -1;
+		for (const BandEntry &e : m_bands[band(y)])
+			if (contains(e, x, y))
+				return e.polygon;
+		return -1;
+	}
+
+	void PolygonIndex::find(const double *xy, size_t count, int *out) const
+	{
+#pragma omp parallel for if (count > 10000)
+		for (std::int64_t i = 0; i < (std::int64_t)count; ++i)
+			out[i] = find(xy[i * 2], xy[i * 2 + 1]);
+	}
+
+	std::vector<int> PolygonIndex::findAll(double x, double y) const
+	{
+		std::vector<int> res;
+		if (m_bands.empty() || y < m_rect.ymin || y > m_rect.ymax)
+			return res;
+		for (const BandEntry &e : m_bands[band(y)])
+			if (contains(e, x, y))
+				res.push_back(e.polygon);
+		return res;
+	}
+
+	std::vector<int> PolygonIndex::overlapping(const PolygonF &_poly) const
+	{
+		std::vector<int> res;
+		PolygonF poly = _poly;
+		if (poly.size() > 1)
+			openPolygon(poly);
+		if (poly.empty())
+			return res;
+		const RectF rect = polygonRect(poly);
+
+		for (int p = 0; p < polygonCount(); ++p)
+		{
+			const PolygonF &other = m_polygons[p];
+			const RectF &r = m_rects[p];
+			if (other.size() < 3 || r.xmax < rect.xmin || r.xmin > rect.xmax || r.ymax < rect.ymin || r.ymin > rect.ymax)
+				continue;
+
+			// one polygon inside the other
+			bool found = contains(p, poly.front().x(), poly.front().y()) ||
+						 (poly.size() > 2 && pointInPolygon(poly, other.front().x(), other.front().y()));
+			// intersecting edges
+			for (size_t i = 0, j = poly.size() - 1; i < poly.size() && !found; j = i++)
+			{
+				const PointF &a = poly[j];
+				const PointF &b = poly[i];
+				if (std::max(a.x(), b.x()) < r.xmin || std::min(a.x(), b.x()) > r.xmax ||
+					std::max(a.y(), b.y()) < r.ymin || std::min(a.y(), b.y()) > r.ymax)
+					continue;
+				for (size_t k = 0, l = other.size() - 1; k < other.size(); l = k++)
+				{
+					if (segmentsIntersect(a, b, other[l], other[k]))
+					{
+						found = true;
+						break;
+					}
+				}
+			}
+			if (found)
+				res.push_back(p);
+		}
+		return res;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Polygon.h"
+
+/** @file
+
+Spatial index over a set of polygons
+*/
+
+namespace rir
+{
+	/**
+	 * Spatial index used for bulk point-in-polygon and polygon overlap queries against a fixed set of polygons
+	 * (typically the regions of a component: tiles, antennas...).
+	 *
+	 * The bounding box of all polygons is split in horizontal bands (2 per mean polygon height), and each band stores, for each polygon,
+	 * the edges crossing it in a structure of arrays. A point query only runs the crossing number test on the edges
+	 * of its band, for the polygons whose bounding box contains the point.
+	 * The crossing number kernel is vectorized with SSE2 when available.
+	 *
+	 * Polygons with less than 3 points are never matched.
+	 * Polygons are considered closed (the last point is connected to the first one), and a point is inside a polygon
+	 * if a horizontal ray starting from it crosses an odd number of edges.
+	 */
+	class GEOMETRY_EXPORT PolygonIndex : public BaseShared
+	{
+	public:
+		PolygonIndex(const std::vector<PolygonF> &polygons);
+		~PolygonIndex() {}
+
+		int polygonCount() const { return (int)m_polygons.size(); }
+		const PolygonF &polygon(int index) const { return m_polygons[index]; }
+
+		/**
+		 * Returns the index of the first polygon containing point (x, y), or -1
+		 */
+		int find(double x, double y) const;
+		/**
+		 * Bulk version of find() for \a count interleaved x,y points
+		 */
+		void find(const double *xy, size_t count, int *out) const;
+		/**
+		 * Returns the indexes of all polygons containing point (x, y)
+		 */
+		std::vector<int> findAll(double x, double y) const;
+		/**
+		 * Returns the indexes of all polygons overlapping \a poly (intersecting edges or one polygon inside the other)
+		 */
+		std::vector<int> overlapping(const PolygonF &poly) const;
+
+	private:
+		// edges of a polygon inside a band
+		struct BandEntry
+		{
+			int polygon;
+			size_t start;
+			size_t count;
+		};
+		int band(double y) const;
+		bool contains(const BandEntry &e, double x, double y) const;
+		bool contains(int polygon, double x, double y) const;
+
+		std::vector<PolygonF> m_polygons;
+		std::vector<RectF> m_rects;
+		RectF m_rect;
+		double m_band_height;
+		bool m_sse2;
+		// entries of each band, sorted by polygon index
+		std::vector<std::vector<BandEntry>> m_bands;
+		// edges as structure of arrays: x = x1 + (y - y1) * slope for y between y1 and y2
+		std::vector<double> m_y1;
+		std::vector<double> m_y2;
+		std::vector<double> m_x1;
+		std::vector<double> m_slope;
+	};
+
+}
@@ -1,6 +1,8 @@
 #include "geometry.h"
 #include "Polygon.h"
 #include "DrawPolygon.h"
+#include "PolygonIndex.h"
+#include "tools.h"
 #include "Log.h"
 
 extern "C"
@@ -283,4 +285,65 @@ int count_pixel_in_polygon(double *xy, int point_count, double *area)
 	double _area = polygonArea(poly);
 	*area = _area;
 	return 0;
-}
\ No newline at end of file
+}
+
+int polygon_index_create(const double *xy, const int *point_counts, int polygon_count)
+{
+	if (polygon_count < 0)
+		return 0;
+	std::vector<PolygonF> polygons(polygon_count);
+	for (int p = 0; p < polygon_count; ++p)
+	{
+		if (point_counts[p] < 0)
+			return 0;
+		polygons[p].resize(point_counts[p]);
+		for (int i = 0; i < point_counts[p]; ++i, xy += 2)
+			polygons[p][i] = PointF(xy[0], xy[1]);
+	}
+	std::shared_ptr<PolygonIndex> index(new PolygonIndex(polygons));
+	return set_void_ptr(index.get());
+}
+
+int polygon_index_count(int handle)
+{
+	PolygonIndex *index = (PolygonIndex *)get_void_ptr(handle);
+	if (!index)
+		return -1;
+	return index->polygonCount();
+}
+
+int polygon_index_find(int handle, const double *xy, int count, int *out)
+{
+	PolygonIndex *index = (PolygonIndex *)get_void_ptr(handle);
+	if (!index || count < 0)
+		return -1;
+	index->find(xy, (size_t)count, out);
+	return 0;
+}
+
+int polygon_index_overlapping(int handle, const double *xy, int point_count, int *out, int *out_count)
+{
+	PolygonIndex *index = (PolygonIndex *)get_void_ptr(handle);
+	if (!index || point_count < 0)
+		return -1;
+	PolygonF poly(point_count);
+	for (int i = 0; i < point_count; ++i)
+		poly[i] = PointF(xy[i * 2], xy[i * 2 + 1]);
+
+	std::vector<int> res = index->overlapping(poly);
+	if (*out_count < (int)res.size())
+	{
+		*out_count = (int)res.size();
+		return -2;
+	}
+	*out_count = (int)res.size();
+	std::copy(res.begin(), res.end(), out);
+	return 0;
+}
+
+void polygon_index_destroy(int handle)
+{
+	PolygonIndex *index = (PolygonIndex *)get_void_ptr(handle);
+	if (index)
+		rm_void_ptr(handle);
+}
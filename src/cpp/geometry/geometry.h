@@ -99,6 +99,34 @@ extern "C"
      */
     GEOMETRY_EXPORT int count_pixel_in_polygon(double *xy, int point_count, double *area);
 
+    /**
+     * Create a spatial index over several polygons, and returns its handle (0 on error).
+     * See PolygonIndex class for more details.
+     * @param xy: interleaved x,y values of all polygons, one after the other
+     * @param point_counts: number of points of each polygon
+     * @param polygon_count: number of polygons
+     */
+    GEOMETRY_EXPORT int polygon_index_create(const double *xy, const int *point_counts, int polygon_count);
+    /**
+     * Returns the number of indexed polygons, or -1 on error.
+     */
+    GEOMETRY_EXPORT int polygon_index_count(int handle);
+    /**
+     * For each of the \a count interleaved x,y points, set in \a out the index of the first polygon containing it, or -1.
+     * Returns 0 on success, -1 on error.
+     */
+    GEOMETRY_EXPORT int polygon_index_find(int handle, const double *xy, int count, int *out);
+    /**
+     * Retrieve the indexes of all polygons overlapping the polygon defined by \a xy and \a point_count.
+     * Returns 0 on success, -1 on error.
+     * Returns -2 if out_count is too small, and set out_count to the right value.
+     */
+    GEOMETRY_EXPORT int polygon_index_overlapping(int handle, const double *xy, int point_count, int *out, int *out_count);
+    /**
+     * Destroy a polygon index based on its handle.
+     */
+    GEOMETRY_EXPORT void polygon_index_destroy(int handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,73 +1,412 @@
 #include "BadPixels.h"
 #include "Filters.h"
+#include "SIMD.h"
 #include <cstring>
+#include <cfloat>
+#include <fstream>
+
+#define BAD_PIXELS_MAGIC "RIRBADPX"
 
 namespace rir
 {
+	namespace detail
+	{
+		struct ScalarSort
+		{
+			template <class T>
+			static RIR_ALWAYS_INLINE void sort(T &a, T &b)
+			{
+				T tmp = std::min(a, b);
+				b = std::max(a, b);
+				a = tmp;
+			}
+		};
+#ifdef __SSE4_1__
+		struct Epu16Sort
+		{
+			static RIR_ALWAYS_INLINE void sort(__m128i &a, __m128i &b)
+			{
+				__m128i tmp = _mm_min_epu16(a, b);
+				b = _mm_max_epu16(a, b);
+				a = tmp;
+			}
+		};
+#endif
+
+		/**
+		Same sorting network as opt_med9, working on scalars or SIMD registers
+		*/
+		template <class Sort, class T>
+		RIR_ALWAYS_INLINE T median9(T *p)
+		{
+			Sort::sort(p[1], p[2]);
+			Sort::sort(p[4], p[5]);
+			Sort::sort(p[7], p[8]);
+			Sort::sort(p[0], p[1]);
+			Sort::sort(p[3], p[4]);
+			Sort::sort(p[6], p[7]);
+			Sort::sort(p[1], p[2]);
+			Sort::sort(p[4], p[5]);
+			Sort::sort(p[7], p[8]);
+			Sort::sort(p[0], p[3]);
+			Sort::sort(p[5], p[8]);
+			Sort::sort(p[4], p[7]);
+			Sort::sort(p[3], p[6]);
+			Sort::sort(p[1], p[4]);
+			Sort::sort(p[2], p[5]);
+			Sort::sort(p[4], p[7]);
+			Sort::sort(p[4], p[2]);
+			Sort::sort(p[6], p[4]);
+			Sort::sort(p[4], p[2]);
+			return p[4];
+		}
+
+		template <class T>
+		RIR_ALWAYS_INLINE T neighborValue(const T *img, int offset, T low, T high)
+		{
+			return offset >= 0 ? img[offset] : (offset == -1 ? low : high);
+		}
+
+		template <class T>
+		static void correctScalar(const int *targets, const int *neighbors, size_t count, const T *in, T *out, T low, T high)
+		{
+			T pixels[9];
+			for (size_t i = 0; i < count; ++i)
+			{
+				const int *n = neighbors + i * 9;
+				for (int j = 0; j < 9; ++j)
+					pixels[j] = neighborValue(in, n[j], low, high);
+				out[targets[i]] = median9<ScalarSort>(pixels);
+			}
+		}
+
+		/**
+		Apply a correction table: each target pixel of \a out is replaced by the median of its 9 table entries read from \a in.
+		When \a in == \a out, the table must not reference other target pixels unless \a sequential is true.
+		*/
+		static void correctTable(const int *targets, const int *neighbors, size_t count, const unsigned short *in, unsigned short *out, bool sequential)
+		{
+			size_t start = 0;
+
+			bool sse41 = !sequential && detectInstructionSet().HW_SSE41;
+#ifndef __SSE4_1__
+			sse41 = false;
+#endif
+			if (sse41)
+			{
+#ifdef __SSE4_1__
+				// 8 bad pixels at a time, one per 16 bits lane
+				alignas(16) unsigned short values[9][8];
+				for (; start + 8 <= count; start += 8)
+				{
+					for (int l = 0; l < 8; ++l)
+					{
+						const int *n = neighbors + (start + l) * 9;
+						for (int j = 0; j < 9; ++j)
+							values[j][l] = neighborValue(in, n[j], (unsigned short)0, (unsigned short)65535);
+					}
+					__m128i v[9];
+					for (int j = 0; j < 9; ++j)
+						v[j] = _mm_load_si128((const __m128i *)values[j]);
+					_mm_store_si128((__m128i *)values[0], median9<Epu16Sort>(v));
+					for (int l = 0; l < 8; ++l)
+						out[targets[start + l]] = values[0][l];
+				}
+#endif
+			}
+			correctScalar(targets + start, neighbors + start * 9, count - start, in, out, (unsigned short)0, (unsigned short)65535);
+		}
+
+		/**
+		Append a table entry for \a target: the \a c offsets of \a neighbors padded to 9 values with low (-1)
+		and high (-2) sentinels so that the median of 9 is the upper median of the neighbors (index c/2 once sorted,
+		as std::nth_element(c/2) would give).
+		*/
+		static void addEntry(std::vector<int> &targets, std::vector<int> &table, int target, const int *neighbors, int c)
+		{
+			const int low = 4 - c / 2;
+			targets.push_back(target);
+			table.insert(table.end(), neighbors, neighbors + c);
+			table.insert(table.end(), low, -1);
+			table.insert(table.end(), 9 - c - low, -2);
+		}
+
+		/**
+		Low value threshold used by BadPixels::correct(): median - 2*std
+		*/
+		template <class T>
+		static int lowValueThreshold(const T *img, int size)
+		{
+			std::vector<T> tmp(img, img + size);
+			std::nth_element(tmp.begin(), tmp.begin() + size / 2, tmp.end());
+			int median = (int)tmp[size / 2];
+
+			double sum = 0;
+			for (int i = 0; i < size; ++i)
+				sum += (img[i] - median) * (img[i] - median);
+			sum /= size;
+			return median - (int)(std::sqrt(sum) * 2);
+		}
+	}
 
 	BadPixels::BadPixels()
-		: m_width(0), m_height(0), m_median_value(-1)
+		: m_width(0), m_height(0), m_median_value(-1), m_inplace_sequential(false)
 	{
 	}
 
 	void BadPixels::init(const unsigned short *first, int width, int height, int std_factor)
+	{
+		m_median_value = detail::lowValueThreshold(first, width * height);
+		setBadPixels(rir::badPixels(first, width, height, std_factor), width, height);
+	}
+
+	void BadPixels::initFromStack(const unsigned short *imgs, int count, int width, int height, double std_factor)
+	{
+		const int size = width * height;
+		if (count <= 1 || size <= 0)
+		{
+			if (count == 1)
+				init(imgs, width, height, (int)std_factor);
+			return;
+		}
+
+		// temporal mean and standard deviation
+		std::vector<double> sum(size, 0.), sum2(size, 0.);
+		for (int i = 0; i < count; ++i)
+		{
+			const unsigned short *img = imgs + (size_t)i * size;
+#pragma omp parallel for
+			for (int j = 0; j < size; ++j)
+			{
+				double v = img[j];
+				sum[j] += v;
+				sum2[j] += v * v;
+			}
+		}
+		std::vector<float> mean(size);
+		std::vector<float> noise(size);
+		for (int j = 0; j < size; ++j)
+		{
+			double m = sum[j] / count;
+			mean[j] = (float)m;
+			noise[j] = (float)std::sqrt(std::max(0., sum2[j] / count - m * m));
+		}
+
+		m_median_value = detail::lowValueThreshold(mean.data(), size);
+
+		// For each pixel, compare with its 5x5 neighborhood:
+		// - spatial outliers of the mean image, using the median absolute deviation as robust spread,
+		// - stuck pixels (no temporal noise while neighbors have some),
+		// - blinking pixels (temporal noise much higher than neighbors).
+		std::vector<char> bad(size, 0);
+		std::vector<float> residuals(size), spreads(size);
+#pragma omp parallel for
+		for (int y = 0; y < height; ++y)
+		{
+			float values[24];
+			float noises[24];
+			for (int x = 0; x < width; ++x)
+			{
+				int c = 0;
+				for (int dy = std::max(0, y - 2); dy <= std::min(height - 1, y + 2); ++dy)
+					for (int dx = std::max(0, x - 2); dx <= std::min(width - 1, x + 2); ++dx)
+						if (dx != x || dy != y)
+						{
+							values[c] = mean[dx + dy * width];
+							noises[c++] = noise[dx + dy * width];
+						}
+				const int i = x + y * width;
+				residuals[i] = spreads[i] = 0;
+				if (c == 0)
+					continue;
+
+				std::nth_element(values, values + c / 2, values + c);
+				const float med = values[c / 2];
+				for (int j = 0; j < c; ++j)
+					values[j] = std::abs(values[j] - med);
+				std::nth_element(values, values + c / 2, values + c);
+				residuals[i] = std::abs(mean[i] - med);
+				spreads[i] = values[c / 2] * 1.4826f;
+
+				std::nth_element(noises, noises + c / 2, noises + c);
+				const float local_noise = noises[c / 2];
+				const float s = noise[i];
+				if ((local_noise > 0 && s * 20 < local_noise) || s > std_factor * std::max(local_noise, 1.f))
+					bad[i] = 1;
+			}
+		}
+
+		// the local spread is estimated on few pixels: do not go below the image wide spread
+		std::vector<float> tmp = residuals;
+		std::nth_element(tmp.begin(), tmp.begin() + size / 2, tmp.end());
+		const float global_spread = std::max(tmp[size / 2] * 1.4826f, 1.f);
+		for (int i = 0; i < size; ++i)
+			if (residuals[i] > std_factor * std::max(spreads[i], global_spread))
+				bad[i] = 1;
+
+		Polygon res;
+		for (int y = 0; y < height; ++y)
+			for (int x = 0; x < width; ++x)
+				if (bad[x + y * width])
+					res.push_back(Point(x, y));
+		setBadPixels(res, width, height);
+	}
+
+	void BadPixels::setBadPixels(const Polygon &bad_pixels, int width, int height)
 	{
 		m_width = width;
 		m_height = height;
-		m_bad_pixels = badPixels(first, width, height, std_factor);
-
-		int size = width * height;
-		std::vector<unsigned short> img(first, first + size);
-		std::sort(img.data(), img.data() + size);
-		m_median_value = img[size / 2];
-
-		// compute std
-		double sum = 0;
-		int c = 0;
-		for (int i = 0; i < size; ++i, ++c)
-			sum += (first[i] - m_median_value) * (first[i] - m_median_value);
-		sum /= c;
-		sum = sqrt(sum);
-		m_median_value -= (int)(sum * 2);
+		m_bad_pixels = bad_pixels;
+		buildTable();
 	}
 
-	void BadPixels::correct(const unsigned short *in, unsigned short *out)
+	void BadPixels::buildTable()
 	{
-		unsigned short pixels[9];
-		// unsigned short buff[10];
-		int w = m_width;
-		int h = m_height;
-
-		if (in != out)
-			memcpy(out, in, m_width * m_height * 2);
-		for (size_t i = 0; i < m_bad_pixels.size(); ++i)
-		{
-			int x = m_bad_pixels[i].x();
-			int y = m_bad_pixels[i].y();
-
-			unsigned short *pix = pixels;
-			for (int dx = x - 1; dx <= x + 1; ++dx)
-				for (int dy = y - 1; dy <= y + 1; ++dy)
-					if (dx >= 0 && dy >= 0 && dx < w && dy < h)
-					{
-						*pix++ = in[dx + dy * w];
-					}
-			int c = (int)(pix - pixels);
+		m_targets.clear();
+		m_neighbors.clear();
+		m_inplace_targets.clear();
+		m_inplace_neighbors.clear();
+		const int w = m_width;
+		const int h = m_height;
 
-			std::nth_element(pixels, pixels + c / 2, pixels + c);
-			out[x + y * w] = pixels[c / 2];
+		std::vector<char> bad((size_t)w * h, 0);
+		for (const Point &p : m_bad_pixels)
+			if (p.x() >= 0 && p.y() >= 0 && p.x() < w && p.y() < h)
+				bad[p.x() + p.y() * w] = 1;
+
+		// small images: correctInplace() uses the same clipped window as correct(), in sequence
+		m_inplace_sequential = w < 3 || h < 3;
+
+		int neighbors[9];
+		for (const Point &p : m_bad_pixels)
+		{
+			const int x = p.x();
+			const int y = p.y();
+			if (x < 0 || y < 0 || x >= w || y >= h)
+				continue;
+
+			// correct(): 3*3 window clipped to the image, center and other bad pixels included
+			int c = 0;
+			for (int dy = std::max(0, y - 1); dy <= std::min(h - 1, y + 1); ++dy)
+				for (int dx = std::max(0, x - 1); dx <= std::min(w - 1, x + 1); ++dx)
+					neighbors[c++] = dx + dy * w;
+			detail::addEntry(m_targets, m_neighbors, x + y * w, neighbors, c);
+
+			if (m_inplace_sequential)
+			{
+				detail::addEntry(m_inplace_targets, m_inplace_neighbors, x + y * w, neighbors, c);
+				continue;
+			}
+
+			// correctInplace(): 3*3 window shifted inside the image, bad pixels excluded.
+			// A bad pixel without valid neighbor is left unchanged.
+			const int x0 = std::min(std::max(x - 1, 0), w - 3);
+			const int y0 = std::min(std::max(y - 1, 0), h - 3);
+			c = 0;
+			for (int dy = y0; dy < y0 + 3; ++dy)
+				for (int dx = x0; dx < x0 + 3; ++dx)
+					if (!bad[dx + dy * w])
+						neighbors[c++] = dx + dy * w;
+			if (c)
+				detail::addEntry(m_inplace_targets, m_inplace_neighbors, x + y * w, neighbors, c);
 		}
+	}
+
+	bool BadPixels::save(const char *filename) const
+	{
+		std::ofstream fout(filename, std::ios::binary);
+		return fout && save(fout);
+	}
+
+	bool BadPixels::save(std::ostream &out) const
+	{
+		int header[4] = {m_width, m_height, m_median_value, (int)m_bad_pixels.size()};
+		out.write(BAD_PIXELS_MAGIC, 8);
+		out.write((const char *)header, sizeof(header));
+		for (const Point &p : m_bad_pixels)
+		{
+			int xy[2] = {(int)p.x(), (int)p.y()};
+			out.write((const char *)xy, sizeof(xy));
+		}
+		return (bool)out;
+	}
+
+	bool BadPixels::load(const char *filename)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		return fin && load(fin);
+	}
+
+	bool BadPixels::load(std::istream &in)
+	{
+		char magic[8];
+		int header[4];
+		if (!in.read(magic, 8) || memcmp(magic, BAD_PIXELS_MAGIC, 8) != 0)
+			return false;
+		if (!in.read((char *)header, sizeof(header)) || header[0] <= 0 || header[1] <= 0 || header[3] < 0)
+			return false;
+		// reject corrupted counts before allocating
+		if ((int64_t)header[3] > (int64_t)header[0] * header[1])
+			return false;
+		const std::streampos start = in.tellg();
+		if (start != std::streampos(-1) && in.seekg(0, std::ios::end))
+		{
+			const int64_t remaining = (int64_t)(in.tellg() - start);
+			in.seekg(start);
+			if (remaining < (int64_t)header[3] * 2 * (int64_t)sizeof(int))
+				return false;
+		}
+		in.clear();
+		std::vector<int> xy((size_t)header[3] * 2);
+		if (xy.size() && !in.read((char *)xy.data(), xy.size() * sizeof(int)))
+			return false;
+
+		Polygon bad_pixels(header[3]);
+		for (int i = 0; i < header[3]; ++i)
+			bad_pixels[i] = Point(xy[i * 2], xy[i * 2 + 1]);
+		m_median_value = header[2];
+		setBadPixels(bad_pixels, header[0], header[1]);
+		return true;
+	}
+
+	void BadPixels::setLowValueThreshold(int threshold)
+	{
+		m_median_value = threshold;
+	}
+
+	void BadPixels::correctInplace(unsigned short *img) const
+	{
+		detail::correctTable(m_inplace_targets.data(), m_inplace_neighbors.data(), m_inplace_targets.size(), img, img, m_inplace_sequential);
+	}
+
+	void BadPixels::correctInplace(float *img) const
+	{
+		detail::correctScalar(m_inplace_targets.data(), m_inplace_neighbors.data(), m_inplace_targets.size(), (const float *)img, img, -FLT_MAX, FLT_MAX);
+	}
+
+	void BadPixels::correct(const unsigned short *in, unsigned short *out)
+	{
+		const size_t size = (size_t)m_width * m_height;
+		std::vector<unsigned short> tmp;
+		if (in == out)
+		{
+			// neighbors are read from the uncorrected image
+			tmp.assign(in, in + size);
+			in = tmp.data();
+		}
+		else
+			memcpy(out, in, size * 2);
+		detail::correctTable(m_targets.data(), m_neighbors.data(), m_targets.size(), in, out, false);
 
 		// remove low values
 		if (m_median_value > 0)
 		{
-			clampMin(out, w * h, m_median_value);
+			clampMin(out, size, m_median_value);
 		}
 	}
 
 	void BadPixels::correctOnePass(unsigned short *img, int width, int height, int std_factor)
 	{
-		long long st = msecs_since_epoch();
 		static constexpr int win_w = 5;
 		static constexpr int win_h = 5;
 
@@ -118,9 +457,6 @@ namespace rir
 				}
 			}
 		}
-
-		long long el = msecs_since_epoch() - st;
-		printf("el: %i\n", (int)el);
 	}
 
 }
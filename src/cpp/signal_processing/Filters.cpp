@@ -1,5 +1,6 @@
 #include "Filters.h"
 #include "SIMD.h"
+#include "Histogram.h"
 
 namespace rir
 {
@@ -55,20 +56,11 @@ namespace rir
 	 */
 	unsigned short findMedianPixel(unsigned short *pixels, size_t size, float percent)
 	{
-		// build histogram
-		std::vector<size_t> hist(65535, 0);
-		for (size_t i = 0; i < size; ++i)
-			hist[pixels[i]]++;
-
-		size_t s = static_cast<size_t>(std::round(size * percent));
-		size_t count = 0;
-		for (size_t i = 0; i < hist.size(); ++i)
-		{
-			count += hist[i];
-			if (count >= s)
-				return static_cast<unsigned short>(i);
-		}
-		return 0;
+		// reuse the histogram across calls
+		static thread_local PixelHistogram hist;
+		hist.clear();
+		hist.add(pixels, size);
+		return hist.quantile(percent);
 	}
 
 	/**
@@ -77,27 +69,431 @@ namespace rir
 	 */
 	unsigned short findMedianPixelMask(unsigned short *pixels, size_t size, float percent, unsigned char *mask)
 	{
-		// build histogram
-		std::vector<size_t> hist(65535, 0);
-		size_t c = 0;
-		for (size_t i = 0; i < size; ++i)
+		static thread_local PixelHistogram hist;
+		hist.clear();
+		hist.add(pixels, mask, size);
+		return hist.quantile(percent);
+	}
+
+	namespace detail
+	{
+		/**
+		 * out[i] = k * in[i] if first is true, out[i] += k * in[i] otherwise
+		 */
+		static void scaledAdd(float *RIR_RESTRICT out, const float *RIR_RESTRICT in, float k, int n, bool first)
+		{
+			int i = 0;
+#ifdef __AVX2__
+			if (detectInstructionSet().HW_AVX2)
+			{
+				const __m256 vk = _mm256_set1_ps(k);
+				if (first)
+					for (; i + 8 <= n; i += 8)
+						_mm256_storeu_ps(out + i, _mm256_mul_ps(vk, _mm256_loadu_ps(in + i)));
+				else
+					for (; i + 8 <= n; i += 8)
+						_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(vk, _mm256_loadu_ps(in + i))));
+			}
+#endif
+#ifdef __SSE2__
+			if (detectInstructionSet().HW_SSE2)
+			{
+				const __m128 vk = _mm_set1_ps(k);
+				if (first)
+					for (; i + 4 <= n; i += 4)
+						_mm_storeu_ps(out + i, _mm_mul_ps(vk, _mm_loadu_ps(in + i)));
+				else
+					for (; i + 4 <= n; i += 4)
+						_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(vk, _mm_loadu_ps(in + i))));
+			}
+#endif
+			if (first)
+				for (; i < n; ++i)
+					out[i] = k * in[i];
+			else
+				for (; i < n; ++i)
+					out[i] += k * in[i];
+		}
+
+		/**
+		 * Horizontal pass of the separable gaussian filter on one row
+		 */
+		static void gaussianRowFIR(const float *RIR_RESTRICT src, float *RIR_RESTRICT dst, int w, const float *kernel, int radius)
 		{
-			if (mask[i])
+			// interior pixels: one scaled add per kernel tap
+			int start = radius;
+			int end = w - radius;
+			if (end > start)
+				for (int i = 0; i <= 2 * radius; ++i)
+					scaledAdd(dst + start, src + i, kernel[i], end - start, i == 0);
+			else
+				start = end = w;
+
+			// border pixels: renormalized truncated kernel
+			for (int x = 0; x < w; ++x)
 			{
-				hist[pixels[i]]++;
-				++c;
+				if (x == start)
+					x = end;
+				if (x >= w)
+					break;
+				float res = 0, sum = 0;
+				for (int i = std::max(0, radius - x); i <= 2 * radius && x + i - radius < w; ++i)
+				{
+					res += kernel[i] * src[x + i - radius];
+					sum += kernel[i];
+				}
+				dst[x] = res / sum;
 			}
 		}
-		// printf("count; %i\n", c);
-		size_t s = (int)std::round(c * percent);
-		size_t count = 0;
-		for (size_t i = 0; i < hist.size(); ++i)
+
+		static void gaussianFIR(const float *src, float *dst, float *tmp, int w, int h, float sigma, bool parallel)
 		{
-			count += hist[i];
-			if (count >= s)
-				return (unsigned short)i;
+			int radius = (int)(sigma * 2);
+			if (radius < 1)
+				radius = 1;
+
+			// 1D kernel: the 2D gaussian kernel is the product of two 1D kernels
+			std::vector<float> kernel(radius * 2 + 1);
+			float sum = 0;
+			for (int i = -radius; i <= radius; ++i)
+				sum += kernel[i + radius] = std::exp(-(float)(i * i) / (2.0f * sigma * sigma));
+			for (size_t i = 0; i < kernel.size(); ++i)
+				kernel[i] /= sum;
+
+#pragma omp parallel for if (parallel)
+			for (int y = 0; y < h; ++y)
+				gaussianRowFIR(src + (size_t)y * w, tmp + (size_t)y * w, w, kernel.data(), radius);
+
+#pragma omp parallel for if (parallel)
+			for (int y = 0; y < h; ++y)
+			{
+				float *out = dst + (size_t)y * w;
+				int first = std::max(0, radius - y);
+				int last = std::min(2 * radius, h - 1 - y + radius);
+				float ksum = 0;
+				for (int i = first; i <= last; ++i)
+				{
+					scaledAdd(out, tmp + (size_t)(y + i - radius) * w, kernel[i], w, i == first);
+					ksum += kernel[i];
+				}
+				// border rows: renormalize
+				if (first != 0 || last != 2 * radius)
+					for (int x = 0; x < w; ++x)
+						out[x] /= ksum;
+			}
 		}
-		return 0;
+
+		/**
+		 * Recursive gaussian filter from Young and van Vliet, "Recursive implementation of the Gaussian filter" (1995)
+		 */
+		struct RecursiveGaussian
+		{
+			float B, a1, a2, a3;
+			RecursiveGaussian(float sigma)
+			{
+				double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * std::sqrt(1 - 0.26891 * sigma);
+				double q2 = q * q, q3 = q2 * q;
+				double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+				double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+				double b2 = -(1.4281 * q2 + 1.26661 * q3);
+				double b3 = 0.422205 * q3;
+				a1 = (float)(b1 / b0);
+				a2 = (float)(b2 / b0);
+				a3 = (float)(b3 / b0);
+				B = 1.f - (a1 + a2 + a3);
+			}
+		};
+
+		static void gaussianIIR(const float *src, float *dst, float *tmp, int w, int h, float sigma, bool parallel)
+		{
+			const RecursiveGaussian g(sigma);
+			const float B = g.B, a1 = g.a1, a2 = g.a2, a3 = g.a3;
+
+			// horizontal pass, causal then anti-causal, borders are replicated
+#pragma omp parallel for if (parallel)
+			for (int y = 0; y < h; ++y)
+			{
+				const float *s = src + (size_t)y * w;
+				float *t = tmp + (size_t)y * w;
+				float p1 = s[0], p2 = s[0], p3 = s[0];
+				for (int x = 0; x < w; ++x)
+				{
+					float v = B * s[x] + a1 * p1 + a2 * p2 + a3 * p3;
+					t[x] = v;
+					p3 = p2;
+					p2 = p1;
+					p1 = v;
+				}
+				p1 = p2 = p3 = t[w - 1];
+				for (int x = w - 1; x >= 0; --x)
+				{
+					float v = B * t[x] + a1 * p1 + a2 * p2 + a3 * p3;
+					t[x] = v;
+					p3 = p2;
+					p2 = p1;
+					p1 = v;
+				}
+			}
+
+			// vertical pass on blocks of columns, vectorized along rows
+			const int block = 256;
+			const int blocks = (w + block - 1) / block;
+#pragma omp parallel for if (parallel)
+			for (int b = 0; b < blocks; ++b)
+			{
+				const int x0 = b * block;
+				const int n = std::min(block, w - x0);
+				float *RIR_RESTRICT t = tmp + x0;
+				float *RIR_RESTRICT d = dst + x0;
+				// replicated border: the first row is its own steady state and is left unchanged
+				for (int y = 1; y < h; ++y)
+				{
+					float *RIR_RESTRICT c = t + (size_t)y * w;
+					const float *p1 = t + (size_t)(y - 1) * w;
+					const float *p2 = t + (size_t)std::max(y - 2, 0) * w;
+					const float *p3 = t + (size_t)std::max(y - 3, 0) * w;
+					for (int x = 0; x < n; ++x)
+						c[x] = B * c[x] + a1 * p1[x] + a2 * p2[x] + a3 * p3[x];
+				}
+				for (int y = h - 1; y >= 0; --y)
+				{
+					const float *RIR_RESTRICT c = t + (size_t)y * w;
+					float *RIR_RESTRICT o = d + (size_t)y * w;
+					const float *n1 = y + 1 < h ? d + (size_t)(y + 1) * w : c;
+					const float *n2 = y + 2 < h ? d + (size_t)(y + 2) * w : n1;
+					const float *n3 = y + 3 < h ? d + (size_t)(y + 3) * w : n2;
+					for (int x = 0; x < n; ++x)
+						o[x] = B * c[x] + a1 * n1[x] + a2 * n2[x] + a3 * n3[x];
+				}
+			}
+		}
+
+		static void gaussianFilterInternal(const float *src, float *dst, float *tmp, int w, int h, float sigma, int method, bool parallel)
+		{
+			if (sigma <= 0)
+			{
+				if (src != dst)
+					std::copy(src, src + (size_t)w * h, dst);
+				return;
+			}
+			// the recursive filter coefficients are only valid for sigma >= 0.5
+			if (method == GaussianAuto)
+				method = sigma > 8 ? GaussianIIR : GaussianFIR;
+			if (method == GaussianIIR && sigma >= 0.5f)
+				gaussianIIR(src, dst, tmp, w, h, sigma, parallel);
+			else
+				gaussianFIR(src, dst, tmp, w, h, sigma, parallel);
+		}
+	}
+
+	void gaussianFilter(const float *src, float *dst, int w, int h, float sigma, int method)
+	{
+		if (w <= 0 || h <= 0)
+			return;
+		std::vector<float> tmp((size_t)w * h);
+		detail::gaussianFilterInternal(src, dst, tmp.data(), w, h, sigma, method, true);
+	}
+
+	void gaussianFilterStack(const float *src, float *dst, int w, int h, int count, float sigma, int method)
+	{
+		if (w <= 0 || h <= 0 || count <= 0)
+			return;
+		if (count == 1)
+			return gaussianFilter(src, dst, w, h, sigma, method);
+
+		const size_t size = (size_t)w * h;
+#pragma omp parallel
+		{
+			std::vector<float> tmp(size);
+#pragma omp for
+			for (int i = 0; i < count; ++i)
+				detail::gaussianFilterInternal(src + i * size, dst + i * size, tmp.data(), w, h, sigma, method, false);
+		}
+	}
+
+	namespace detail
+	{
+		/**
+		 * Bilinear interpolation with translate() weights and evaluation order:
+		 * \a u is the horizontal weight of the right pixels, \a v the vertical weight of the top pixels.
+		 */
+		template <class T>
+		static RIR_ALWAYS_INLINE T bilinear(T tl, T tr, T bl, T br, double u, double v)
+		{
+			return detail::cast<T>((bl * (1 - v) + tl * v) * (1 - u) + (br * (1 - v) + tr * v) * u);
+		}
+
+#ifdef __SSE2__
+		static RIR_ALWAYS_INLINE __m128d bilinear(__m128d tl, __m128d tr, __m128d bl, __m128d br, __m128d u, __m128d u1, __m128d v, __m128d v1)
+		{
+			const __m128d l = _mm_add_pd(_mm_mul_pd(bl, v1), _mm_mul_pd(tl, v));
+			const __m128d r = _mm_add_pd(_mm_mul_pd(br, v1), _mm_mul_pd(tr, v));
+			return _mm_add_pd(_mm_mul_pd(l, u1), _mm_mul_pd(r, u));
+		}
+		// 4 unsigned 16 bits values (low half of \a a, already widened to 32 bits) to 2*2 doubles
+		static RIR_ALWAYS_INLINE __m128d lowPd(__m128i a) { return _mm_cvtepi32_pd(a); }
+		static RIR_ALWAYS_INLINE __m128d highPd(__m128i a) { return _mm_cvtepi32_pd(_mm_srli_si128(a, 8)); }
+#endif
+
+		/**
+		 * Bilinear interpolation of \a count pixels from rows \a top and \a bottom,
+		 * writing pixel i from top[i], top[i+1], bottom[i] and bottom[i+1].
+		 * Computed in double precision like translate(), vectorized with SSE2.
+		 */
+		static void lerpRow(const unsigned short *top, const unsigned short *bottom, unsigned short *dst, int count, double u, double v, bool sse2)
+		{
+			int x = 0;
+			if (sse2)
+			{
+#ifdef __SSE2__
+				const __m128d vu = _mm_set1_pd(u), vu1 = _mm_set1_pd(1 - u);
+				const __m128d vv = _mm_set1_pd(v), vv1 = _mm_set1_pd(1 - v);
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i bias32 = _mm_set1_epi32(32768);
+				const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+				for (; x + 8 <= count; x += 8)
+				{
+					const __m128i tl = _mm_loadu_si128((const __m128i *)(top + x));
+					const __m128i tr = _mm_loadu_si128((const __m128i *)(top + x + 1));
+					const __m128i bl = _mm_loadu_si128((const __m128i *)(bottom + x));
+					const __m128i br = _mm_loadu_si128((const __m128i *)(bottom + x + 1));
+					__m128i res[2];
+					for (int k = 0; k < 2; ++k)
+					{
+						const __m128i itl = k ? _mm_unpackhi_epi16(tl, zero) : _mm_unpacklo_epi16(tl, zero);
+						const __m128i itr = k ? _mm_unpackhi_epi16(tr, zero) : _mm_unpacklo_epi16(tr, zero);
+						const __m128i ibl = k ? _mm_unpackhi_epi16(bl, zero) : _mm_unpacklo_epi16(bl, zero);
+						const __m128i ibr = k ? _mm_unpackhi_epi16(br, zero) : _mm_unpacklo_epi16(br, zero);
+						const __m128i lo = _mm_cvttpd_epi32(bilinear(lowPd(itl), lowPd(itr), lowPd(ibl), lowPd(ibr), vu, vu1, vv, vv1));
+						const __m128i hi = _mm_cvttpd_epi32(bilinear(highPd(itl), highPd(itr), highPd(ibl), highPd(ibr), vu, vu1, vv, vv1));
+						res[k] = _mm_sub_epi32(_mm_unpacklo_epi64(lo, hi), bias32);
+					}
+					// values are within [0, 65535]: signed saturation on biased values
+					_mm_storeu_si128((__m128i *)(dst + x), _mm_add_epi16(_mm_packs_epi32(res[0], res[1]), bias16));
+				}
+#endif
+			}
+			for (; x < count; ++x)
+				dst[x] = bilinear(top[x], top[x + 1], bottom[x], bottom[x + 1], u, v);
+		}
+		static void lerpRow(const float *top, const float *bottom, float *dst, int count, double u, double v, bool sse2)
+		{
+			int x = 0;
+			if (sse2)
+			{
+#ifdef __SSE2__
+				const __m128d vu = _mm_set1_pd(u), vu1 = _mm_set1_pd(1 - u);
+				const __m128d vv = _mm_set1_pd(v), vv1 = _mm_set1_pd(1 - v);
+				for (; x + 4 <= count; x += 4)
+				{
+					const __m128 tl = _mm_loadu_ps(top + x);
+					const __m128 tr = _mm_loadu_ps(top + x + 1);
+					const __m128 bl = _mm_loadu_ps(bottom + x);
+					const __m128 br = _mm_loadu_ps(bottom + x + 1);
+					const __m128 lo = _mm_cvtpd_ps(bilinear(_mm_cvtps_pd(tl), _mm_cvtps_pd(tr), _mm_cvtps_pd(bl), _mm_cvtps_pd(br), vu, vu1, vv, vv1));
+					const __m128 hi = _mm_cvtpd_ps(bilinear(_mm_cvtps_pd(_mm_movehl_ps(tl, tl)), _mm_cvtps_pd(_mm_movehl_ps(tr, tr)),
+															_mm_cvtps_pd(_mm_movehl_ps(bl, bl)), _mm_cvtps_pd(_mm_movehl_ps(br, br)), vu, vu1, vv, vv1));
+					_mm_storeu_ps(dst + x, _mm_movelh_ps(lo, hi));
+				}
+#endif
+			}
+			for (; x < count; ++x)
+				dst[x] = bilinear(top[x], top[x + 1], bottom[x], bottom[x + 1], u, v);
+		}
+
+		template <class T>
+		static void translateImageInternal(const T *src, T *dst, int w, int h, double dx, double dy, TranslateBorder strategy, T background)
+		{
+			if (w <= 0 || h <= 0)
+				return;
+			if (src == dst)
+			{
+				// nothing to do for a null in-place translation
+				if (dx == 0 && dy == 0)
+					return;
+				// in-place: translate from a copy of the input image
+				static thread_local std::vector<T> scratch;
+				scratch.assign(src, src + (size_t)w * h);
+				src = scratch.data();
+			}
+			if (strategy == TranslateWrap)
+				return translate(src, dst, background, w, h, (float)dx, (float)dy, strategy);
+
+			bool sse2 = detectInstructionSet().HW_SSE2;
+#ifndef __SSE2__
+			sse2 = false;
+#endif
+
+			// columns [x_start, x_end) are inside the source image: 0 <= x - dx < w
+			const int x_start = std::max(0, std::min(w, (int)std::ceil(dx)));
+			const int x_end = std::max(x_start, std::min(w, (int)std::ceil(w + dx)));
+
+			// constant horizontal source offset and weight
+			const int left0 = x_start < x_end ? (int)(x_start - dx) : 0;
+			const int offset = left0 - x_start;
+			const double u = x_start < x_end ? (x_start - dx) - left0 : 0.;
+			// last column whose right neighbor is still inside the source image
+			const int x_lerp_end = std::max(x_start, std::min(x_end, w - 1 - offset));
+
+#pragma omp parallel for if ((size_t)w * h > 65536)
+			for (int y = 0; y < h; ++y)
+			{
+				T *d = dst + (size_t)y * w;
+				const double py = y - dy;
+				if (py < 0 || py >= h)
+				{
+					// whole row outside the source image
+					if (strategy == TranslateConstant)
+						std::fill(d, d + w, background);
+					else if (strategy == TranslateNearest)
+					{
+						const T *s = src + (py < 0 ? 0 : (size_t)(h - 1) * w);
+						std::fill(d, d + x_start, s[0]);
+						std::copy(s + x_start + offset, s + x_end + offset, d + x_start);
+						std::fill(d + x_end, d + w, s[w - 1]);
+					}
+					continue;
+				}
+
+				const int top = (int)py;
+				// weight of the top row, the last row being its own bottom neighbor
+				const double v = 1 - (py - top);
+				const T *t = src + (size_t)top * w;
+				const T *b = top + 1 < h ? t + w : t;
+
+				// left and right borders
+				if (strategy == TranslateConstant)
+				{
+					std::fill(d, d + x_start, background);
+					std::fill(d + x_end, d + w, background);
+				}
+				else if (strategy == TranslateNearest)
+				{
+					std::fill(d, d + x_start, t[0]);
+					std::fill(d + x_end, d + w, t[w - 1]);
+				}
+
+				// interior
+				if (u == 0 && v == 1)
+					std::copy(t + x_start + offset, t + x_end + offset, d + x_start);
+				else
+				{
+					lerpRow(t + x_start + offset, b + x_start + offset, d + x_start, x_lerp_end - x_start, u, v, sse2);
+					// last column: the right neighbor is replicated
+					for (int x = x_lerp_end; x < x_end; ++x)
+						d[x] = bilinear(t[x + offset], t[x + offset], b[x + offset], b[x + offset], u, v);
+				}
+			}
+		}
+	}
+
+	void translateImage(const unsigned short *src, unsigned short *dst, int w, int h, double dx, double dy, TranslateBorder strategy, unsigned short background)
+	{
+		detail::translateImageInternal(src, dst, w, h, dx, dy, strategy, background);
+	}
+	void translateImage(const float *src, float *dst, int w, int h, double dx, double dy, TranslateBorder strategy, float background)
+	{
+		detail::translateImageInternal(src, dst, w, h, dx, dy, strategy, background);
 	}
 
 	namespace detail
@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 #include "Primitives.h"
 
 /** @file
@@ -209,6 +211,27 @@ namespace rir
 	 */
 	SIGNAL_PROCESSING_EXPORT unsigned short findMedianPixelMask(unsigned short *pixels, size_t size, float percent, unsigned char *mask);
 
+	/**
+	 * Gaussian filter implementation
+	 */
+	enum GaussianMethod
+	{
+		GaussianFIR = 0, // separable convolution with a kernel of radius 2*sigma, border pixels use the renormalized truncated kernel
+		GaussianIIR = 1, // recursive Young-van Vliet approximation, constant cost whatever sigma, replicated borders
+		GaussianAuto = 2 // GaussianIIR for large sigma, GaussianFIR otherwise
+	};
+
+	/**
+	 * Apply a gaussian filter with given \a sigma to a float image using given method (one of GaussianMethod).
+	 * \a src and \a dst can point to the same buffer. If sigma <= 0, \a src is copied to \a dst.
+	 */
+	SIGNAL_PROCESSING_EXPORT void gaussianFilter(const float *src, float *dst, int w, int h, float sigma, int method = GaussianFIR);
+
+	/**
+	 * Apply a gaussian filter to \a count contiguous images of size w*h.
+	 */
+	SIGNAL_PROCESSING_EXPORT void gaussianFilterStack(const float *src, float *dst, int w, int h, int count, float sigma, int method = GaussianFIR);
+
 	enum ResampleStrategy
 	{
 		ResampleUnion = 0,
@@ -325,30 +348,20 @@ namespace rir
 		}
 	}
 
-	namespace detail
-	{
-		inline void extend(std::vector<signed_integral> &vec, signed_integral size)
-		{
-			while ((signed_integral)vec.size() < size)
-				vec.push_back((signed_integral)vec.size());
-		}
-
-		static inline signed_integral find_top(std::vector<signed_integral> &relabel, signed_integral label)
-		{
-			signed_integral origin = label;
-			while (label != relabel[label])
-				label = relabel[label];
-
-			// relabel the full path toward top most value to fasten following look ups
-			do
-			{
-				relabel[origin] = label;
-				origin = relabel[origin];
-			} while (origin != relabel[origin]);
-
-			return label;
-		}
-	}
+	/**
+	 * Translate an unsigned short or float image by a floating point offset.
+	 *
+	 * Specialized version of translate() for TranslateUnchanged, TranslateConstant and TranslateNearest strategies
+	 * (TranslateWrap falls back to translate()). As the offset is constant, bilinear weights are computed once per image
+	 * in double precision, integer offsets reduce to row copies and the image interior is vectorized with SSE2 when available.
+	 * Borders are processed separately and follow translate() rules. The interpolation uses the same formula as translate(),
+	 * results only differ where translate() rounds x - dx or y - dy to float.
+	 *
+	 * \a src and \a dst can point to the same buffer for in-place translation (a per-thread scratch image is reused across calls,
+	 * a null in-place translation returns immediately).
+	 */
+	SIGNAL_PROCESSING_EXPORT void translateImage(const unsigned short *src, unsigned short *dst, int w, int h, double dx, double dy, TranslateBorder strategy = TranslateNearest, unsigned short background = 0);
+	SIGNAL_PROCESSING_EXPORT void translateImage(const float *src, float *dst, int w, int h, double dx, double dy, TranslateBorder strategy = TranslateNearest, float background = 0);
 
 	/**
 	 * Label representing a ROI inside an image
@@ -362,184 +375,329 @@ namespace rir
 	};
 
 	/**
-	 * Very fast image labelling algorithm
+	 * Label with additional statistics computed by labelImageStats()
 	 */
-	template <class T, class U>
-	std::vector<Label> labelImage(const T *input, U *output, const signed_integral w, const signed_integral h, const T background)
+	struct LabelStats : Label
 	{
-		// In the worst case, relabel vector should have a size of w*h.
-		// In practice, when the number of ROI is small, it's size is usually < 1000.
-		// Therefore, we do not allocate it first, and extend it only when necessary.
-		// This strategy divides by 2 the computation time for low ROI number (probably due to allocation + data locality)
-		std::vector<signed_integral> relabel;
-
-		signed_integral next_label = 1;
-		signed_integral minx = w;
-		signed_integral miny = -1;
-		signed_integral maxx = -1;
-		signed_integral maxy = -1;
-
-		signed_integral index = 0;
-		for (signed_integral y = 0; y < h; ++y)
+		Rect bbox;		  // bounding box, xmax and ymax excluded
+		PointF centroid;  // mean pixel position
+		double max_value; // maximum of the values image inside the label (0 without values image)
+		Point max_pos;	  // first position of max_value in raster order
+		LabelStats()
+			: max_value(0), max_pos(-1, -1) {}
+	};
+
+	namespace detail
+	{
+		/**
+		 * Returns the first position >= x in [x, w) where row[x] != value.
+		 * Small integral types compare 8 bytes at once to skip uniform areas (background of binary masks).
+		 */
+		template <class T>
+		inline signed_integral skipEqual(const T *row, signed_integral x, signed_integral w, T value, std::true_type)
 		{
-			for (signed_integral x = 0; x < w; ++x, ++index)
+			const signed_integral n = 8 / sizeof(T);
+			T tmp[8 / sizeof(T)];
+			std::fill(tmp, tmp + n, value);
+			uint64_t pattern;
+			memcpy(&pattern, tmp, 8);
+			for (; x + n <= w; x += n)
 			{
-				output[index] = (U)0;
-				const T value = input[index];
-
-				// ignore background value
-				if (value == background)
-				{
-
-					continue;
-				}
-
-				if (x < minx)
-					minx = x;
-				if (x > maxx)
-					maxx = x;
-				if (miny < 0)
-					miny = y;
-				maxy = y;
-
-				// check neighbors
+				uint64_t word;
+				memcpy(&word, row + x, 8);
+				if (word != pattern)
+					break;
+			}
+			while (x < w && row[x] == value)
+				++x;
+			return x;
+		}
+		template <class T>
+		inline signed_integral skipEqual(const T *row, signed_integral x, signed_integral w, T value, std::false_type)
+		{
+			while (x < w && row[x] == value)
+				++x;
+			return x;
+		}
+		template <class T>
+		inline signed_integral skipEqual(const T *row, signed_integral x, signed_integral w, T value)
+		{
+			return skipEqual(row, x, w, value, std::integral_constant < bool, std::is_integral<T>::value && sizeof(T) <= 4 > ());
+		}
 
-				U label;
+		/**
+		 * Connected components of an image stored as horizontal runs of equal values.
+		 *
+		 * Two pixels are connected if they are 4-neighbors with the same value. The image is split in horizontal strips
+		 * that are run-length encoded and labelled (union-find on runs) in parallel, then strips boundaries are merged.
+		 * Final labels are consecutive, starting at 1, and numbered in the raster order of their first pixel.
+		 */
+		template <class T>
+		class ConnectedRuns
+		{
+		public:
+			struct Run
+			{
+				signed_integral x0, x1; // [x0, x1)
+				signed_integral y;
+				T value;
+			};
+
+			// runs in raster order
+			std::vector<Run> runs;
+			// final label of each run
+			std::vector<signed_integral> labels;
+			// first run of each strip, plus total run count
+			std::vector<signed_integral> strips;
+			signed_integral strip_height;
+			signed_integral label_count;
+
+			ConnectedRuns(const T *input, signed_integral w, signed_integral h, T background)
+				: strip_height(32), label_count(0)
+			{
+				const signed_integral strip_count = h > 0 ? (h + strip_height - 1) / strip_height : 0;
+				std::vector<std::vector<Run>> strip_runs(strip_count);
 
-				// check left
-				if (x > 0 && input[index - 1] == value)
+				// run-length encoding
+#pragma omp parallel for if (w * h > 65536)
+				for (signed_integral s = 0; s < strip_count; ++s)
 				{
-					label = output[index - 1];
-
-					if (y > 0)
+					std::vector<Run> &r = strip_runs[s];
+					const signed_integral end = std::min(h, (s + 1) * strip_height);
+					for (signed_integral y = s * strip_height; y < end; ++y)
 					{
-						// check top
-						if (const U top_label = output[index - w])
+						const T *row = input + y * w;
+						signed_integral x = skipEqual(row, 0, w, background);
+						while (x < w)
 						{
-							// top pixel has a different label
-							if (top_label != label)
-							{
-
-								detail::extend(relabel, std::max(label, top_label) + 1);
-
-								if (relabel[label] == label)
-								{
-
-									// get top_label origin
-									signed_integral top = detail::find_top(relabel, top_label);
-
-									if (top != label)
-										relabel[label] = top_label;
-								}
-								else if (relabel[label] != top_label)
-								{
-
-									signed_integral v = detail::find_top(relabel, top_label);
-									signed_integral v2 = detail::find_top(relabel, label);
-									if (v != v2)
-									{
-										if (v > v2)
-											relabel[v] = v2;
-										else
-											relabel[v2] = v;
-									}
-								}
-							}
+							Run run;
+							run.x0 = x;
+							run.value = row[x];
+							run.x1 = x = skipEqual(row, x + 1, w, run.value);
+							run.y = y;
+							r.push_back(run);
+							x = skipEqual(row, x, w, background);
 						}
 					}
 				}
-				else if (y > 0 && output[index - w]) // check top
-					label = output[index - w];
-				else
-					label = next_label++;
 
-				output[index] = label;
-			}
-		}
+				strips.resize(strip_count + 1, 0);
+				for (signed_integral s = 0; s < strip_count; ++s)
+					strips[s + 1] = strips[s] + (signed_integral)strip_runs[s].size();
+				runs.resize(strips.back());
+				labels.resize(runs.size());
+				for (signed_integral i = 0; i < (signed_integral)labels.size(); ++i)
+					labels[i] = i;
+
+				// union inside each strip
+#pragma omp parallel for if (w * h > 65536)
+				for (signed_integral s = 0; s < strip_count; ++s)
+				{
+					std::copy(strip_runs[s].begin(), strip_runs[s].end(), runs.begin() + strips[s]);
+					std::vector<Run>().swap(strip_runs[s]);
+					// runs of the previous row
+					signed_integral prev_begin = 0, prev_end = 0, prev_y = -2;
+					for (signed_integral i = strips[s]; i < strips[s + 1];)
+					{
+						const signed_integral y = runs[i].y;
+						signed_integral end = i;
+						while (end < strips[s + 1] && runs[end].y == y)
+							++end;
+						if (prev_y == y - 1)
+							connectRows(prev_begin, prev_end, i, end);
+						prev_begin = i;
+						prev_end = end;
+						prev_y = y;
+						i = end;
+					}
+				}
 
-		detail::extend(relabel, next_label);
+				// merge strips boundaries
+				for (signed_integral s = 1; s < strip_count; ++s)
+				{
+					const signed_integral y = s * strip_height;
+					signed_integral a = strips[s];
+					while (a > strips[s - 1] && runs[a - 1].y == y - 1)
+						--a;
+					signed_integral b = strips[s];
+					while (b < strips[s + 1] && runs[b].y == y)
+						++b;
+					connectRows(a, strips[s], strips[s], b);
+				}
 
-		// at this point, we could relable and we would have isolated all components.
-		// however, their labels would not necessarly be consecutive.
-		// so we need to modify the relabel vector to have consecutive ids
+				// final labels: roots are the first run of each component in raster order
+				for (signed_integral i = 0; i < (signed_integral)labels.size(); ++i)
+				{
+					if (labels[i] == i)
+						labels[i] = -(++label_count);
+					else
+						labels[i] = labels[labels[i]];
+				}
+				for (signed_integral i = 0; i < (signed_integral)labels.size(); ++i)
+					labels[i] = -labels[i];
+			}
 
-		// just find the labels that don't move: they are the remaining ones
-		std::vector<signed_integral> final_labels(next_label);
-		final_labels[0] = 0;
-		signed_integral label_count = 0;
-		for (signed_integral i = 1; i < next_label; ++i)
-		{
+			/**
+			 * Write labels in output image
+			 */
+			template <class U>
+			void write(U *output, signed_integral w, signed_integral h) const
+			{
+				const signed_integral strip_count = (signed_integral)strips.size() - 1;
+#pragma omp parallel for if (w * h > 65536)
+				for (signed_integral s = 0; s < strip_count; ++s)
+				{
+					const signed_integral end = std::min(h, (s + 1) * strip_height);
+					std::fill(output + s * strip_height * w, output + end * w, (U)0);
+					for (signed_integral i = strips[s]; i < strips[s + 1]; ++i)
+						std::fill(output + runs[i].y * w + runs[i].x0, output + runs[i].y * w + runs[i].x1, (U)labels[i]);
+				}
+			}
 
-			// find final label
-			signed_integral v = relabel[i];
-			while (v != relabel[v])
+		private:
+			signed_integral find(signed_integral i)
+			{
+				while (labels[i] != i)
+				{
+					labels[i] = labels[labels[i]];
+					i = labels[i];
+				}
+				return i;
+			}
+			void unite(signed_integral a, signed_integral b)
 			{
-				v = relabel[v];
+				a = find(a);
+				b = find(b);
+				// keep the first run in raster order as root
+				if (a < b)
+					labels[b] = a;
+				else if (b < a)
+					labels[a] = b;
 			}
-			// affect new or existing label
-			if (!final_labels[v])
-				final_labels[v] = ++label_count;
-			signed_integral label = final_labels[v];
-
-			v = relabel[i];
-			final_labels[i] = label;
-			while (v != relabel[v] && final_labels[v] != label)
+			// connect overlapping runs with the same value of 2 consecutive rows
+			void connectRows(signed_integral a, signed_integral a_end, signed_integral b, signed_integral b_end)
 			{
-				final_labels[v] = label;
-				v = relabel[v];
+				while (a < a_end && b < b_end)
+				{
+					if (runs[a].x0 < runs[b].x1 && runs[b].x0 < runs[a].x1 && runs[a].value == runs[b].value)
+						unite(a, b);
+					if (runs[a].x1 < runs[b].x1)
+						++a;
+					else
+						++b;
+				}
 			}
+		};
+	}
+
+	/**
+	 * Very fast image labelling algorithm.
+	 * Pixels are connected if they are 4-neighbors with the same value.
+	 * Returns a vector of label_count + 1 Label, index 0 being the background.
+	 */
+	template <class T, class U>
+	std::vector<Label> labelImage(const T *input, U *output, const signed_integral w, const signed_integral h, const T background)
+	{
+		detail::ConnectedRuns<T> cc(input, w, h, background);
+		cc.write(output, w, h);
+
+		std::vector<Label> res(cc.label_count + 1);
+		for (size_t i = 0; i < cc.runs.size(); ++i)
+		{
+			Label &l = res[cc.labels[i]];
+			if (l.area == 0)
+				l.first = Point(cc.runs[i].x0, cc.runs[i].y);
+			l.area += cc.runs[i].x1 - cc.runs[i].x0;
 		}
+		return res;
+	}
+
+	/**
+	 * Same as labelImage(), but also computes the bounding box, centroid and maximum value of each label.
+	 * The maximum is computed on the \a values image (same size as \a input) if provided.
+	 */
+	template <class T, class U, class V>
+	std::vector<LabelStats> labelImageStats(const T *input, U *output, const signed_integral w, const signed_integral h, const T background, const V *values)
+	{
+		detail::ConnectedRuns<T> cc(input, w, h, background);
+		cc.write(output, w, h);
 
-		std::vector<Label> res(label_count + 1);
+		// per run maximum
+		const signed_integral run_count = (signed_integral)cc.runs.size();
+		std::vector<std::pair<V, signed_integral>> maxs(values ? run_count : 0);
+		if (values)
+		{
+#pragma omp parallel for if (w * h > 65536)
+			for (signed_integral i = 0; i < run_count; ++i)
+			{
+				const auto &r = cc.runs[i];
+				const V *row = values + r.y * w;
+				const V *m = std::max_element(row + r.x0, row + r.x1);
+				maxs[i] = std::make_pair(*m, (signed_integral)(m - row));
+			}
+		}
 
-		// second pass: relabel output
-		for (signed_integral y = miny; y < maxy + 1; ++y)
+		std::vector<LabelStats> res(cc.label_count + 1);
+		std::vector<double> sum_x(res.size(), 0.), sum_y(res.size(), 0.);
+		for (signed_integral i = 0; i < run_count; ++i)
 		{
-			for (signed_integral x = minx; x < maxx + 1; ++x)
+			const auto &r = cc.runs[i];
+			const signed_integral label = cc.labels[i];
+			const signed_integral len = r.x1 - r.x0;
+			LabelStats &l = res[label];
+			if (l.area == 0)
 			{
-				const signed_integral i = x + y * w;
-				if (signed_integral v = (output[i] = final_labels[output[i]]))
+				l.first = Point(r.x0, r.y);
+				l.bbox = Rect(r.x0, r.x1, r.y, r.y + 1);
+				if (values)
 				{
-					// build output
-					res[v].area++;
-					if (res[v].first.x() < 0)
-						res[v].first = Point(x, y);
+					l.max_value = (double)maxs[i].first;
+					l.max_pos = Point(maxs[i].second, r.y);
 				}
 			}
+			else
+			{
+				l.bbox.xmin = std::min(l.bbox.xmin, r.x0);
+				l.bbox.xmax = std::max(l.bbox.xmax, r.x1);
+				l.bbox.ymax = r.y + 1;
+				if (values && (double)maxs[i].first > l.max_value)
+				{
+					l.max_value = (double)maxs[i].first;
+					l.max_pos = Point(maxs[i].second, r.y);
+				}
+			}
+			l.area += len;
+			sum_x[label] += len * (r.x0 + r.x1 - 1) / 2.;
+			sum_y[label] += (double)len * r.y;
 		}
-
+		for (size_t i = 1; i < res.size(); ++i)
+			res[i].centroid = PointF(sum_x[i] / res[i].area, sum_y[i] / res[i].area);
 		return res;
 	}
 
+	/**
+	 * Set the largest connected region of \a input to \a foreground in \a output, and the remaining pixels to \a background.
+	 */
 	template <class T, class U>
 	void keepLargestArea(const T *input, U *output, const signed_integral w, const signed_integral h, const T background, const U foreground)
 	{
-		std::vector<Label> labels = labelImage(input, output, w, h, background);
-		if (labels.size() < 2)
+		detail::ConnectedRuns<T> cc(input, w, h, background);
+		if (cc.label_count == 0)
 		{
+			std::fill(output, output + w * h, (U)0);
 			return;
 		}
 
 		// find biggest ROI
-		Label *found = &labels[1];
-		U value = output[found->first.x() + found->first.y() * w];
-		for (size_t i = 1; i < labels.size(); ++i)
-		{
-			if (labels[i].area > found->area)
-			{
-				found = &labels[i];
-				value = output[found->first.x() + found->first.y() * w];
-			}
-		}
-
-		size_t size = w * h;
-		for (size_t i = 0; i < size; ++i)
-		{
-			if (output[i] != value)
-				output[i] = (U)background;
-			else
-				output[i] = foreground;
-		}
+		std::vector<size_t> areas(cc.label_count + 1, 0);
+		for (size_t i = 0; i < cc.runs.size(); ++i)
+			areas[cc.labels[i]] += cc.runs[i].x1 - cc.runs[i].x0;
+		const signed_integral largest = (signed_integral)(std::max_element(areas.begin() + 1, areas.end()) - areas.begin());
+
+		std::fill(output, output + w * h, (U)background);
+		for (size_t i = 0; i < cc.runs.size(); ++i)
+			if (cc.labels[i] == largest)
+				std::fill(output + cc.runs[i].y * w + cc.runs[i].x0, output + cc.runs[i].y * w + cc.runs[i].x1, foreground);
 	}
 
 }
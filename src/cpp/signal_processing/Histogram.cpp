@@ -0,0 +1,165 @@
+#include "Histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define HIST_BANKS 4
+#define HIST_BINS 65536
+// maximum pixels per bank merge, to avoid overflowing 32 bits bank counters
+#define HIST_MAX_CHUNK (1ULL << 30)
+
+namespace rir
+{
+	PixelHistogram::PixelHistogram()
+		: m_banks(HIST_BANKS * HIST_BINS, 0), m_fine(HIST_BINS, 0), m_coarse(256, 0), m_touched(256, 0), m_count(0), m_min(HIST_BINS), m_max(0)
+	{
+	}
+
+	void PixelHistogram::clear()
+	{
+		if (m_min <= m_max)
+			std::fill(m_fine.begin() + m_min, m_fine.begin() + m_max + 1, 0);
+		std::fill(m_coarse.begin(), m_coarse.end(), 0);
+		m_count = 0;
+		m_min = HIST_BINS;
+		m_max = 0;
+	}
+
+	void PixelHistogram::merge()
+	{
+		uint32_t *b0 = m_banks.data();
+		uint32_t *b1 = b0 + HIST_BINS;
+		uint32_t *b2 = b1 + HIST_BINS;
+		uint32_t *b3 = b2 + HIST_BINS;
+		uint64_t *fine = m_fine.data();
+		for (unsigned block = 0; block < 256; ++block)
+		{
+			if (!m_touched[block])
+				continue;
+			m_touched[block] = 0;
+
+			const unsigned start = block << 8;
+			// bank counters sum cannot overflow as chunks are limited to HIST_MAX_CHUNK pixels
+			uint32_t sum = 0;
+			for (unsigned v = start; v < start + 256; ++v)
+			{
+				uint32_t c = b0[v] + b1[v] + b2[v] + b3[v];
+				fine[v] += c;
+				sum += c;
+			}
+			memset(b0 + start, 0, 256 * sizeof(uint32_t));
+			memset(b1 + start, 0, 256 * sizeof(uint32_t));
+			memset(b2 + start, 0, 256 * sizeof(uint32_t));
+			memset(b3 + start, 0, 256 * sizeof(uint32_t));
+			m_coarse[block] += sum;
+			m_count += sum;
+			m_min = std::min(m_min, start);
+			m_max = std::max(m_max, start + 255);
+		}
+	}
+
+	void PixelHistogram::add(const unsigned short *pixels, size_t size)
+	{
+		uint32_t *b0 = m_banks.data();
+		uint32_t *b1 = b0 + HIST_BINS;
+		uint32_t *b2 = b1 + HIST_BINS;
+		uint32_t *b3 = b2 + HIST_BINS;
+		unsigned char *touched = m_touched.data();
+
+		for (size_t start = 0; start < size; start += HIST_MAX_CHUNK)
+		{
+			const unsigned short *p = pixels + start;
+			const size_t s = std::min((size_t)HIST_MAX_CHUNK, size - start);
+			size_t i = 0;
+			for (; i + 4 <= s; i += 4)
+			{
+				b0[p[i]]++;
+				b1[p[i + 1]]++;
+				b2[p[i + 2]]++;
+				b3[p[i + 3]]++;
+				touched[p[i] >> 8] = touched[p[i + 1] >> 8] = touched[p[i + 2] >> 8] = touched[p[i + 3] >> 8] = 1;
+			}
+			for (; i < s; ++i)
+			{
+				b0[p[i]]++;
+				touched[p[i] >> 8] = 1;
+			}
+			merge();
+		}
+	}
+
+	void PixelHistogram::add(const unsigned short *pixels, const unsigned char *mask, size_t size)
+	{
+		uint32_t *b0 = m_banks.data();
+		uint32_t *b1 = b0 + HIST_BINS;
+		uint32_t *b2 = b1 + HIST_BINS;
+		uint32_t *b3 = b2 + HIST_BINS;
+		unsigned char *touched = m_touched.data();
+
+		for (size_t start = 0; start < size; start += HIST_MAX_CHUNK)
+		{
+			const unsigned short *p = pixels + start;
+			const unsigned char *m = mask + start;
+			const size_t s = std::min((size_t)HIST_MAX_CHUNK, size - start);
+			// branchless: masked out pixels add 0
+			size_t i = 0;
+			for (; i + 4 <= s; i += 4)
+			{
+				b0[p[i]] += m[i] != 0;
+				b1[p[i + 1]] += m[i + 1] != 0;
+				b2[p[i + 2]] += m[i + 2] != 0;
+				b3[p[i + 3]] += m[i + 3] != 0;
+				touched[p[i] >> 8] = touched[p[i + 1] >> 8] = touched[p[i + 2] >> 8] = touched[p[i + 3] >> 8] = 1;
+			}
+			for (; i < s; ++i)
+			{
+				b0[p[i]] += m[i] != 0;
+				touched[p[i] >> 8] = 1;
+			}
+			merge();
+		}
+	}
+
+	void PixelHistogram::quantiles(const double *q, unsigned short *out, int n) const
+	{
+		// process targets in increasing order to walk the histogram only once
+		std::vector<std::pair<uint64_t, int>> targets(n);
+		for (int i = 0; i < n; ++i)
+		{
+			double t = std::round((double)m_count * q[i]);
+			targets[i].first = t <= 0 ? 0 : (uint64_t)t;
+			targets[i].second = i;
+		}
+		std::sort(targets.begin(), targets.end());
+
+		unsigned c = m_min <= m_max ? (m_min >> 8) : 256;
+		uint64_t cum = 0; // number of pixels before coarse bin c
+		for (int i = 0; i < n; ++i)
+		{
+			// q > 1 gives the largest accumulated value
+			const uint64_t t = std::min(targets[i].first, m_count);
+			const int index = targets[i].second;
+			if (t == 0)
+			{
+				out[index] = 0;
+				continue;
+			}
+			while (cum + m_coarse[c] < t)
+				cum += m_coarse[c++];
+			uint64_t f = cum;
+			unsigned v = c << 8;
+			while (f + m_fine[v] < t)
+				f += m_fine[v++];
+			out[index] = (unsigned short)v;
+		}
+	}
+
+	unsigned short PixelHistogram::quantile(double q) const
+	{
+		unsigned short res = 0;
+		quantiles(&q, &res, 1);
+		return res;
+	}
+
+}
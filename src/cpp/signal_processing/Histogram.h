@@ -0,0 +1,70 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+#include "Primitives.h"
+
+/** @file
+
+Histogram of unsigned short images used for quantile computation
+*/
+
+namespace rir
+{
+	/**
+	Full resolution histogram of unsigned short pixels.
+
+	Pixels are accumulated with add(), possibly over several frames, until clear() is called.
+	Bins are organized in 256 coarse bins of 256 fine bins, so that a quantile lookup costs at most 512 bin visits.
+
+	Histogram construction spreads consecutive pixels over 4 banks to avoid serializing increments
+	on images with a narrow value range (very common with IR images). Banks are merged back
+	only for the coarse bins actually touched by the data.
+	The object is meant to be reused: clear() only resets the bins that were used.
+	*/
+	class SIGNAL_PROCESSING_EXPORT PixelHistogram
+	{
+	public:
+		PixelHistogram();
+
+		/** Reset the histogram */
+		void clear();
+		/** Accumulate \a size pixels */
+		void add(const unsigned short *pixels, size_t size);
+		/** Accumulate \a size pixels for which mask is not 0 */
+		void add(const unsigned short *pixels, const unsigned char *mask, size_t size);
+
+		/** Number of accumulated pixels */
+		uint64_t count() const { return m_count; }
+		/** Number of accumulated pixels with given value */
+		uint64_t binCount(unsigned short value) const { return m_fine[value]; }
+
+		/**
+		Returns the smallest value v such that the number of pixels <= v is at least round(count()*q).
+		Like the former findMedianPixel(), returns 0 when round(count()*q) is 0 (q close to 0 or empty histogram).
+		Returns the largest accumulated value for q > 1.
+		*/
+		unsigned short quantile(double q) const;
+		/**
+		Compute \a n quantiles in one pass
+		*/
+		void quantiles(const double *q, unsigned short *out, int n) const;
+
+	private:
+		void merge();
+
+		std::vector<uint32_t> m_banks;
+		std::vector<uint64_t> m_fine;
+		std::vector<uint64_t> m_coarse;
+		// coarse bins touched since last merge
+		std::vector<unsigned char> m_touched;
+		uint64_t m_count;
+		// all values are within [m_min, m_max]
+		unsigned m_min;
+		unsigned m_max;
+	};
+
+}
+
+#endif
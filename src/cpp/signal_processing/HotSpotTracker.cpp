@@ -0,0 +1,122 @@
+#include "HotSpotTracker.h"
+
+#include <tuple>
+#include "Polygon.h"
+
+namespace rir
+{
+	HotSpotTracker::HotSpotTracker(double min_overlap, int min_area, bool compute_polygons)
+		: m_min_overlap(min_overlap), m_min_area(min_area), m_compute_polygons(compute_polygons), m_frame(0), m_width(0), m_height(0)
+	{
+	}
+
+	void HotSpotTracker::reset()
+	{
+		m_tracks.clear();
+		m_prev_labels.clear();
+		m_prev_tracks.clear();
+		m_frame = 0;
+		m_width = m_height = 0;
+	}
+
+	void HotSpotTracker::addLabels(const int *labels, int w, int h, const std::vector<LabelStats> &stats, double time)
+	{
+		const int label_count = (int)stats.size();
+		const bool has_prev = m_prev_labels.size() > 0 && w == m_width && h == m_height;
+
+		// overlaps between current labels and previous frame tracks, as (overlap, label, track)
+		std::vector<std::tuple<size_t, int, int>> candidates;
+		if (has_prev)
+		{
+			std::vector<std::pair<int, size_t>> counts;
+			for (int l = 1; l < label_count; ++l)
+			{
+				const LabelStats &s = stats[l];
+				if ((int)s.area < m_min_area)
+					continue;
+				// only scan the label bounding box
+				counts.clear();
+				for (signed_integral y = s.bbox.ymin; y < s.bbox.ymax; ++y)
+					for (signed_integral x = s.bbox.xmin; x < s.bbox.xmax; ++x)
+					{
+						const size_t i = x + y * w;
+						if (labels[i] != l || m_prev_labels[i] <= 0)
+							continue;
+						const int track = m_prev_tracks[m_prev_labels[i]];
+						if (track < 0)
+							continue;
+						auto it = std::find_if(counts.begin(), counts.end(), [track](const std::pair<int, size_t> &c)
+											   { return c.first == track; });
+						if (it == counts.end())
+							counts.push_back(std::make_pair(track, (size_t)1));
+						else
+							++it->second;
+					}
+				for (const auto &c : counts)
+				{
+					const size_t prev_area = m_tracks[c.first].samples.back().area;
+					if (c.second >= m_min_overlap * std::min(s.area, prev_area))
+						candidates.push_back(std::make_tuple(c.second, l, c.first));
+				}
+			}
+		}
+		else
+		{
+			// new image size: close all tracks
+			for (Track &t : m_tracks)
+				t.active = false;
+		}
+
+		// greedy association by decreasing overlap
+		std::sort(candidates.begin(), candidates.end(), [](const std::tuple<size_t, int, int> &a, const std::tuple<size_t, int, int> &b)
+				  { return std::get<0>(a) > std::get<0>(b); });
+		std::vector<int> label_tracks(label_count, -1);
+		std::vector<char> matched(m_tracks.size(), 0);
+		for (const auto &c : candidates)
+		{
+			const int l = std::get<1>(c);
+			const int track = std::get<2>(c);
+			if (label_tracks[l] < 0 && !matched[track])
+			{
+				label_tracks[l] = track;
+				matched[track] = 1;
+			}
+		}
+		for (size_t i = 0; i < matched.size(); ++i)
+			if (!matched[i])
+				m_tracks[i].active = false;
+
+		// new tracks and samples
+		for (int l = 1; l < label_count; ++l)
+		{
+			const LabelStats &s = stats[l];
+			if ((int)s.area < m_min_area)
+				continue;
+			if (label_tracks[l] < 0)
+			{
+				label_tracks[l] = (int)m_tracks.size();
+				Track t;
+				t.id = (int)m_tracks.size();
+				t.active = true;
+				m_tracks.push_back(t);
+			}
+			Sample sample;
+			sample.frame = m_frame;
+			sample.time = time;
+			sample.area = s.area;
+			sample.max_value = s.max_value;
+			sample.centroid = s.centroid;
+			sample.bbox = s.bbox;
+			if (m_compute_polygons)
+				detail::startPoint(s.first, sample.polygon, w, h, labels, l);
+			m_tracks[label_tracks[l]].samples.push_back(std::move(sample));
+		}
+
+		m_prev_labels.assign(labels, labels + (size_t)w * h);
+		m_prev_tracks.swap(label_tracks);
+		m_width = w;
+		m_height = h;
+		++m_frame;
+	}
+
+}
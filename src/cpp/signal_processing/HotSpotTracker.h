@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include "Filters.h"
+
+/** @file
+ */
+
+namespace rir
+{
+	/**
+	 * Temporal tracking of hot spots (connected regions of a mask) across consecutive frames.
+	 *
+	 * Each frame is labelled (see labelImageStats()), and each label is associated to the tracked object
+	 * of the previous frame it overlaps the most. Associations are performed greedily by decreasing overlap,
+	 * and require an overlap of at least min_overlap times the smallest of both areas.
+	 * Labels that are not associated start a new track, and tracks without association in a frame are closed.
+	 *
+	 * Each track stores the time series of its area, maximum value, centroid, bounding box and optionally
+	 * its bounding polygon (see extractPolygon()).
+	 */
+	class SIGNAL_PROCESSING_EXPORT HotSpotTracker : public BaseShared
+	{
+	public:
+		struct Sample
+		{
+			int frame;
+			double time;
+			size_t area;
+			double max_value;
+			PointF centroid;
+			Rect bbox;
+			Polygon polygon;
+		};
+		struct Track
+		{
+			int id;
+			// false once the object disappeared
+			bool active;
+			std::vector<Sample> samples;
+		};
+
+		HotSpotTracker(double min_overlap = 0.1, int min_area = 1, bool compute_polygons = false);
+		~HotSpotTracker() {}
+
+		/**
+		 * Remove all tracks
+		 */
+		void reset();
+
+		/**
+		 * Add a frame given as a mask image: pixels different from \a background are labelled,
+		 * and \a values (optional, same size as mask) is used to compute the maximum value of each hot spot.
+		 */
+		template <class T>
+		void addImage(const T *mask, int w, int h, T background, const float *values, double time)
+		{
+			m_labels.resize((size_t)w * h);
+			std::vector<LabelStats> stats = labelImageStats(mask, m_labels.data(), w, h, background, values);
+			addLabels(m_labels.data(), w, h, stats, time);
+		}
+		/**
+		 * Add a frame already labelled with labelImageStats()
+		 */
+		void addLabels(const int *labels, int w, int h, const std::vector<LabelStats> &stats, double time);
+
+		/** Number of frames added since the last reset() */
+		int frameCount() const { return m_frame; }
+		/** Tracks sorted by creation */
+		const std::vector<Track> &tracks() const { return m_tracks; }
+
+	private:
+		double m_min_overlap;
+		int m_min_area;
+		bool m_compute_polygons;
+		int m_frame;
+		int m_width;
+		int m_height;
+		std::vector<Track> m_tracks;
+		// previous frame labels and corresponding track index (-1 if ignored)
+		std::vector<int> m_prev_labels;
+		std::vector<int> m_prev_tracks;
+		// labels buffer for addImage()
+		std::vector<int> m_labels;
+	};
+
+}
@@ -0,0 +1,102 @@
+#include "RoiStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace rir
+{
+	RoiStatistics::RoiStatistics(int width, int height)
+		: m_width(width), m_height(height), m_roi_start(1, 0)
+	{
+	}
+
+	int RoiStatistics::addPolygon(const Point *pts, size_t size)
+	{
+		std::vector<PixelSpan> spans = polygonSpans(pts, size, Rect(0, m_width, 0, m_height));
+		size_t count = 0;
+		for (const PixelSpan &s : spans)
+			count += s.x1 - s.x0;
+		m_spans.insert(m_spans.end(), spans.begin(), spans.end());
+		m_roi_start.push_back(m_spans.size());
+		m_pixel_count.push_back(count);
+		return roiCount() - 1;
+	}
+
+	size_t RoiStatistics::pixelCount(int roi) const
+	{
+		if (roi < 0 || roi >= roiCount())
+			return 0;
+		return m_pixel_count[roi];
+	}
+
+	template <class T>
+	void RoiStatistics::computeInternal(const T *imgs, int count, RoiStats *out, double percent) const
+	{
+		const int roi_count = roiCount();
+		const size_t image_size = (size_t)m_width * m_height;
+		const bool use_percent = percent >= 0 && percent <= 1;
+
+#pragma omp parallel for if (count > 1)
+		for (int i = 0; i < count; ++i)
+		{
+			const T *img = imgs + i * image_size;
+			// ROI pixels, only used for percentile
+			std::vector<T> values;
+			for (int r = 0; r < roi_count; ++r)
+			{
+				RoiStats &st = out[(size_t)i * roi_count + r];
+				st.count = m_pixel_count[r];
+				st.mean = st.min = st.max = st.percentile = 0;
+				if (st.count == 0)
+					continue;
+
+				double sum = 0;
+				T min = std::numeric_limits<T>::max();
+				T max = std::numeric_limits<T>::lowest();
+				if (use_percent)
+					values.clear();
+				for (size_t s = m_roi_start[r]; s < m_roi_start[r + 1]; ++s)
+				{
+					const PixelSpan &sp = m_spans[s];
+					const T *p = img + sp.y * m_width + sp.x0;
+					const T *end = img + sp.y * m_width + sp.x1;
+					for (; p != end; ++p)
+					{
+						sum += *p;
+						min = std::min(min, *p);
+						max = std::max(max, *p);
+					}
+					if (use_percent)
+						values.insert(values.end(), img + sp.y * m_width + sp.x0, end);
+				}
+				st.mean = sum / st.count;
+				st.min = min;
+				st.max = max;
+				if (use_percent)
+				{
+					// same rank as findMedianPixel(): 0 when round(count*percent) is 0
+					double t = std::round((double)values.size() * percent);
+					if (t < 1)
+						st.percentile = 0;
+					else
+					{
+						size_t k = (size_t)t - 1;
+						std::nth_element(values.begin(), values.begin() + k, values.end());
+						st.percentile = values[k];
+					}
+				}
+			}
+		}
+	}
+
+	void RoiStatistics::compute(const unsigned short *imgs, int count, RoiStats *out, double percent) const
+	{
+		computeInternal(imgs, count, out, percent);
+	}
+	void RoiStatistics::compute(const float *imgs, int count, RoiStats *out, double percent) const
+	{
+		computeInternal(imgs, count, out, percent);
+	}
+
+}
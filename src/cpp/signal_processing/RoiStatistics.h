@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include "DrawPolygon.h"
+
+/** @file
+ */
+
+namespace rir
+{
+	/**
+	 * Statistics of an image inside a ROI
+	 */
+	struct RoiStats
+	{
+		size_t count;
+		double mean;
+		double min;
+		double max;
+		// requested percentile, 0 if not computed
+		double percentile;
+	};
+
+	/**
+	 * Compute statistics of several ROIs over a stream of images.
+	 *
+	 * ROIs are rasterized once into sorted pixel spans (see polygonSpans()), and statistics are then
+	 * computed directly on the images spans without building any mask.
+	 * Pixel count, mean, min and max are computed in one pass over the spans. The percentile follows
+	 * findMedianPixel() definition (smallest value v such that at least round(count*percent) pixels
+	 * are <= v, or 0 when round(count*percent) is 0) and requires a copy of the ROI pixels, so it is only computed on demand.
+	 */
+	class SIGNAL_PROCESSING_EXPORT RoiStatistics : public BaseShared
+	{
+	public:
+		RoiStatistics(int width, int height);
+		~RoiStatistics() {}
+
+		int width() const { return m_width; }
+		int height() const { return m_height; }
+
+		/**
+		 * Add a polygon ROI and returns its index.
+		 * Pixels are the ones drawn by drawPolygon() inside the image.
+		 */
+		int addPolygon(const Point *pts, size_t size);
+		/** Number of ROIs */
+		int roiCount() const { return (int)m_roi_start.size() - 1; }
+		/** Number of pixels of given ROI */
+		size_t pixelCount(int roi) const;
+
+		/**
+		 * Compute the statistics of all ROIs on \a count contiguous images.
+		 * \a out must hold count * roiCount() values, ordered by image then by ROI.
+		 * If \a percent is in [0, 1], the corresponding percentile is computed as well.
+		 */
+		void compute(const unsigned short *imgs, int count, RoiStats *out, double percent = -1) const;
+		void compute(const float *imgs, int count, RoiStats *out, double percent = -1) const;
+
+	private:
+		template <class T>
+		void computeInternal(const T *imgs, int count, RoiStats *out, double percent) const;
+
+		int m_width;
+		int m_height;
+		// spans of all ROIs
+		std::vector<PixelSpan> m_spans;
+		// first span of each ROI, plus total span count
+		std::vector<size_t> m_roi_start;
+		std::vector<size_t> m_pixel_count;
+	};
+
+}
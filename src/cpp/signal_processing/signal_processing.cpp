@@ -2,6 +2,10 @@
 #include "Filters.h"
 #include "tools.h"
 #include "BadPixels.h"
+#include "Histogram.h"
+#include "HotSpotTracker.h"
+#include "RoiStatistics.h"
+#include "Log.h"
 // #include "charls.h"
 
 extern "C"
@@ -11,6 +15,21 @@ extern "C"
 
 using namespace rir;
 
+// unsigned short and float images use the specialized translateImage() kernel
+template <class T>
+static void translate_dispatch(T *src, T *dst, T back, int w, int h, float dx, float dy, TranslateBorder strategy)
+{
+	translate(src, dst, back, w, h, dx, dy, strategy);
+}
+static void translate_dispatch(unsigned short *src, unsigned short *dst, unsigned short back, int w, int h, float dx, float dy, TranslateBorder strategy)
+{
+	translateImage(src, dst, w, h, dx, dy, strategy, back);
+}
+static void translate_dispatch(float *src, float *dst, float back, int w, int h, float dx, float dy, TranslateBorder strategy)
+{
+	translateImage(src, dst, w, h, dx, dy, strategy, back);
+}
+
 template <class T>
 int translate_internal(void *src, void *dst, int w, int h, float dx, float dy, void *background, const char *strategy)
 {
@@ -19,22 +38,22 @@ int translate_internal(void *src, void *dst, int w, int h, float dx, float dy, v
 	T *_dst = (T *)dst;
 	if (!strategy || strcmp(strategy, "noborder") == 0 || strlen(strategy) == 0)
 	{
-		translate(_src, _dst, back, w, h, dx, dy, TranslateUnchanged);
+		translate_dispatch(_src, _dst, back, w, h, dx, dy, TranslateUnchanged);
 		return 0;
 	}
 	else if (strcmp(strategy, "background") == 0)
 	{
-		translate(_src, _dst, back, w, h, dx, dy, TranslateConstant);
+		translate_dispatch(_src, _dst, back, w, h, dx, dy, TranslateConstant);
 		return 0;
 	}
 	else if (strcmp(strategy, "wrap") == 0)
 	{
-		translate(_src, _dst, back, w, h, dx, dy, TranslateWrap);
+		translate_dispatch(_src, _dst, back, w, h, dx, dy, TranslateWrap);
 		return 0;
 	}
 	else if (strcmp(strategy, "nearest") == 0)
 	{
-		translate(_src, _dst, back, w, h, dx, dy, TranslateNearest);
+		translate_dispatch(_src, _dst, back, w, h, dx, dy, TranslateNearest);
 		return 0;
 	}
 	else
@@ -72,78 +91,19 @@ int translate(int type, void *src, void *dst, int w, int h, float dx, float dy,
 	}
 }
 
-#ifndef M_PI
-#define M_PI 0.318309886183790671538
-#endif
-
-static void generate_kernel(float sigma, float *dst, int radius)
+int gaussian_filter(float *src, float *dst, int w, int h, float sigma)
 {
-	float s = 2.0f * sigma * sigma;
-	float sum = 0.0;
-	int w = radius * 2 + 1;
-
-	// generate kernel
-	for (int x = -radius; x <= radius; x++)
-	{
-		for (int y = -radius; y <= radius; y++)
-		{
-			float r = (float)std::sqrt(x * x + y * y);
-			dst[x + radius + (y + radius) * w] = (float)((std::exp(-(r * r) / s)) / (M_PI * s));
-			sum += dst[x + radius + (y + radius) * w];
-		}
-	}
-	// normalize kernel
-	int size = w * w;
-	for (int i = 0; i < size; ++i)
-		dst[i] /= sum;
+	if (w <= 0 || h <= 0)
+		return -1;
+	gaussianFilter(src, dst, w, h, sigma, GaussianFIR);
+	return 0;
 }
 
-int gaussian_filter(float *src, float *dst, int w, int h, float sigma)
+int gaussian_filter_stack(float *src, float *dst, int w, int h, int count, float sigma, int method)
 {
-	int radius = (int)(sigma * 2);
-	if (radius < 1)
-		radius = 1;
-	int kernel_w = (radius * 2 + 1);
-
-	std::vector<float> kernel(kernel_w * kernel_w);
-	generate_kernel(sigma, kernel.data(), radius);
-
-#pragma omp parallel for
-	for (int y = 0; y < h; ++y)
-		for (int x = 0; x < w; ++x)
-		{
-
-			if (x >= radius && x < w - radius && y >= radius && y < h - radius)
-			{
-				// simple convolution
-				float res = 0;
-				for (int dx = -radius; dx <= radius; ++dx)
-					for (int dy = -radius; dy <= radius; ++dy)
-					{
-						res += kernel[dx + radius + (dy + radius) * kernel_w] * src[x + dx + (y + dy) * w];
-					}
-				dst[x + y * w] = res;
-			}
-			else
-			{
-				// border convolution
-				float res = 0;
-				float sum = 0;
-				for (int dx = -radius; dx <= radius; ++dx)
-					for (int dy = -radius; dy <= radius; ++dy)
-					{
-						int _x = x + dx;
-						int _y = y + dy;
-						if (_x >= 0 && _x < w && _y >= 0 && _y < h)
-						{
-							float k = kernel[dx + radius + (dy + radius) * kernel_w];
-							sum += k;
-							res += k * src[_x + _y * w];
-						}
-					}
-				dst[x + y * w] = res / sum;
-			}
-		}
+	if (w <= 0 || h <= 0 || count <= 0 || method < GaussianFIR || method > GaussianAuto)
+		return -1;
+	gaussianFilterStack(src, dst, w, h, count, sigma, method);
 	return 0;
 }
 
@@ -157,6 +117,25 @@ int find_median_pixel_mask(unsigned short *pixels, unsigned char *mask, int size
 	return findMedianPixelMask(pixels, size, percent, mask);
 }
 
+int find_quantiles(unsigned short *pixels, unsigned char *mask, int size, int count, float *percents, int quantile_count, int *out)
+{
+	if (size <= 0 || count <= 0 || quantile_count <= 0)
+		return -1;
+	PixelHistogram hist;
+	for (int i = 0; i < count; ++i)
+	{
+		if (mask)
+			hist.add(pixels + (size_t)i * size, mask, size);
+		else
+			hist.add(pixels + (size_t)i * size, size);
+	}
+	std::vector<double> q(percents, percents + quantile_count);
+	std::vector<unsigned short> res(quantile_count);
+	hist.quantiles(q.data(), res.data(), quantile_count);
+	std::copy(res.begin(), res.end(), out);
+	return 0;
+}
+
 int extract_times(double *vectors, int vector_count, int *_vector_sizes, int s, double *output, int *output_size)
 {
 	std::vector<const double *> in_vectors(vector_count);
@@ -212,6 +191,64 @@ int bad_pixels_correct(int handle, unsigned short *in, unsigned short *out)
 	bp->correct(in, out);
 	return 0;
 }
+int bad_pixels_create_from_stack(unsigned short *images, int count, int width, int height, double std_factor)
+{
+	if (count <= 0 || width <= 0 || height <= 0)
+		return 0;
+	std::shared_ptr<BadPixels> bp(new BadPixels());
+
+	bp->initFromStack(images, count, width, height, std_factor);
+	return set_void_ptr(bp.get());
+}
+int bad_pixels_save(int handle, const char *filename)
+{
+	BadPixels *bp = (BadPixels *)get_void_ptr(handle);
+	if (!bp)
+		return -1;
+	if (!bp->save(filename))
+	{
+		RIR_LOG_ERROR("Unable to write bad pixels file %s", filename);
+		return -1;
+	}
+	return 0;
+}
+int bad_pixels_load(const char *filename)
+{
+	std::shared_ptr<BadPixels> bp(new BadPixels());
+	if (!bp->load(filename))
+	{
+		RIR_LOG_ERROR("Unable to read bad pixels file %s", filename);
+		return 0;
+	}
+	return set_void_ptr(bp.get());
+}
+int bad_pixels_coordinates(int handle, int *xy, int *size)
+{
+	BadPixels *bp = (BadPixels *)get_void_ptr(handle);
+	if (!bp)
+		return -1;
+	const Polygon &pixels = bp->badPixels();
+	if ((int)pixels.size() > *size)
+	{
+		*size = (int)pixels.size();
+		return -2;
+	}
+	for (size_t i = 0; i < pixels.size(); ++i)
+	{
+		xy[i * 2] = (int)pixels[i].x();
+		xy[i * 2 + 1] = (int)pixels[i].y();
+	}
+	*size = (int)pixels.size();
+	return 0;
+}
+int bad_pixels_set_low_value_threshold(int handle, int threshold)
+{
+	BadPixels *bp = (BadPixels *)get_void_ptr(handle);
+	if (!bp)
+		return -1;
+	bp->setLowValueThreshold(threshold);
+	return 0;
+}
 void bad_pixels_destroy(int handle)
 {
 	BadPixels *bp = (BadPixels *)get_void_ptr(handle);
@@ -267,12 +304,244 @@ int label_image(int type, void *src, int *dst, int w, int h, void *background, d
 	for (size_t i = 0; i < labels.size(); ++i)
 	{
 		out_xy[i * 2] = labels[i].first.x();
-		out_xy[i * 2 + 1] = labels[i].first.x();
+		out_xy[i * 2 + 1] = labels[i].first.y();
 		out_area[i] = labels[i].area;
 	}
 	return (int)labels.size();
 }
 
+template <class T>
+static int label_image_stats_internal(void *src, int *dst, int w, int h, void *background, const float *values, int capacity, int *out_area, int *out_bbox, double *out_centroid, double *out_max)
+{
+	std::vector<LabelStats> labels = rir::labelImageStats((T *)src, dst, w, h, *(T *)background, values);
+	if ((int)labels.size() > capacity)
+		return -2;
+	for (size_t i = 0; i < labels.size(); ++i)
+	{
+		const LabelStats &l = labels[i];
+		out_area[i] = (int)l.area;
+		out_bbox[i * 4] = (int)l.bbox.xmin;
+		out_bbox[i * 4 + 1] = (int)l.bbox.ymin;
+		out_bbox[i * 4 + 2] = (int)l.bbox.xmax;
+		out_bbox[i * 4 + 3] = (int)l.bbox.ymax;
+		out_centroid[i * 2] = l.centroid.x();
+		out_centroid[i * 2 + 1] = l.centroid.y();
+		out_max[i] = l.max_value;
+	}
+	return (int)labels.size();
+}
+
+int label_image_stats(int type, void *src, int *dst, int w, int h, void *background, const float *values, int capacity, int *out_area, int *out_bbox, double *out_centroid, double *out_max)
+{
+	switch (type)
+	{
+	case '?':
+		return label_image_stats_internal<bool>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'b':
+		return label_image_stats_internal<char>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'B':
+		return label_image_stats_internal<unsigned char>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'h':
+		return label_image_stats_internal<short>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'H':
+		return label_image_stats_internal<unsigned short>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'i':
+		return label_image_stats_internal<int>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'I':
+		return label_image_stats_internal<unsigned int>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'l':
+		return label_image_stats_internal<long long>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'L':
+		return label_image_stats_internal<unsigned long long>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'f':
+		return label_image_stats_internal<float>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	case 'd':
+		return label_image_stats_internal<double>(src, dst, w, h, background, values, capacity, out_area, out_bbox, out_centroid, out_max);
+	default:
+		return -1;
+	}
+}
+
+template <class T>
+static void hot_spot_tracker_add_internal(HotSpotTracker *t, void *src, int w, int h, void *background, const float *values, double time)
+{
+	t->addImage((const T *)src, w, h, *(T *)background, values, time);
+}
+
+int hot_spot_tracker_create(double min_overlap, int min_area, int compute_polygons)
+{
+	std::shared_ptr<HotSpotTracker> t(new HotSpotTracker(min_overlap, min_area, compute_polygons != 0));
+	return set_void_ptr(t.get());
+}
+int hot_spot_tracker_add_image(int handle, int type, void *src, int w, int h, void *background, const float *values, double time)
+{
+	HotSpotTracker *t = (HotSpotTracker *)get_void_ptr(handle);
+	if (!t || w <= 0 || h <= 0)
+		return -1;
+	switch (type)
+	{
+	case '?':
+		hot_spot_tracker_add_internal<bool>(t, src, w, h, background, values, time);
+		break;
+	case 'b':
+		hot_spot_tracker_add_internal<char>(t, src, w, h, background, values, time);
+		break;
+	case 'B':
+		hot_spot_tracker_add_internal<unsigned char>(t, src, w, h, background, values, time);
+		break;
+	case 'h':
+		hot_spot_tracker_add_internal<short>(t, src, w, h, background, values, time);
+		break;
+	case 'H':
+		hot_spot_tracker_add_internal<unsigned short>(t, src, w, h, background, values, time);
+		break;
+	case 'i':
+		hot_spot_tracker_add_internal<int>(t, src, w, h, background, values, time);
+		break;
+	case 'I':
+		hot_spot_tracker_add_internal<unsigned int>(t, src, w, h, background, values, time);
+		break;
+	case 'l':
+		hot_spot_tracker_add_internal<long long>(t, src, w, h, background, values, time);
+		break;
+	case 'L':
+		hot_spot_tracker_add_internal<unsigned long long>(t, src, w, h, background, values, time);
+		break;
+	case 'f':
+		hot_spot_tracker_add_internal<float>(t, src, w, h, background, values, time);
+		break;
+	case 'd':
+		hot_spot_tracker_add_internal<double>(t, src, w, h, background, values, time);
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+int hot_spot_tracker_track_count(int handle)
+{
+	HotSpotTracker *t = (HotSpotTracker *)get_void_ptr(handle);
+	if (!t)
+		return -1;
+	return (int)t->tracks().size();
+}
+int hot_spot_tracker_track_size(int handle, int track)
+{
+	HotSpotTracker *t = (HotSpotTracker *)get_void_ptr(handle);
+	if (!t || track < 0 || track >= (int)t->tracks().size())
+		return -1;
+	return (int)t->tracks()[track].samples.size();
+}
+int hot_spot_tracker_track(int handle, int track, int *frames, double *times, int *areas, double *max_values, double *centroids, int *bboxes)
+{
+	HotSpotTracker *t = (HotSpotTracker *)get_void_ptr(handle);
+	if (!t || track < 0 || track >= (int)t->tracks().size())
+		return -1;
+	const auto &samples = t->tracks()[track].samples;
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		const HotSpotTracker::Sample &s = samples[i];
+		frames[i] = s.frame;
+		times[i] = s.time;
+		areas[i] = (int)s.area;
+		max_values[i] = s.max_value;
+		centroids[i * 2] = s.centroid.x();
+		centroids[i * 2 + 1] = s.centroid.y();
+		bboxes[i * 4] = (int)s.bbox.xmin;
+		bboxes[i * 4 + 1] = (int)s.bbox.ymin;
+		bboxes[i * 4 + 2] = (int)s.bbox.xmax;
+		bboxes[i * 4 + 3] = (int)s.bbox.ymax;
+	}
+	return 0;
+}
+int hot_spot_tracker_polygon(int handle, int track, int sample, int *xy, int *point_count)
+{
+	HotSpotTracker *t = (HotSpotTracker *)get_void_ptr(handle);
+	if (!t || track < 0 || track >= (int)t->tracks().size())
+		return -1;
+	const auto &samples = t->tracks()[track].samples;
+	if (sample < 0 || sample >= (int)samples.size())
+		return -1;
+	const Polygon &poly = samples[sample].polygon;
+	if (*point_count < (int)poly.size())
+	{
+		*point_count = (int)poly.size();
+		return -2;
+	}
+	*point_count = (int)poly.size();
+	for (size_t i = 0; i < poly.size(); ++i)
+	{
+		xy[i * 2] = (int)poly[i].x();
+		xy[i * 2 + 1] = (int)poly[i].y();
+	}
+	return 0;
+}
+void hot_spot_tracker_destroy(int handle)
+{
+	HotSpotTracker *t = (HotSpotTracker *)get_void_ptr(handle);
+	if (t)
+		rm_void_ptr(handle);
+}
+
+int roi_stats_create(int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return 0;
+	std::shared_ptr<RoiStatistics> r(new RoiStatistics(width, height));
+	return set_void_ptr(r.get());
+}
+int roi_stats_add_polygon(int handle, const double *xy, int point_count)
+{
+	RoiStatistics *r = (RoiStatistics *)get_void_ptr(handle);
+	if (!r || point_count < 0)
+		return -1;
+	std::vector<Point> pts(point_count);
+	for (int i = 0; i < point_count; ++i)
+	{
+		pts[i].rx() = (int)std::round(xy[i * 2]);
+		pts[i].ry() = (int)std::round(xy[i * 2 + 1]);
+	}
+	return r->addPolygon(pts.data(), pts.size());
+}
+int roi_stats_count(int handle)
+{
+	RoiStatistics *r = (RoiStatistics *)get_void_ptr(handle);
+	if (!r)
+		return -1;
+	return r->roiCount();
+}
+int roi_stats_compute(int handle, int type, const void *imgs, int count, double percent, double *out)
+{
+	RoiStatistics *r = (RoiStatistics *)get_void_ptr(handle);
+	if (!r || count < 0)
+		return -1;
+	std::vector<RoiStats> stats((size_t)count * r->roiCount());
+	if (type == 'H')
+		r->compute((const unsigned short *)imgs, count, stats.data(), percent);
+	else if (type == 'f')
+		r->compute((const float *)imgs, count, stats.data(), percent);
+	else
+	{
+		RIR_LOG_ERROR("roi_stats_compute: unsupported image type %c", (char)type);
+		return -1;
+	}
+	for (size_t i = 0; i < stats.size(); ++i)
+	{
+		out[i * 5] = (double)stats[i].count;
+		out[i * 5 + 1] = stats[i].mean;
+		out[i * 5 + 2] = stats[i].min;
+		out[i * 5 + 3] = stats[i].max;
+		out[i * 5 + 4] = stats[i].percentile;
+	}
+	return 0;
+}
+void roi_stats_destroy(int handle)
+{
+	RoiStatistics *r = (RoiStatistics *)get_void_ptr(handle);
+	if (r)
+		rm_void_ptr(handle);
+}
+
 int keep_largest_area(int type, void *src, int *dst, int w, int h, void *background, int foreground)
 {
 	switch (type)
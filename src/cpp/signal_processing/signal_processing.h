@@ -31,6 +31,14 @@ extern "C"
     Gaussian filter, for python wrapper only
     */
     SIGNAL_PROCESSING_EXPORT int gaussian_filter(float *src, float *dst, int w, int h, float sigma);
+    /**
+    Gaussian filter on a stack of \a count contiguous images of size w*h.
+    \a method is 0 for separable convolution (same as gaussian_filter), 1 for recursive filtering
+    (constant cost whatever sigma), 2 to select the recursive filter for large sigma.
+    \a src and \a dst might be the same buffer.
+    Returns 0 on success, -1 on error.
+    */
+    SIGNAL_PROCESSING_EXPORT int gaussian_filter_stack(float *src, float *dst, int w, int h, int count, float sigma, int method);
 
     /**
      * Returns the median pixel for input image.
@@ -42,6 +50,13 @@ extern "C"
      * \a percent specify the requested percent quantile (0.5 for median).
      */
     SIGNAL_PROCESSING_EXPORT int find_median_pixel_mask(unsigned short *pixels, unsigned char *mask, int size, float percent = 0.5);
+    /**
+     * Compute \a quantile_count quantiles over \a count contiguous images of \a size pixels each.
+     * \a mask (possibly NULL) has \a size values and is applied to each image.
+     * Output values are written to \a out, see PixelHistogram::quantile() for the exact definition.
+     * Returns 0 on success, -1 on error.
+     */
+    SIGNAL_PROCESSING_EXPORT int find_quantiles(unsigned short *pixels, unsigned char *mask, int size, int count, float *percents, int quantile_count, int *out);
 
     /**
     Create a unique time vector from several ones.
@@ -82,6 +97,34 @@ extern "C"
      * Correct bad pixels on given image.
      */
     SIGNAL_PROCESSING_EXPORT int bad_pixels_correct(int handle, unsigned short *in, unsigned short *out);
+    /**
+     * Create a bad pixel correction object from \a count contiguous video images.
+     * Detects spatial outliers of the mean image as well as stuck and blinking pixels.
+     * returns the object handle on success, 0 on error.
+     */
+    SIGNAL_PROCESSING_EXPORT int bad_pixels_create_from_stack(unsigned short *images, int count, int width, int height, double std_factor);
+    /**
+     * Save the bad pixel map to a file.
+     * Returns 0 on success, -1 on error.
+     */
+    SIGNAL_PROCESSING_EXPORT int bad_pixels_save(int handle, const char *filename);
+    /**
+     * Create a bad pixel correction object from a file written with bad_pixels_save().
+     * returns the object handle on success, 0 on error.
+     */
+    SIGNAL_PROCESSING_EXPORT int bad_pixels_load(const char *filename);
+    /**
+     * Retrieve the bad pixel coordinates as interleaved x,y values.
+     * \a size is the capacity of \a xy in number of pixels, and is set to the number of bad pixels.
+     * Returns 0 on success, -1 on error, -2 if \a xy is too small.
+     */
+    SIGNAL_PROCESSING_EXPORT int bad_pixels_coordinates(int handle, int *xy, int *size);
+    /**
+     * Set the low value threshold used by bad_pixels_correct(): corrected images are clamped to this value.
+     * A value <= 0 disables the low value removal.
+     * Returns 0 on success, -1 on error.
+     */
+    SIGNAL_PROCESSING_EXPORT int bad_pixels_set_low_value_threshold(int handle, int threshold);
     /**
      * Destroy a bad pixel object based on its handle.
      */
@@ -89,8 +132,77 @@ extern "C"
 
     SIGNAL_PROCESSING_EXPORT int label_image(int type, void *src, int *dst, int w, int h, void *background, double *out_xy, int *out_area);
 
+    /**
+     * Label image like label_image(), and compute per label statistics in the same pass.
+     * \a values is an optional float image of size w*h used to compute the maximum value of each label.
+     * Outputs are indexed by label (index 0 being the background) and must hold at least \a capacity labels:
+     * area, bounding box as (xmin, ymin, xmax, ymax) with max excluded, centroid as (x, y), and maximum value.
+     * Returns the number of labels + 1, -1 on error, -2 if \a capacity is too small.
+     */
+    SIGNAL_PROCESSING_EXPORT int label_image_stats(int type, void *src, int *dst, int w, int h, void *background, const float *values, int capacity, int *out_area, int *out_bbox, double *out_centroid, double *out_max);
+
     SIGNAL_PROCESSING_EXPORT int keep_largest_area(int type, void *src, int *dst, int w, int h, void *background, int foreground);
 
+    /**
+     * Create a hot spot tracker and returns its handle (0 on error).
+     * See HotSpotTracker class for more details.
+     */
+    SIGNAL_PROCESSING_EXPORT int hot_spot_tracker_create(double min_overlap, int min_area, int compute_polygons);
+    /**
+     * Add a mask image (of given type) to the tracker, pixels different from \a background being hot spots.
+     * \a values is an optional float image used to compute the hot spots maximum values.
+     */
+    SIGNAL_PROCESSING_EXPORT int hot_spot_tracker_add_image(int handle, int type, void *src, int w, int h, void *background, const float *values, double time);
+    /**
+     * Returns the number of tracks, or -1 on error
+     */
+    SIGNAL_PROCESSING_EXPORT int hot_spot_tracker_track_count(int handle);
+    /**
+     * Returns the number of samples of given track, or -1 on error
+     */
+    SIGNAL_PROCESSING_EXPORT int hot_spot_tracker_track_size(int handle, int track);
+    /**
+     * Retrieve the time series of given track. Each output must hold hot_spot_tracker_track_size() samples:
+     * frame index, time, area, maximum value, centroid as (x, y), bounding box as (xmin, ymin, xmax, ymax) with max excluded.
+     */
+    SIGNAL_PROCESSING_EXPORT int hot_spot_tracker_track(int handle, int track, int *frames, double *times, int *areas, double *max_values, double *centroids, int *bboxes);
+    /**
+     * Retrieve the bounding polygon of given track sample as interleaved x,y values (polygons must be enabled at creation).
+     * \a point_count is the capacity of \a xy in number of points, and is set to the polygon size.
+     * Returns 0 on success, -1 on error, -2 if \a xy is too small.
+     */
+    SIGNAL_PROCESSING_EXPORT int hot_spot_tracker_polygon(int handle, int track, int sample, int *xy, int *point_count);
+    /**
+     * Destroy a hot spot tracker based on its handle.
+     */
+    SIGNAL_PROCESSING_EXPORT void hot_spot_tracker_destroy(int handle);
+
+    /**
+     * Create a ROI statistics object for images of size width*height, and returns its handle (0 on error).
+     * See RoiStatistics class for more details.
+     */
+    SIGNAL_PROCESSING_EXPORT int roi_stats_create(int width, int height);
+    /**
+     * Add a polygon ROI given as interleaved x,y values.
+     * Returns the ROI index, or -1 on error.
+     */
+    SIGNAL_PROCESSING_EXPORT int roi_stats_add_polygon(int handle, const double *xy, int point_count);
+    /**
+     * Returns the number of ROIs, or -1 on error.
+     */
+    SIGNAL_PROCESSING_EXPORT int roi_stats_count(int handle);
+    /**
+     * Compute the statistics of all ROIs on \a count contiguous images of type 'H' (unsigned short) or 'f' (float).
+     * \a out must hold count * roi_count * 5 values, ordered by image then by ROI:
+     * pixel count, mean, min, max and percentile (0 if \a percent is not in [0, 1]).
+     * Returns 0 on success, -1 on error.
+     */
+    SIGNAL_PROCESSING_EXPORT int roi_stats_compute(int handle, int type, const void *imgs, int count, double percent, double *out);
+    /**
+     * Destroy a ROI statistics object based on its handle.
+     */
+    SIGNAL_PROCESSING_EXPORT void roi_stats_destroy(int handle);
+
     SIGNAL_PROCESSING_EXPORT size_t hash_bytes(void* _ptr, size_t len);
 
 #ifdef __cplusplus
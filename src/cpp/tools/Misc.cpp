@@ -214,6 +214,26 @@ namespace rir
 		return fin.tellg();
 	}
 
+	long long file_mtime(const char *filename)
+	{
+#if defined(_WIN32)
+		struct _stat64 info;
+		if (_stat64(filename, &info) != 0)
+			return 0;
+		return (long long)info.st_mtime * 1000000000LL;
+#elif defined(__APPLE__)
+		struct stat info;
+		if (stat(filename, &info) != 0)
+			return 0;
+		return (long long)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+		struct stat info;
+		if (stat(filename, &info) != 0)
+			return 0;
+		return (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+	}
+
 	std::string read_file(const char *filename, bool *ok)
 	{
 		if (!filename) {
@@ -93,6 +93,8 @@ namespace rir
 
 	/**Returns file size (0 if it does not exist)*/
 	TOOLS_EXPORT size_t file_size(const char *filename);
+	/**Returns file last modification time in nanoseconds since epoch (0 if it does not exist)*/
+	TOOLS_EXPORT long long file_mtime(const char *filename);
 	/**Returns full file content in binary format.*/
 	TOOLS_EXPORT std::string read_file(const char *filename, bool *ok = NULL);
 	/**Returns true if given file exists*/
@@ -5,6 +5,17 @@
 #include <fstream>
 #include <map>
 #include <atomic>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
 
 #define TRAILER "CHUNKFILE"
 
@@ -225,6 +236,16 @@ namespace rir
 		int saved = buf_size;
 		uint8_t* buf = (uint8_t*)outbuf;
 
+		// directly addressable file: bypass the chunk buffer
+		if (reader->access.data)
+		{
+			if (reader->filePos < 0 || reader->filePos > reader->fileSize)
+				return -1;
+			memcpy(buf, reader->access.data + reader->filePos, buf_size);
+			reader->filePos += buf_size;
+			return saved;
+		}
+
 		// start chunk of requested block
 		int64_t chunk = reader->filePos / reader->chunkSize;
 		if (chunk != reader->currentChunk)
@@ -245,13 +266,27 @@ namespace rir
 			memcpy(out, reader->buffer + pos, rem);
 			out += rem;
 			reader->filePos += rem;
+			buf_size -= (int)rem;
+			++chunk;
+
+			// full chunks are read directly into the output buffer
+			while (buf_size > reader->chunkSize)
+			{
+				int64_t res = reader->access.read(reader->access.opaque, chunk, out);
+				if (res < 0)
+					return (int)res;
+				out += reader->chunkSize;
+				reader->filePos += reader->chunkSize;
+				buf_size -= (int)reader->chunkSize;
+				++chunk;
+			}
+
 			// read next chunk
-			int64_t res = reader->access.read(reader->access.opaque, ++chunk, reader->buffer);
+			int64_t res = reader->access.read(reader->access.opaque, chunk, reader->buffer);
 			if (res < 0)
 				return (int)res;
 			reader->currentChunk = chunk;
 			pos = 0;
-			buf_size -= (int)rem;
 			rem = reader->chunkSize;
 		}
 		memcpy(out, reader->buffer + pos, buf_size);
@@ -276,18 +311,21 @@ namespace rir
 		}
 		else if (whence == AVSEEK_SET)
 		{
-			res = reader->filePos = pos;
+			res = pos;
 		}
 		else if (whence == AVSEEK_CUR)
 		{
-			res = reader->filePos = reader->filePos + pos;
+			res = reader->filePos + pos;
 		}
 		else
 		{ // AVSEEK_END
-			res = reader->filePos = reader->fileSize - pos;
+			res = reader->fileSize - pos;
 		}
+		// invalid positions leave the reader unchanged
 		if (res < 0 || res > reader->fileSize)
 			return -1;
+		if (whence != AVSEEK_SIZE)
+			reader->filePos = res;
 		return res;
 	}
 
@@ -297,6 +335,27 @@ namespace rir
 		return reader->fileSize;
 	}
 
+	const uint8_t* fileData(FileReader* r)
+	{
+		FileReader* reader = (FileReader*)r;
+		return reader->access.data;
+	}
+
+	void prefetchFile(FileReader* r, int64_t offset, int64_t size)
+	{
+		FileReader* reader = (FileReader*)r;
+		if (!reader || !reader->access.data || offset < 0 || offset >= reader->fileSize || size <= 0)
+			return;
+		if (offset + size > reader->fileSize)
+			size = reader->fileSize - offset;
+#ifndef _WIN32
+		// madvise requires a page aligned address
+		static const int64_t page = (int64_t)sysconf(_SC_PAGESIZE);
+		int64_t start = offset - offset % page;
+		madvise((void*)(reader->access.data + start), (size_t)(size + offset - start), MADV_WILLNEED);
+#endif
+	}
+
 #include <fstream>
 
 	struct File
@@ -409,6 +468,180 @@ namespace rir
 		res.infos = &memoryInfos;
 		res.read = &readMemoryChunk;
 		res.opaque = f;
+		res.data = (const uint8_t*)data;
+		return res;
+	}
+
+
+	struct MappedFile
+	{
+		uint8_t* ptr;
+		int64_t size;
+#ifdef _WIN32
+		HANDLE file;
+		HANDLE mapping;
+#endif
+	};
+
+	void destroyOpaqueMappedHandle(void* opaque)
+	{
+		MappedFile* f = (MappedFile*)opaque;
+#ifdef _WIN32
+		UnmapViewOfFile(f->ptr);
+		CloseHandle(f->mapping);
+		CloseHandle(f->file);
+#else
+		munmap(f->ptr, (size_t)f->size);
+#endif
+		delete f;
+	}
+	int64_t readMappedChunk(void* opaque, int64_t chunk, uint8_t* buf)
+	{
+		MappedFile* f = (MappedFile*)opaque;
+		int64_t pos = chunk * MEM_BLOCK_CHUNK;
+		int64_t size = MEM_BLOCK_CHUNK;
+		if (pos >= f->size)
+			size = 0;
+		else if (pos + size >= f->size)
+			size = f->size - pos;
+		memcpy(buf, f->ptr + pos, size);
+		return size;
+	}
+	void mappedInfos(void* opaque, int64_t* fileSize, int64_t* chunkCount, int64_t* chunkSize)
+	{
+		MappedFile* f = (MappedFile*)opaque;
+		*fileSize = f->size;
+		*chunkCount = f->size / MEM_BLOCK_CHUNK + (f->size % MEM_BLOCK_CHUNK ? 1 : 0);
+		*chunkSize = MEM_BLOCK_CHUNK;
+	}
+
+	FileAccess createMappedFileAccess(const char* filename, int hint)
+	{
+		MappedFile* f = new MappedFile();
+		f->ptr = nullptr;
+		f->size = 0;
+#ifdef _WIN32
+		DWORD flags = FILE_ATTRIBUTE_NORMAL;
+		if (hint == FileAccessSequential)
+			flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+		else if (hint == FileAccessRandom)
+			flags |= FILE_FLAG_RANDOM_ACCESS;
+		f->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, flags, NULL);
+		f->mapping = NULL;
+		LARGE_INTEGER size;
+		if (f->file != INVALID_HANDLE_VALUE && GetFileSizeEx(f->file, &size) && size.QuadPart > 0)
+		{
+			f->size = size.QuadPart;
+			f->mapping = CreateFileMappingA(f->file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (f->mapping)
+				f->ptr = (uint8_t*)MapViewOfFile(f->mapping, FILE_MAP_READ, 0, 0, 0);
+		}
+		if (!f->ptr)
+		{
+			if (f->mapping)
+				CloseHandle(f->mapping);
+			if (f->file != INVALID_HANDLE_VALUE)
+				CloseHandle(f->file);
+			delete f;
+			return createFileAccess(filename);
+		}
+#else
+		int fd = ::open(filename, O_RDONLY);
+		struct stat st;
+		if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0 && (uint64_t)st.st_size <= (uint64_t)SIZE_MAX)
+		{
+			void* ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (ptr != MAP_FAILED)
+			{
+				f->ptr = (uint8_t*)ptr;
+				f->size = st.st_size;
+				int advice = hint == FileAccessSequential ? MADV_SEQUENTIAL : (hint == FileAccessRandom ? MADV_RANDOM : MADV_NORMAL);
+				madvise(ptr, (size_t)f->size, advice);
+			}
+		}
+		// the mapping stays valid after closing the file descriptor
+		if (fd >= 0)
+			::close(fd);
+		if (!f->ptr)
+		{
+			delete f;
+			return createFileAccess(filename);
+		}
+#endif
+
+		FileAccess res;
+		res.destroy = &destroyOpaqueMappedHandle;
+		res.infos = &mappedInfos;
+		res.read = &readMappedChunk;
+		res.opaque = f;
+		res.data = f->ptr;
+		return res;
+	}
+
+
+#define SHARED_CHUNK 65536
+
+	struct SharedSource
+	{
+		FileReaderPtr reader;
+		std::mutex mutex;
+	};
+
+	struct SharedAccess
+	{
+		std::shared_ptr<SharedSource> source;
+		int64_t size;
+	};
+
+	void destroyOpaqueSharedHandle(void* opaque)
+	{
+		SharedAccess* f = (SharedAccess*)opaque;
+		delete f;
+	}
+	int64_t readSharedChunk(void* opaque, int64_t chunk, uint8_t* buf)
+	{
+		SharedAccess* f = (SharedAccess*)opaque;
+		int64_t pos = chunk * SHARED_CHUNK;
+		int64_t size = SHARED_CHUNK;
+		if (pos >= f->size)
+			return 0;
+		else if (pos + size >= f->size)
+			size = f->size - pos;
+
+		std::lock_guard<std::mutex> lock(f->source->mutex);
+		if (seekFile(f->source->reader.get(), pos, AVSEEK_SET) < 0)
+			return -1;
+		return readFile(f->source->reader.get(), buf, (int)size);
+	}
+	void sharedInfos(void* opaque, int64_t* fileSize, int64_t* chunkCount, int64_t* chunkSize)
+	{
+		SharedAccess* f = (SharedAccess*)opaque;
+		*fileSize = f->size;
+		*chunkCount = f->size / SHARED_CHUNK + (f->size % SHARED_CHUNK ? 1 : 0);
+		*chunkSize = SHARED_CHUNK;
+	}
+
+	std::vector<FileReaderPtr> createSharedFileReaders(const FileReaderPtr& source, int count)
+	{
+		std::vector<FileReaderPtr> res;
+		if (!source || count <= 0)
+			return res;
+
+		std::shared_ptr<SharedSource> src(new SharedSource());
+		src->reader = source;
+		for (int i = 0; i < count; ++i)
+		{
+			SharedAccess* f = new SharedAccess();
+			f->source = src;
+			f->size = fileSize(source.get());
+
+			FileAccess access;
+			access.destroy = &destroyOpaqueSharedHandle;
+			access.infos = &sharedInfos;
+			access.read = &readSharedChunk;
+			access.opaque = f;
+			res.push_back(createFileReader(std::move(access)));
+		}
 		return res;
 	}
 
@@ -67,6 +67,7 @@ namespace rir
 		- read: read a full chunk into a destination buffer. This function should take care of the last chunk which is usually
 		smaller.
 		- destroy: destroy the opaque object.
+		- data: optional pointer to the whole file content when it is directly addressable (like a memory chunk), NULL otherwise.
 	*/
 	struct FileAccess
 	{
@@ -74,6 +75,7 @@ namespace rir
 		file_infos infos = nullptr;
 		read_chunk read = nullptr;
 		destroy_opaque destroy = nullptr;
+		const uint8_t* data = nullptr;
 
 		FileAccess() noexcept = default;
 		FileAccess(const FileAccess&) = delete;
@@ -81,11 +83,13 @@ namespace rir
 			:opaque(other.opaque),
 			infos(other.infos),
 			read(other.read),
-			destroy(other.destroy) {
+			destroy(other.destroy),
+			data(other.data) {
 				other.opaque  = nullptr;
 				other.infos   = nullptr;
 				other.read    = nullptr;
 				other.destroy = nullptr;
+				other.data    = nullptr;
 			}
 		FileAccess& operator=(const FileAccess& other) = delete;
 		FileAccess& operator=(FileAccess&& other) noexcept
@@ -94,11 +98,13 @@ namespace rir
 			infos   = other.infos;
 			read    = other.read;
 			destroy = other.destroy;
+			data    = other.data;
 
 			other.opaque  = nullptr;
 			other.infos   = nullptr;
 			other.read    = nullptr;
 			other.destroy = nullptr;
+			other.data    = nullptr;
 
 			return *this;
 		}
@@ -125,6 +131,8 @@ namespace rir
 		friend TOOLS_EXPORT int64_t seekFile(FileReader* file_reader, int64_t pos, int whence);
 		friend TOOLS_EXPORT int64_t posFile(FileReader* file_reader);
 		friend TOOLS_EXPORT int64_t fileSize(FileReader* file_reader);
+		friend TOOLS_EXPORT const uint8_t* fileData(FileReader* file_reader);
+		friend TOOLS_EXPORT void prefetchFile(FileReader* file_reader, int64_t offset, int64_t size);
 	public:
 		~FileReader()
 		{
@@ -145,12 +153,40 @@ namespace rir
 	*/
 	TOOLS_EXPORT FileAccess createMemoryAccess(void* data, int64_t size);
 
+	/**
+	Access pattern hint for #createMappedFileAccess()
+	*/
+	enum FileAccessHint
+	{
+		FileAccessNormal = 0,	  //! no particular access pattern
+		FileAccessSequential = 1, //! file mostly read sequentially: aggressive read-ahead (video loaders seek between frames and do not use it)
+		FileAccessRandom = 2	  //! random accesses: no read-ahead
+	};
+
+	/**
+	Create and return a FileAccess from a memory mapped local file.
+	Reads are served as direct copies from the mapping, and FileAccess::data points to the whole file content.
+	Falls back to #createFileAccess() if the file cannot be mapped.
+
+	The file size is captured when the mapping is created. The file must not be truncated while the
+	FileAccess is alive: on POSIX systems, touching a mapped page past the new end of file raises SIGBUS
+	(Windows refuses the truncation instead). Use #createFileAccess() for files that may shrink while being read.
+	*/
+	TOOLS_EXPORT FileAccess createMappedFileAccess(const char* filename, int hint = FileAccessNormal);
+
 	/**
 	Create a file reader object from a #FileAccess object.
 	This file reader can be passed to the librir function #open_camera_file_reader().
 	*/
 	TOOLS_EXPORT FileReaderPtr createFileReader(FileAccess&& access);
 
+	/**
+	Create \a count file readers reading the same \a source.
+	Accesses to the source are serialized with a mutex, so that each returned file reader can be used from a different thread.
+	The source file reader must not be used directly while the returned file readers are alive.
+	*/
+	TOOLS_EXPORT std::vector<FileReaderPtr> createSharedFileReaders(const FileReaderPtr& source, int count);
+
 
 	/**
 	Read \a buf_size bytes from \a file_reader starting to the current position (see #seekFile and #posFile) into \a buf.
@@ -176,6 +212,20 @@ namespace rir
 	*/
 	TOOLS_EXPORT int64_t fileSize(FileReader* file_reader);
 	static inline int64_t fileSize(FileReaderPtr& file_reader) { return fileSize(file_reader.get()); }
+	/**
+	Returns a pointer to the whole file content if the underlying #FileAccess is directly addressable
+	(see FileAccess::data), NULL otherwise. The pointer remains valid as long as the file reader is alive.
+	For memory mapped files, reading through this pointer after the file was truncated raises SIGBUS
+	(see #createMappedFileAccess()).
+	*/
+	TOOLS_EXPORT const uint8_t* fileData(FileReader* file_reader);
+	static inline const uint8_t* fileData(FileReaderPtr& file_reader) { return fileData(file_reader.get()); }
+	/**
+	Tell the file reader that the range [offset, offset + size) will be read soon.
+	For memory mapped files, this starts reading the range asynchronously. Does nothing for other file readers.
+	*/
+	TOOLS_EXPORT void prefetchFile(FileReader* file_reader, int64_t offset, int64_t size);
+	static inline void prefetchFile(FileReaderPtr& file_reader, int64_t offset, int64_t size) { prefetchFile(file_reader.get(), offset, size); }
 
 
 }
\ No newline at end of file
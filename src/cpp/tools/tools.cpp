@@ -374,6 +374,24 @@ int64_t zstd_decompress(char *src, int64_t srcSize, char *dst, int64_t dstSize)
 		return -1;
 	return ret;
 }
+void *zstd_create_decompression_context()
+{
+	return ZSTD_createDCtx();
+}
+void zstd_free_decompression_context(void *ctx)
+{
+	if (ctx)
+		ZSTD_freeDCtx((ZSTD_DCtx *)ctx);
+}
+int64_t zstd_decompress_with_context(void *ctx, const char *src, int64_t srcSize, char *dst, int64_t dstSize)
+{
+	if (!ctx)
+		return -1;
+	size_t ret = ZSTD_decompressDCtx((ZSTD_DCtx *)ctx, dst, dstSize, src, srcSize);
+	if (ZSTD_isError(ret))
+		return -1;
+	return ret;
+}
 
 int unzip(const char *infile, const char *outfolder)
 {
@@ -187,6 +187,14 @@ Log levels
     TOOLS_EXPORT int64_t zstd_compress(char *src, int64_t srcSize, char *dst, int64_t dstSize, int level);
     TOOLS_EXPORT int64_t zstd_decompress(char *src, int64_t srcSize, char *dst, int64_t dstSize);
 
+    /**
+    Reusable zstd decompression context, avoiding a context allocation for each decompression.
+    A context must not be used by several threads at the same time.
+    */
+    TOOLS_EXPORT void *zstd_create_decompression_context();
+    TOOLS_EXPORT void zstd_free_decompression_context(void *ctx);
+    TOOLS_EXPORT int64_t zstd_decompress_with_context(void *ctx, const char *src, int64_t srcSize, char *dst, int64_t dstSize);
+
       TOOLS_EXPORT int unzip(const char *infile, const char *outfolder);
 
 #ifdef __cplusplus
@@ -112,6 +112,324 @@ namespace rir
 
 		mapper["Header"] = std::string((char *)&h, sizeof(h));
 	}
+	/// Numerical field of HCCImageHeader
+	enum HCCFieldType
+	{
+		HCC_U8,
+		HCC_I8,
+		HCC_U16,
+		HCC_I16,
+		HCC_U32,
+		HCC_I32,
+		HCC_F32
+	};
+	struct HCCHeaderField
+	{
+		const char *name;
+		size_t offset;
+		int type;
+		double scale;
+	};
+	static const HCCHeaderField hcc_fields[] = {
+		{"DeviceXMLMinorVersion", offsetof(HCCImageHeader, DeviceXMLMinorVersion), HCC_U8, 1.},
+		{"DeviceXMLMajorVersion", offsetof(HCCImageHeader, DeviceXMLMajorVersion), HCC_U8, 1.},
+		{"ImageHeaderLength", offsetof(HCCImageHeader, ImageHeaderLength), HCC_U16, 1.},
+		{"FrameID", offsetof(HCCImageHeader, FrameID), HCC_U32, 1.},
+		{"DataOffset", offsetof(HCCImageHeader, DataOffset), HCC_F32, 1.},
+		{"DataExp", offsetof(HCCImageHeader, DataExp), HCC_I8, 1.},
+		{"ExposureTime", offsetof(HCCImageHeader, ExposureTime), HCC_U32, 1e-8},
+		{"CalibrationMode", offsetof(HCCImageHeader, CalibrationMode), HCC_U8, 1.},
+		{"BPRApplied", offsetof(HCCImageHeader, BPRApplied), HCC_U8, 1.},
+		{"FrameBufferMode", offsetof(HCCImageHeader, FrameBufferMode), HCC_U8, 1.},
+		{"CalibrationBlockIndex", offsetof(HCCImageHeader, CalibrationBlockIndex), HCC_U8, 1.},
+		{"Width", offsetof(HCCImageHeader, Width), HCC_U16, 1.},
+		{"Height", offsetof(HCCImageHeader, Height), HCC_U16, 1.},
+		{"OffsetX", offsetof(HCCImageHeader, OffsetX), HCC_U16, 1.},
+		{"OffsetY", offsetof(HCCImageHeader, OffsetY), HCC_U16, 1.},
+		{"ReverseX", offsetof(HCCImageHeader, ReverseX), HCC_U8, 1.},
+		{"ReverseY", offsetof(HCCImageHeader, ReverseY), HCC_U8, 1.},
+		{"TestImageSelector", offsetof(HCCImageHeader, TestImageSelector), HCC_U8, 1.},
+		{"SensorWellDepth", offsetof(HCCImageHeader, SensorWellDepth), HCC_U8, 1.},
+		{"AcquisitionFrameRate", offsetof(HCCImageHeader, AcquisitionFrameRate), HCC_U32, 1.},
+		{"TriggerDelay", offsetof(HCCImageHeader, TriggerDelay), HCC_F32, 1.},
+		{"TriggerMode", offsetof(HCCImageHeader, TriggerMode), HCC_U8, 1.},
+		{"TriggerSource", offsetof(HCCImageHeader, TriggerSource), HCC_U8, 1.},
+		{"IntegrationMode", offsetof(HCCImageHeader, IntegrationMode), HCC_U8, 1.},
+		{"AveragingNumber", offsetof(HCCImageHeader, AveragingNumber), HCC_U8, 1.},
+		{"ExposureAuto", offsetof(HCCImageHeader, ExposureAuto), HCC_U8, 1.},
+		{"AECResponseTime", offsetof(HCCImageHeader, AECResponseTime), HCC_F32, 1.},
+		{"AECImageFraction", offsetof(HCCImageHeader, AECImageFraction), HCC_F32, 1.},
+		{"AECTargetWellFilling", offsetof(HCCImageHeader, AECTargetWellFilling), HCC_F32, 1.},
+		{"FWMode", offsetof(HCCImageHeader, FWMode), HCC_U8, 1.},
+		{"FWSpeedSetpoint", offsetof(HCCImageHeader, FWSpeedSetpoint), HCC_U16, 1.},
+		{"FWSpeed", offsetof(HCCImageHeader, FWSpeed), HCC_U16, 1.},
+		{"POSIXTime", offsetof(HCCImageHeader, POSIXTime), HCC_U32, 1.},
+		{"SubSecondTime", offsetof(HCCImageHeader, SubSecondTime), HCC_U32, 1.},
+		{"TimeSource", offsetof(HCCImageHeader, TimeSource), HCC_U8, 1.},
+		{"GPSModeIndicator", offsetof(HCCImageHeader, GPSModeIndicator), HCC_U8, 1.},
+		{"GPSLongitude", offsetof(HCCImageHeader, GPSLongitude), HCC_I32, 1.},
+		{"GPSLatitude", offsetof(HCCImageHeader, GPSLatitude), HCC_I32, 1.},
+		{"GPSAltitude", offsetof(HCCImageHeader, GPSAltitude), HCC_I32, 1.},
+		{"FWEncoderAtExposureStart", offsetof(HCCImageHeader, FWEncoderAtExposureStart), HCC_U16, 1.},
+		{"FWEncoderAtExposureEnd", offsetof(HCCImageHeader, FWEncoderAtExposureEnd), HCC_U16, 1.},
+		{"FWPosition", offsetof(HCCImageHeader, FWPosition), HCC_U8, 1.},
+		{"ICUPosition", offsetof(HCCImageHeader, ICUPosition), HCC_U8, 1.},
+		{"NDFilterPosition", offsetof(HCCImageHeader, NDFilterPosition), HCC_U8, 1.},
+		{"EHDRIExposureIndex", offsetof(HCCImageHeader, EHDRIExposureIndex), HCC_U8, 1.},
+		{"FrameFlag", offsetof(HCCImageHeader, FrameFlag), HCC_U8, 1.},
+		{"PostProcessed", offsetof(HCCImageHeader, PostProcessed), HCC_U8, 1.},
+		{"SensorTemperatureRaw", offsetof(HCCImageHeader, SensorTemperatureRaw), HCC_U16, 1.},
+		{"AlarmVector", offsetof(HCCImageHeader, AlarmVector), HCC_U32, 1.},
+		{"ExternalBlackBodyTemperature", offsetof(HCCImageHeader, ExternalBlackBodyTemperature), HCC_F32, 1.},
+		{"TemperatureSensor", offsetof(HCCImageHeader, TemperatureSensor), HCC_I16, 1.},
+		{"TemperatureInternalLens", offsetof(HCCImageHeader, TemperatureInternalLens), HCC_I16, 1.},
+		{"TemperatureExternalLens", offsetof(HCCImageHeader, TemperatureExternalLens), HCC_I16, 1.},
+		{"TemperatureInternalCalibrationUnit", offsetof(HCCImageHeader, TemperatureInternalCalibrationUnit), HCC_I16, 1.},
+		{"TemperatureExternalThermistor", offsetof(HCCImageHeader, TemperatureExternalThermistor), HCC_I16, 1.},
+		{"TemperatureFilterWheel", offsetof(HCCImageHeader, TemperatureFilterWheel), HCC_I16, 1.},
+		{"TemperatureCompressor", offsetof(HCCImageHeader, TemperatureCompressor), HCC_I16, 1.},
+		{"TemperatureColdFinger", offsetof(HCCImageHeader, TemperatureColdFinger), HCC_I16, 1.},
+		{"CalibrationBlockPOSIXTime", offsetof(HCCImageHeader, CalibrationBlockPOSIXTime), HCC_U32, 1.},
+		{"ExternalLensSerialNumber", offsetof(HCCImageHeader, ExternalLensSerialNumber), HCC_U32, 1.},
+		{"ManualFilterSerialNumber", offsetof(HCCImageHeader, ManualFilterSerialNumber), HCC_U32, 1.},
+		{"SensorID", offsetof(HCCImageHeader, SensorID), HCC_U8, 1.},
+		{"PixelDataResolution", offsetof(HCCImageHeader, PixelDataResolution), HCC_U8, 1.},
+		{"DeviceCalibrationFilesMajorVersion", offsetof(HCCImageHeader, DeviceCalibrationFilesMajorVersion), HCC_U8, 1.},
+		{"DeviceCalibrationFilesMinorVersion", offsetof(HCCImageHeader, DeviceCalibrationFilesMinorVersion), HCC_U8, 1.},
+		{"DeviceCalibrationFilesSubMinorVersion", offsetof(HCCImageHeader, DeviceCalibrationFilesSubMinorVersion), HCC_U8, 1.},
+		{"DeviceDataFlowMajorVersion", offsetof(HCCImageHeader, DeviceDataFlowMajorVersion), HCC_U8, 1.},
+		{"DeviceDataFlowMinorVersion", offsetof(HCCImageHeader, DeviceDataFlowMinorVersion), HCC_U8, 1.},
+		{"DeviceFirmwareMajorVersion", offsetof(HCCImageHeader, DeviceFirmwareMajorVersion), HCC_U8, 1.},
+		{"DeviceFirmwareMinorVersion", offsetof(HCCImageHeader, DeviceFirmwareMinorVersion), HCC_U8, 1.},
+		{"DeviceFirmwareSubMinorVersion", offsetof(HCCImageHeader, DeviceFirmwareSubMinorVersion), HCC_U8, 1.},
+		{"DeviceFirmwareBuildVersion", offsetof(HCCImageHeader, DeviceFirmwareBuildVersion), HCC_U8, 1.},
+		{"ActualizationPOSIXTime", offsetof(HCCImageHeader, ActualizationPOSIXTime), HCC_U32, 1.},
+		{"DeviceSerialNumber", offsetof(HCCImageHeader, DeviceSerialNumber), HCC_U32, 1.},
+	};
+
+	static const HCCHeaderField *findHeaderField(const std::string &name)
+	{
+		for (const HCCHeaderField &f : hcc_fields)
+			if (name == f.name)
+				return &f;
+		return NULL;
+	}
+
+	template <class T>
+	static inline double readField(const unsigned char *header, size_t offset)
+	{
+		T v;
+		memcpy(&v, header + offset, sizeof(T));
+		return (double)v;
+	}
+
+	static double fieldValue(const unsigned char *header, const HCCHeaderField &f)
+	{
+		double v = 0;
+		switch (f.type)
+		{
+		case HCC_U8:
+			v = readField<std::uint8_t>(header, f.offset);
+			break;
+		case HCC_I8:
+			v = readField<std::int8_t>(header, f.offset);
+			break;
+		case HCC_U16:
+			v = readField<std::uint16_t>(header, f.offset);
+			break;
+		case HCC_I16:
+			v = readField<std::int16_t>(header, f.offset);
+			break;
+		case HCC_U32:
+			v = readField<std::uint32_t>(header, f.offset);
+			break;
+		case HCC_I32:
+			v = readField<std::int32_t>(header, f.offset);
+			break;
+		case HCC_F32:
+			v = readField<float>(header, f.offset);
+			break;
+		}
+		return v * f.scale;
+	}
+
+	static bool findHeaderFields(const StringList &names, std::vector<const HCCHeaderField *> &fields)
+	{
+		fields.resize(names.size());
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			if (!(fields[i] = findHeaderField(names[i])))
+			{
+				logError(("Unknown HCC header field: " + names[i]).c_str());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	Read header fields for \a count frames starting at \a first.
+	With memory mapped files, only the requested fields are touched, without copying the headers.
+	*/
+	static bool readHeaderColumns(FileReaderPtr &file, const HCCImageHeader &first_header, const std::vector<const HCCHeaderField *> &fields, int first, int count, double *out)
+	{
+		const std::int64_t frame_size = first_header.ImageHeaderLength + (std::int64_t)first_header.Width * first_header.Height * 2;
+		const std::int64_t file_size = fileSize(file);
+		const std::uint8_t *data = fileData(file);
+		HCCImageHeader h;
+		for (int i = 0; i < count; ++i)
+		{
+			const std::int64_t offset = (std::int64_t)(first + i) * frame_size;
+			if (offset < 0 || offset + (std::int64_t)sizeof(HCCImageHeader) > file_size)
+				return false;
+			const unsigned char *header = data + offset;
+			if (!data)
+			{
+				if (seekFile(file, offset, SEEK_SET) < 0 || readFile(file, &h, sizeof(h)) != (int)sizeof(h))
+					return false;
+				header = (const unsigned char *)&h;
+			}
+			for (size_t c = 0; c < fields.size(); ++c)
+				out[c * count + i] = fieldValue(header, *fields[c]);
+		}
+		return true;
+	}
+
+#define HCC_INDEX_MAGIC "RIRHCCIX"
+#define HCC_INDEX_EXTENSION ".rirhccidx"
+
+	/**
+	Frame index of a HCC file
+	*/
+	struct HCCIndex
+	{
+		// timestamps in ns relative to the first frame
+		TimestampVector times;
+		std::vector<int> fwPositions;
+		// (position, missing frame count)
+		std::vector<std::pair<int, int>> gaps;
+		// true if timestamps come from frame headers
+		bool headerTimes = false;
+	};
+
+	/**
+	Build the frame index from all frame headers in one pass.
+	Timestamps are read from POSIXTime/SubSecondTime (100ns units), and fall back to the acquisition
+	frame rate if they are not set or not monotonic.
+	Dropped frames are detected from FrameID discontinuities, or from time gaps if frame IDs are not set.
+	*/
+	static bool buildIndex(FileReaderPtr &file, const HCCImageHeader &header, int count, double sampling, HCCIndex &index)
+	{
+		const std::vector<const HCCHeaderField *> fields = {
+			findHeaderField("POSIXTime"), findHeaderField("SubSecondTime"), findHeaderField("FrameID"), findHeaderField("FWPosition")};
+		std::vector<double> cols(fields.size() * count);
+		if (!readHeaderColumns(file, header, fields, 0, count, cols.data()))
+			return false;
+		const double *posix = cols.data();
+		const double *sub = posix + count;
+		const double *ids = sub + count;
+		const double *fw = ids + count;
+
+		index.times.resize(count);
+		index.fwPositions.resize(count);
+		index.gaps.clear();
+
+		bool valid = count > 0 && (posix[0] != 0 || sub[0] != 0);
+		for (int i = 0; i < count; ++i)
+		{
+			index.times[i] = (std::int64_t)(posix[i] - posix[0]) * 1000000000LL + (std::int64_t)(sub[i] - sub[0]) * 100LL;
+			index.fwPositions[i] = (int)fw[i];
+			if (i > 0 && index.times[i] < index.times[i - 1])
+				valid = false;
+		}
+		if (count > 1 && index.times.back() == 0)
+			valid = false;
+		index.headerTimes = valid;
+		if (!valid)
+		{
+			for (int i = 0; i < count; ++i)
+				index.times[i] = static_cast<std::int64_t>(i * sampling);
+		}
+
+		const bool has_ids = count > 1 && ids[count - 1] != ids[0];
+		for (int i = 1; i < count; ++i)
+		{
+			int missing = 0;
+			if (has_ids)
+				missing = (int)(ids[i] - ids[i - 1]) - 1;
+			else if (valid && sampling > 0)
+				missing = (int)std::round((index.times[i] - index.times[i - 1]) / sampling) - 1;
+			if (missing > 0)
+				index.gaps.push_back(std::make_pair(i, missing));
+		}
+		return true;
+	}
+
+	/**
+	Frame index cache file layout:
+	magic (8 bytes), file size, file modification time, frame size, frame count, first frame POSIXTime, SubSecondTime and FrameID,
+	header times flag, gap count (int64 each), timestamps (int64 each), filter wheel positions (int32 each), gaps (2 int32 each).
+	*/
+	static void indexCacheKey(const std::string &filename, FileReaderPtr &file, const HCCImageHeader &header, int count, std::int64_t *key)
+	{
+		key[0] = fileSize(file);
+		key[1] = (std::int64_t)file_mtime(filename.c_str());
+		key[2] = header.ImageHeaderLength + (std::int64_t)header.Width * header.Height * 2;
+		key[3] = count;
+		key[4] = header.POSIXTime;
+		key[5] = header.SubSecondTime;
+		key[6] = header.FrameID;
+	}
+
+	static bool readIndexCache(const std::string &filename, FileReaderPtr &file, const HCCImageHeader &header, int count, HCCIndex &index)
+	{
+		std::ifstream fin(filename + HCC_INDEX_EXTENSION, std::ios::binary);
+		if (!fin)
+			return false;
+		char magic[8];
+		std::int64_t key[7], h[9];
+		indexCacheKey(filename, file, header, count, key);
+		if (!fin.read(magic, 8) || memcmp(magic, HCC_INDEX_MAGIC, 8) != 0)
+			return false;
+		if (!fin.read((char *)h, sizeof(h)) || memcmp(h, key, sizeof(key)) != 0 || h[8] < 0 || h[8] > count)
+			return false;
+		index.headerTimes = h[7] != 0;
+		index.times.resize(count);
+		index.fwPositions.resize(count);
+		index.gaps.resize(h[8]);
+		if (!fin.read((char *)index.times.data(), count * sizeof(std::int64_t)) ||
+			!fin.read((char *)index.fwPositions.data(), count * sizeof(int)))
+			return false;
+		for (size_t i = 0; i < index.gaps.size(); ++i)
+		{
+			int gap[2];
+			if (!fin.read((char *)gap, sizeof(gap)))
+				return false;
+			index.gaps[i] = std::make_pair(gap[0], gap[1]);
+		}
+		return true;
+	}
+
+	static void writeIndexCache(const std::string &filename, FileReaderPtr &file, const HCCImageHeader &header, int count, const HCCIndex &index)
+	{
+		std::ofstream fout(filename + HCC_INDEX_EXTENSION, std::ios::binary);
+		if (!fout)
+			return;
+		std::int64_t h[9];
+		indexCacheKey(filename, file, header, count, h);
+		h[7] = index.headerTimes ? 1 : 0;
+		h[8] = (std::int64_t)index.gaps.size();
+		fout.write(HCC_INDEX_MAGIC, 8);
+		fout.write((const char *)h, sizeof(h));
+		fout.write((const char *)index.times.data(), count * sizeof(std::int64_t));
+		fout.write((const char *)index.fwPositions.data(), count * sizeof(int));
+		for (const auto &g : index.gaps)
+		{
+			int gap[2] = {g.first, g.second};
+			fout.write((const char *)gap, sizeof(gap));
+		}
+	}
+
 	class HCCLoader::PrivateData
 	{
 	public:
@@ -125,8 +443,13 @@ namespace rir
 		HCCImageHeader header;
 		HCCImageHeader imageHeader;
 		std::string filename;
+		// true if imageHeader contains the last read image header
+		bool hasImageHeader = false;
+		// frame index built at opening
+		bool headerTimes = false;
+		std::vector<int> fwPositions;
+		std::vector<std::pair<int, int>> gaps;
 		std::map<std::string, std::string> attributes;
-		std::map<std::string, std::string> imageAttributes;
 		std::vector<unsigned short> image;
 		PrivateData() : badPixelsEnabled(false), saturate(false)
 		{
@@ -153,7 +476,7 @@ namespace rir
 	bool HCCLoader::open(const char *filename)
 	{
 		close();
-		auto p = createFileReader(createFileAccess(filename));
+		auto p = createFileReader(createMappedFileAccess(filename));
 		if (!p)
 			return false;
 		d_data->filename = filename;
@@ -162,10 +485,12 @@ namespace rir
 		return false;
 	}
 
-	bool HCCLoader::openFileReader(const FileReaderPtr & reader)
+	bool HCCLoader::openFileReader(const FileReaderPtr & reader, const char *filename)
 	{
 		if (d_data->filename.empty())
 			close();
+		if (filename)
+			d_data->filename = filename;
 
 		auto file = reader;
 		seekFile(file, 0, SEEK_SET);
@@ -252,10 +577,25 @@ namespace rir
 			d_data->attributes["DataUnit"] = unit;
 		}
 
-		d_data->timestamps.resize(frame_count);
-		for (int i = 0; i < frame_count; i++)
-			d_data->timestamps[i] = static_cast<std::int64_t>(i * sampling);
-		
+		// index all frames: timestamps, filter wheel positions and dropped frames
+		HCCIndex index;
+		const bool use_cache = !d_data->filename.empty() && IRFileLoader::timestampCacheEnabled();
+		if (!use_cache || !readIndexCache(d_data->filename, file, d_data->header, frame_count, index))
+		{
+			if (!buildIndex(file, d_data->header, frame_count, sampling, index))
+			{
+				logError("Error reading HCC file : unable to read frame headers");
+				return false;
+			}
+			if (use_cache)
+				writeIndexCache(d_data->filename, file, d_data->header, frame_count, index);
+		}
+		d_data->timestamps = std::move(index.times);
+		d_data->fwPositions = std::move(index.fwPositions);
+		d_data->gaps = std::move(index.gaps);
+		d_data->headerTimes = index.headerTimes;
+		d_data->attributes["DroppedFrames"] = toString(droppedFrameCount());
+
 		populate_map_with_header(d_data->attributes, d_data->header);
 
 		d_data->file = reader;
@@ -310,9 +650,10 @@ namespace rir
 		if (seekFile(d_data->file, offset, SEEK_SET) < 0)
 			return false;
 
-		// read image header
-		HCCImageHeader h;
-		readFile(d_data->file, &h, sizeof(h));
+		// read image header, attributes are only built on demand by extractAttributes()
+		if (readFile(d_data->file, &d_data->imageHeader, sizeof(HCCImageHeader)) != (int)sizeof(HCCImageHeader))
+			return false;
+		d_data->hasImageHeader = true;
 
 		if (seekFile(d_data->file, offset + d_data->header.ImageHeaderLength, SEEK_SET) < 0)
 			return false;
@@ -330,10 +671,6 @@ namespace rir
 		
 		memcpy(pixels, pix, d_data->header.Height * d_data->header.Width * 2);
 
-		d_data->imageAttributes.clear();
-		populate_map_with_header(d_data->imageAttributes, h);
-
-
 		return true;
 	}
 
@@ -375,10 +712,57 @@ namespace rir
 
 	bool HCCLoader::extractAttributes(std::map<std::string, std::string> &out) const
 	{
-		out = d_data->imageAttributes;
+		out.clear();
+		if (d_data->hasImageHeader)
+			populate_map_with_header(out, d_data->imageHeader);
 		return true;
 	}
 
+	bool HCCLoader::hasHeaderTimestamps() const
+	{
+		return d_data->headerTimes;
+	}
+	int HCCLoader::droppedFrameCount() const
+	{
+		int res = 0;
+		for (const auto &g : d_data->gaps)
+			res += g.second;
+		return res;
+	}
+	const std::vector<std::pair<int, int>> &HCCLoader::frameGaps() const
+	{
+		return d_data->gaps;
+	}
+	const std::vector<int> &HCCLoader::filterWheelPositions() const
+	{
+		return d_data->fwPositions;
+	}
+
+	const HCCImageHeader *HCCLoader::imageHeader() const
+	{
+		return d_data->hasImageHeader ? &d_data->imageHeader : NULL;
+	}
+
+	bool HCCLoader::readImageHeader(int pos, HCCImageHeader *header)
+	{
+		if (!isValid() || pos < 0 || pos >= size())
+			return false;
+		std::int64_t frame_size = d_data->header.ImageHeaderLength + d_data->header.Width * d_data->header.Height * 2;
+		if (seekFile(d_data->file, frame_size * pos, SEEK_SET) < 0)
+			return false;
+		return readFile(d_data->file, header, sizeof(HCCImageHeader)) == (int)sizeof(HCCImageHeader);
+	}
+
+	bool HCCLoader::extractHeaderColumns(const StringList &names, int first, int count, double *out)
+	{
+		if (!isValid() || first < 0 || count < 0 || first + count > size())
+			return false;
+		std::vector<const HCCHeaderField *> fields;
+		if (!findHeaderFields(names, fields))
+			return false;
+		return readHeaderColumns(d_data->file, d_data->header, fields, first, count, out);
+	}
+
 	void HCCLoader::close()
 	{
 		delete d_data;
@@ -408,22 +792,14 @@ namespace rir
 			return true;
 		}
 
-		if (loader->isHCC()) {
-
-			std::ifstream fin(fname.c_str(), std::ios::binary);
-			HCCImageHeader h;
-			fin.read((char*)&h, sizeof(h));
-
-			size_t frame_size = h.ImageHeaderLength + h.Width * h.Height * 2;
-			double sampling = 1 / (h.AcquisitionFrameRate / 1000.0);
-			sampling *= 1000000000;
-
-			for (int i = 0; i < loader->size(); ++i) {
-				fin.seekg((std::uint64_t)i * frame_size);
-				fin.read((char*)&h, sizeof(h));
-				times[i] = (std::int64_t)(i * sampling);
-				pos[i] = h.FWPosition;
-			}
+		if (HCCLoader *hcc = loader->hccLoader()) {
+			// timestamps and filter wheel positions are indexed at opening
+			const TimestampVector &ts = hcc->timestamps();
+			const std::vector<int> &fw = hcc->filterWheelPositions();
+			if (ts.size() != fw.size())
+				return false;
+			std::copy(ts.begin(), ts.end(), times);
+			std::copy(fw.begin(), fw.end(), pos);
 			return true;
 		}
 		return false;
@@ -456,20 +832,10 @@ namespace rir
 			std::sort(pos, pos + *pos_count);
 			return true;
 		}
-		if (loader->isHCC()) {
-
-			std::ifstream fin(fname.c_str(), std::ios::binary);
-			HCCImageHeader h;
-			fin.read((char*)&h, sizeof(h));
-
-			size_t frame_size = h.ImageHeaderLength + h.Width * h.Height * 2;
-			double sampling = 1 / (h.AcquisitionFrameRate / 1000.0);
-			sampling *= 1000000000;
-			*pos_count = 0;
-			for (int i = 0; i < loader->size(); ++i) {
-				fin.seekg((std::uint64_t)i * frame_size);
-				fin.read((char*)&h, sizeof(h));
-				pos[(*pos_count)] = h.FWPosition;
+		if (HCCLoader *hcc = loader->hccLoader()) {
+			const std::vector<int> &fw = hcc->filterWheelPositions();
+			for (size_t i = 0; i < fw.size(); ++i) {
+				pos[(*pos_count)] = fw[i];
 				if (*pos_count && pos[(*pos_count)] == pos[0])
 					break;
 				else
@@ -480,5 +846,12 @@ namespace rir
 		return false;
 	}
 
-}
+	bool HCC_extractHeaderColumns(const IRFileLoader* loader, const StringList& names, int first, int count, double* out)
+	{
+		HCCLoader *hcc = loader->hccLoader();
+		if (!hcc)
+			return false;
+		return hcc->extractHeaderColumns(names, first, count, out);
+	}
 
+}
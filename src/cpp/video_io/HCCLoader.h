@@ -117,7 +117,8 @@ namespace rir
 		virtual ~HCCLoader();
 
 		bool open(const char *filename);
-		bool openFileReader(const FileReaderPtr & reader);
+		/// @brief Open from a file reader. \a filename (possibly NULL) is only used for the frame index cache.
+		bool openFileReader(const FileReaderPtr & reader, const char *filename = NULL);
 
 		virtual bool supportBadPixels() const { return true; }
 		virtual void setBadPixelsEnabled(bool enable);
@@ -143,6 +144,27 @@ namespace rir
 
 		void setExternalBlackBodyTemperature(float temperature);
 		double samplingTimeNs() const;
+
+		/// @brief Returns true if timestamps were read from the frame headers (POSIXTime/SubSecondTime),
+		/// false if they were computed from the acquisition frame rate.
+		bool hasHeaderTimestamps() const;
+		/// @brief Total number of frames missing from the file, detected from frame IDs (or timestamps)
+		int droppedFrameCount() const;
+		/// @brief Positions where frames are missing, with the number of frames missing just before each position
+		const std::vector<std::pair<int, int>> &frameGaps() const;
+		/// @brief Filter wheel position of each frame
+		const std::vector<int> &filterWheelPositions() const;
+
+		/// @brief Returns the header of the last read image, or NULL if no image was read.
+		/// Unlike extractAttributes(), this does not build any string.
+		const HCCImageHeader *imageHeader() const;
+		/// @brief Read the header of the image at given position, without reading its pixels
+		bool readImageHeader(int pos, HCCImageHeader *header);
+		/// @brief Extract numerical header fields for \a count frames starting at \a first, in one sequential pass.
+		/// Field names are the HCCImageHeader member names (ExposureTime is converted to seconds like in extractAttributes()).
+		/// Values of field i are written to out[i*count] ... out[(i+1)*count-1].
+		/// Returns false if a field name is unknown or on read error.
+		bool extractHeaderColumns(const StringList &names, int first, int count, double *out);
 	private:
 		class PrivateData;
 		PrivateData *d_data;
@@ -152,4 +174,6 @@ namespace rir
 	class IRFileLoader;
 	IO_EXPORT bool HCC_extractTimesAndFWPos(const IRFileLoader* loader, std::int64_t* times, int* pos);
 	IO_EXPORT bool HCC_extractAllFWPos(const IRFileLoader* loader, int* pos, int* pos_count);
+	/// @brief Same as HCCLoader::extractHeaderColumns() for a HCC file opened with an IRFileLoader
+	IO_EXPORT bool HCC_extractHeaderColumns(const IRFileLoader* loader, const StringList& names, int first, int count, double* out);
 }
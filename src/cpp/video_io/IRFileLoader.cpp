@@ -11,6 +11,9 @@
 #include <iomanip>
 #include <memory>
 #include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 
 #include "IRFileLoader.h"
@@ -206,8 +209,8 @@ namespace rir
 				return BIN_FILE_BIN;
 			}
 		}
-		// test Z compressed file
-		if (bin_header.version == 1 && (bin_header.compression >= 1 && bin_header.compression <= 3) && bin_header.triggers == 1)
+		// test Z compressed file (methods 1, 4 and 5, see ZFile.cpp)
+		if (bin_header.version == 1 && (bin_header.compression == 1 || bin_header.compression == 4 || bin_header.compression == 5) && bin_header.triggers == 1)
 		{
 			BIN_TRIGGER bin_trigger; // = (BIN_TRIGGER*)(bytes + sizeof(BIN_HEADER));
 									 // fseek(f, sizeof(BIN_HEADER), SEEK_SET);
@@ -252,6 +255,14 @@ namespace rir
 		return findFileType(buf, infos, start_images, start_time, frame_count);
 	}
 
+	static int checkTimes(const int64_t *times, uint32_t count)
+	{
+		for (uint32_t i = 1; i < count; ++i)
+			if (times[i] <= times[i - 1] /*|| times[i] > times[i - 1] + 20 * 20*/)
+				return 0;
+		return 1;
+	}
+
 	static int findTimes(BinFile *f, int64_t *times)
 	{
 		// f->file.rdbuf()->pubsetbuf(0, 0);
@@ -281,6 +292,133 @@ namespace rir
 		return 1;
 	}
 
+	/**
+	Same as findTimes, but for memory mapped files (see fileData()).
+	The timestamps are read directly from the mapping by several threads, so that only the pages holding
+	the 8 bytes timestamp of each image are touched.
+	*/
+	static int findTimesMapped(BinFile *f, int64_t *times)
+	{
+		const uint8_t *data = fileData(f->file);
+		const int64_t count = f->count;
+		if (!data || f->start + f->transferSize * count > fileSize(f->file))
+			return findTimes(f, times);
+
+		int threads = (int)std::thread::hardware_concurrency();
+		threads = std::max(1, std::min(threads, 8));
+		if (count < 1000)
+			threads = 1;
+
+		auto read_block = [&](int64_t first, int64_t last)
+		{
+			for (int64_t i = first; i < last; ++i)
+				memcpy(times + i, data + f->start + f->transferSize * (i + 1) - 8, 8);
+		};
+
+		// check the first images to quickly discard files without timestamps
+		const int64_t head = std::min(count, (int64_t)16);
+		read_block(0, head);
+		if (!checkTimes(times, (uint32_t)head))
+			return 0;
+
+		std::vector<std::thread> workers;
+		int64_t block = (count - head + threads - 1) / threads;
+		for (int i = 1; i < threads; ++i)
+			workers.push_back(std::thread(read_block, std::min(count, head + i * block), std::min(count, head + (i + 1) * block)));
+		read_block(head, std::min(count, head + block));
+		for (size_t i = 0; i < workers.size(); ++i)
+			workers[i].join();
+
+		return checkTimes(times, f->count);
+	}
+
+#define TIMES_CACHE_MAGIC "RIRTIME2"
+#define TIMES_CACHE_EXTENSION ".rirtimes"
+
+	static std::atomic<bool> _times_cache_enabled(false);
+
+	/**
+	Timestamps cache file layout:
+	magic (8 bytes), file size, file modification time, first image offset, transfer size, image count, has times (int64 each), timestamps (int64 each).
+	The modification time invalidates the cache of a file rewritten in place with the same size.
+	*/
+	static bool readTimesCache(const char *filename, BinFile *f, int64_t *has_times)
+	{
+		std::ifstream fin(std::string(filename) + TIMES_CACHE_EXTENSION, std::ios::binary);
+		if (!fin)
+			return false;
+		char magic[8];
+		int64_t header[6];
+		if (!fin.read(magic, 8) || memcmp(magic, TIMES_CACHE_MAGIC, 8) != 0)
+			return false;
+		if (!fin.read((char *)header, sizeof(header)))
+			return false;
+		if (header[0] != fileSize(f->file) || header[1] != (int64_t)file_mtime(filename) || header[2] != f->start ||
+			header[3] != f->transferSize || header[4] != (int64_t)f->count)
+			return false;
+		if (!fin.read((char *)f->times.data(), f->count * sizeof(int64_t)))
+			return false;
+		*has_times = header[5];
+		return true;
+	}
+
+	static void writeTimesCache(const char *filename, BinFile *f, int64_t has_times)
+	{
+		std::ofstream fout(std::string(filename) + TIMES_CACHE_EXTENSION, std::ios::binary);
+		if (!fout)
+			return;
+		int64_t header[6] = {fileSize(f->file), (int64_t)file_mtime(filename), f->start, f->transferSize, (int64_t)f->count, has_times};
+		fout.write(TIMES_CACHE_MAGIC, 8);
+		fout.write((char *)header, sizeof(header));
+		fout.write((char *)f->times.data(), f->count * sizeof(int64_t));
+	}
+
+	void IRFileLoader::setTimestampCacheEnabled(bool enable)
+	{
+		_times_cache_enabled = enable;
+	}
+	bool IRFileLoader::timestampCacheEnabled()
+	{
+		return _times_cache_enabled;
+	}
+
+#define BAD_PIXELS_CACHE_MAGIC "RIRBPCH1"
+#define BAD_PIXELS_CACHE_EXTENSION ".rirbadpixels"
+#define BAD_PIXELS_DETECTION_FRAMES 16
+
+	static std::atomic<bool> _bad_pixels_cache_enabled(false);
+
+	/**
+	Bad pixels cache file layout:
+	magic (8 bytes), file size, file modification time (int64 each), bad pixel map as written by BadPixels::save().
+	*/
+	static bool readBadPixelsCache(const std::string &filename, BadPixels &bad_pixels)
+	{
+		std::ifstream fin(filename + BAD_PIXELS_CACHE_EXTENSION, std::ios::binary);
+		if (!fin)
+			return false;
+		char magic[8];
+		int64_t header[2];
+		if (!fin.read(magic, 8) || memcmp(magic, BAD_PIXELS_CACHE_MAGIC, 8) != 0)
+			return false;
+		if (!fin.read((char *)header, sizeof(header)))
+			return false;
+		if (header[0] != (int64_t)file_size(filename.c_str()) || header[1] != (int64_t)file_mtime(filename.c_str()))
+			return false;
+		return bad_pixels.load(fin);
+	}
+
+	static void writeBadPixelsCache(const std::string &filename, const BadPixels &bad_pixels)
+	{
+		std::ofstream fout(filename + BAD_PIXELS_CACHE_EXTENSION, std::ios::binary);
+		if (!fout)
+			return;
+		int64_t header[2] = {(int64_t)file_size(filename.c_str()), (int64_t)file_mtime(filename.c_str())};
+		fout.write(BAD_PIXELS_CACHE_MAGIC, 8);
+		fout.write((char *)header, sizeof(header));
+		bad_pixels.save(fout);
+	}
+
 	static BinFile *bin_open_file_from_file_reader(const char *filename, const FileReaderPtr & reader)
 	{
 		if (!reader)
@@ -389,7 +527,7 @@ namespace rir
 		}
 		else if (f->type == BIN_FILE_HCC)
 		{
-			if (!f->hcc.openFileReader(f->file))
+			if (!f->hcc.openFileReader(f->file, filename))
 			{
 				delete f;
 				f = NULL;
@@ -419,7 +557,15 @@ namespace rir
 			f->width = infos.X;
 			f->height = infos.Y;
 			f->times.resize(f->count); // = (int64_t*)malloc(f->count * sizeof(int64_t));
-			f->has_times = findTimes(f, f->times.data());
+			int64_t has_times = 0;
+			if (filename && _times_cache_enabled && readTimesCache(filename, f, &has_times))
+				f->has_times = (int)has_times;
+			else
+			{
+				f->has_times = findTimesMapped(f, f->times.data());
+				if (filename && _times_cache_enabled)
+					writeTimesCache(filename, f, f->has_times);
+			}
 			if (!f->has_times)
 			{
 				if (infos.Frequency <= 0)
@@ -470,7 +616,7 @@ namespace rir
 
 	static BinFile *bin_open_file_read(const char *filename)
 	{
-		return bin_open_file_from_file_reader(filename, createFileReader(createFileAccess(filename)));
+		return bin_open_file_from_file_reader(filename, createFileReader(createMappedFileAccess(filename)));
 	}
 
 	static void bin_close_file(BinFile *f)
@@ -609,23 +755,75 @@ namespace rir
 		return -1;
 	}
 
+	static bool bin_is_raw(BinFile *f)
+	{
+		return f->type != BIN_FILE_OTHER && f->type != BIN_FILE_H264 && f->type != BIN_FILE_HCC && !f->zfile;
+	}
+
+	/**
+	Read several raw images from a BIN/PCR file.
+	Contiguous images are read with a single call to readFile (in blocks of at most 1GB).
+	*/
+	static int bin_read_raw_images(BinFile *f, int first, int count, int step, unsigned short *img)
+	{
+		if (first < 0 || count <= 0 || step <= 0 || first + (int64_t)(count - 1) * step >= (int64_t)f->count)
+			return -1;
+
+		const int64_t frame_bytes = 2 * (int64_t)f->width * f->height;
+		char *dst = (char *)img;
+
+		if (step == 1 && f->transferSize == frame_bytes)
+		{
+			const int64_t block = std::max((int64_t)1, (int64_t)(1 << 30) / frame_bytes);
+			prefetchFile(f->file, f->start + f->transferSize * first, frame_bytes * count);
+			seekFile(f->file, f->start + f->transferSize * first, AVSEEK_SET);
+			for (int64_t i = 0; i < count; i += block)
+			{
+				int64_t n = std::min(block, (int64_t)count - i);
+				if (readFile(f->file, dst, (int)(n * frame_bytes)) != (int)(n * frame_bytes))
+					return -1;
+				dst += n * frame_bytes;
+			}
+			return 0;
+		}
+
+		for (int i = 0; i < count; ++i, dst += frame_bytes)
+		{
+			if (i + 1 < count)
+				prefetchFile(f->file, f->start + f->transferSize * (first + (int64_t)(i + 1) * step), frame_bytes);
+			seekFile(f->file, f->start + f->transferSize * (first + (int64_t)i * step), AVSEEK_SET);
+			if (readFile(f->file, dst, (int)frame_bytes) != (int)frame_bytes)
+				return -1;
+		}
+		return 0;
+	}
+
 	static int64_t *bin_get_timestamps(BinFile *f)
 	{
 		return f->times.data();
 	}
 
-	static void removeMotionGeneric(std::vector<PointF> *upper, unsigned short *img, int w, int h, int pos)
+	template <class T>
+	static void removeMotionGeneric(const std::vector<PointF> *upper, T *img, int w, int h, int pos)
 	{
-		if ((*upper).size())
+		if (pos >= 0 && pos < (int)(*upper).size())
 		{
-
-			// Apply on the full image
-			std::vector<float> tmp(w * h);
-			translate(img, tmp.data(), 0.f, w, h, -(*upper)[pos].x(), -(*upper)[pos].y(), rir::TranslateNearest);
-			std::copy(tmp.begin(), tmp.end(), img);
+			// Apply on the full image, in-place
+			translateImage(img, img, w, h, -(*upper)[pos].x(), -(*upper)[pos].y(), rir::TranslateNearest);
 		}
 	}
 
+	/**
+	The correction window is bounded by the bad pixel map height (the image height without the trailing
+	metadata lines), so the lines below the map are never used as neighbors.
+	*/
+	template <class T>
+	static void removeBadPixelsGeneric(const BadPixels &bad_pixels, T *img, int w, int h)
+	{
+		if (w == bad_pixels.width() && h >= bad_pixels.height())
+			bad_pixels.correctInplace(img);
+	}
+
 	class IRFileLoader::PrivateData
 	{
 	public:
@@ -640,12 +838,12 @@ namespace rir
 		bool motionCorrectionEnabled;
 		std::vector<PointF> translation_points;
 		std::vector<unsigned short> img;
-		std::vector<bool> bad_pixels_img;
 		bool has_times;
 		bool saturate;
 		bool bp_enabled;
 		int median_value;
-		Polygon bad_pixels;
+		BadPixels bad_pixels;
+		bool bp_computed;
 		CalibrationPtr calib;
 		std::map<std::string, std::string> attributes;
 
@@ -653,8 +851,14 @@ namespace rir
 
 		std::vector<PointF> upper; // upper divertor or full view
 
+		// scratch buffers reused across calls
+		std::vector<unsigned short> scratch;
+		std::vector<unsigned short> motion_tmp;
+		// true if removeMotion was replaced with setMotionCorrectionFunction()
+		bool custom_motion;
+
 		PrivateData()
-			: type(0), min_T(0), min_T_height(0), store_it(false), motionCorrectionEnabled(false), has_times(false), saturate(false), bp_enabled(false), median_value(-1)
+			: type(0), min_T(0), min_T_height(0), store_it(false), motionCorrectionEnabled(false), has_times(false), saturate(false), bp_enabled(false), median_value(-1), bp_computed(false), custom_motion(false)
 		{
 			removeMotion = [this](unsigned short *img, int w, int h, int pos)
 			{
@@ -690,24 +894,49 @@ namespace rir
 		return true;
 	}
 
+	void IRFileLoader::setBadPixelsCacheEnabled(bool enable)
+	{
+		_bad_pixels_cache_enabled = enable;
+	}
+	bool IRFileLoader::badPixelsCacheEnabled()
+	{
+		return _bad_pixels_cache_enabled;
+	}
+
 	void IRFileLoader::setBadPixelsEnabled(bool enable)
 	{
 		if (m_data->bp_enabled != enable)
 		{
 			// compute only once
-			if (m_data->bad_pixels.empty())
+			if (!m_data->bp_computed)
 			{
-				std::vector<unsigned short> img(imageSize().width * imageSize().height);
-				readImage(0, 0, img.data());
-				m_data->bad_pixels = badPixels(img.data(), imageSize().width, imageSize().height - 3, 5);
-
-				// fill map of bad pixels
-				m_data->bad_pixels_img.resize(imageSize().width * imageSize().height);
-				std::fill_n(m_data->bad_pixels_img.begin(), m_data->bad_pixels_img.size(), false);
-
-				int width = imageSize().width;
-				for (const Point &p : m_data->bad_pixels)
-					m_data->bad_pixels_img[width * p.y() + p.x()] = true;
+				const int w = imageSize().width;
+				const int h = imageSize().height - 3;
+				const bool use_cache = m_data->filename.size() && _bad_pixels_cache_enabled;
+				bool cached = use_cache && readBadPixelsCache(m_data->filename, m_data->bad_pixels) &&
+							  m_data->bad_pixels.width() == w && m_data->bad_pixels.height() == h;
+				if (!cached && w > 0 && h > 0)
+				{
+					// detect on frames evenly spaced within the video
+					const int count = std::min(size(), BAD_PIXELS_DETECTION_FRAMES);
+					const size_t image_size = (size_t)w * (size_t)imageSize().height;
+					std::vector<unsigned short> imgs(image_size * count);
+					int read = 0;
+					for (int i = 0; i < count; ++i)
+					{
+						int pos = count > 1 ? (int)((int64_t)i * (size() - 1) / (count - 1)) : 0;
+						// keep the first h lines of each image, the next image overwrites the remaining ones
+						if (readImage(pos, 0, imgs.data() + (size_t)read * w * h))
+							++read;
+					}
+					if (read)
+					{
+						m_data->bad_pixels.initFromStack(imgs.data(), read, w, h, 5);
+						if (use_cache)
+							writeBadPixelsCache(m_data->filename, m_data->bad_pixels);
+					}
+				}
+				m_data->bp_computed = true;
 			}
 			m_data->bp_enabled = enable;
 
@@ -729,71 +958,7 @@ namespace rir
 		if (it != globalAttributes().end() && it->second == "HCC")
 			return;
 
-		unsigned short pixels[9];
-		// unsigned short buff[10];
-
-		if (w < 3 || h < 3)
-		{
-			for (size_t i = 0; i < m_data->bad_pixels.size(); ++i)
-			{
-				int x = m_data->bad_pixels[i].x();
-				int y = m_data->bad_pixels[i].y();
-
-				unsigned short *pix = pixels;
-				for (int dx = x - 1; dx <= x + 1; ++dx)
-					for (int dy = y - 1; dy <= y + 1; ++dy)
-						if (dx >= 0 && dy >= 0 && dx < w && dy < h)
-						{
-							*pix++ = img[dx + dy * w];
-						}
-				int c = (int)(pix - pixels);
-				std::nth_element(pixels, pixels + c / 2, pixels + c);
-				img[x + y * w] = pixels[c / 2];
-			}
-		}
-		else
-		{
-			for (size_t i = 0; i < m_data->bad_pixels.size(); ++i)
-			{
-				int x = m_data->bad_pixels[i].x();
-				int y = m_data->bad_pixels[i].y();
-				unsigned short *pix = pixels;
-
-				int dx_st = x - 1;
-				int dx_en = x + 1;
-				if (x == 0)
-				{
-					dx_st = 0;
-					dx_en = 2;
-				}
-				else if (x == w - 1)
-				{
-					dx_st = w - 3;
-					dx_en = w - 1;
-				}
-				int dy_st = y - 1;
-				int dy_en = y + 1;
-				if (y == 0)
-				{
-					dy_st = 0;
-					dy_en = 2;
-				}
-				else if (y == h - 1)
-				{
-					dy_st = h - 3;
-					dy_en = h - 1;
-				}
-				for (int dx = dx_st; dx <= dx_en; ++dx)
-					for (int dy = dy_st; dy <= dy_en; ++dy)
-					{
-						if (!m_data->bad_pixels_img[dx + dy * w])
-							*pix++ = img[dx + dy * w];
-					}
-				int c = (int)(pix - pixels);
-				std::nth_element(pixels, pixels + c / 2, pixels + c);
-				img[x + y * w] = pixels[c / 2];
-			}
-		}
+		removeBadPixelsGeneric(m_data->bad_pixels, img, w, h);
 
 		// remove low values
 		// if (m_data->median_value > 0) {
@@ -801,6 +966,19 @@ namespace rir
 		// }
 	}
 
+	void IRFileLoader::removeBadPixels(float *img, int w, int h)
+	{
+		if (!m_data->bp_enabled)
+			return;
+
+		// Disable bad pixels with HCC files
+		auto it = globalAttributes().find("Type");
+		if (it != globalAttributes().end() && it->second == "HCC")
+			return;
+
+		removeBadPixelsGeneric(m_data->bad_pixels, img, w, h);
+	}
+
 	void IRFileLoader::removeMotion(unsigned short *img, int w, int h, int pos)
 	{
 		if (!m_data->motionCorrectionEnabled)
@@ -812,6 +990,24 @@ namespace rir
 		}
 	}
 
+	void IRFileLoader::removeMotion(float *img, int w, int h, int pos)
+	{
+		if (!m_data->motionCorrectionEnabled || !m_data->removeMotion)
+			return;
+
+		if (!m_data->custom_motion)
+		{
+			removeMotionGeneric(&m_data->upper, img, w, h, pos);
+			return;
+		}
+
+		// user provided function only works on integer images
+		std::vector<unsigned short> &tmp = m_data->motion_tmp;
+		tmp.assign(img, img + w * h);
+		m_data->removeMotion(tmp.data(), w, h, pos);
+		std::copy(tmp.begin(), tmp.end(), img);
+	}
+
 	const IRVideoLoader* IRFileLoader::internalLoader() const
 	{
 		if (m_data->file && m_data->file->other)
@@ -861,6 +1057,7 @@ namespace rir
 	void IRFileLoader::setMotionCorrectionFunction(const motion_correction_function &fun)
 	{
 		m_data->removeMotion = fun;
+		m_data->custom_motion = true;
 	}
 
 	void IRFileLoader::setAttributes(const dict_type &attrs)
@@ -875,6 +1072,13 @@ namespace rir
 		return nullptr;
 	}
 
+	HCCLoader *IRFileLoader::hccLoader() const
+	{
+		if (isHCC() && m_data->file)
+			return &m_data->file->hcc;
+		return nullptr;
+	}
+
 	bool IRFileLoader::open(const char *filename)
 	{
 		std::ifstream f(filename);
@@ -1063,6 +1267,8 @@ namespace rir
 			return true;
 		else if (calibration == 1)
 		{
+			if (!m_data->calib)
+				return false;
 			if (m_data->calib->needPrepareCalibration())
 			{
 				dict_type d;
@@ -1082,6 +1288,8 @@ namespace rir
 			return true;
 		else if (calibration == 1)
 		{
+			if (!m_data->calib)
+				return false;
 			if (m_data->calib->needPrepareCalibration())
 			{
 				dict_type d;
@@ -1131,18 +1339,38 @@ namespace rir
 			if (bin_read_imageF(m_data->file.get(), pos, pixels, &time, calibration) != 0)
 				return false;
 
-			//TODO: enable back at some point (at least motion correction)
-			//removeBadPixels(pixels, imageSize().width, imageSize().height);
-			//removeMotion(pixels, imageSize().width, imageSize().height, pos);
+			removeBadPixels(pixels, imageSize().width, imageSize().height);
+			removeMotion(pixels, imageSize().width, imageSize().height, pos);
 			return true;
 		}
 
-		std::vector<unsigned short> tmp(imageSize().width * imageSize().height);
-		if (readImage(pos, calibration, tmp.data())) {
-			std::copy(tmp.begin(), tmp.end(), pixels);
+		const int w = imageSize().width;
+		const int h = imageSize().height;
+		std::vector<unsigned short> &dl = m_data->scratch;
+		dl.resize((size_t)w * h);
+
+		// Raw images and images already stored in temperature are integer images, no need for a floating point calibration
+		if (calibration != 1 || !m_data->calib || m_data->store_it)
+		{
+			if (!readImage(pos, calibration, dl.data()))
+				return false;
+			std::copy(dl.begin(), dl.end(), pixels);
 			return true;
 		}
-		return false;
+
+		if (bin_read_image(m_data->file.get(), pos, dl.data(), &time) != 0)
+			return false;
+
+		prepareImage(dl.data());
+
+		m_data->saturate = false;
+		if (!m_data->calib->applyF(dl.data(), this->invEmissivities(), w * h, pixels, &m_data->saturate))
+			return false;
+
+		removeBadPixels(pixels, w, h - 3);
+		// Remove motion if possible
+		removeMotion(pixels, w, h - 3, pos);
+		return true;
 	}
 
 	bool IRFileLoader::readImage(int pos, int calibration, unsigned short *pixels)
@@ -1168,8 +1396,61 @@ namespace rir
 		if (bin_read_image(m_data->file.get(), pos, pixels, &time) != 0)
 			return false;
 
-		bool is_in_T = m_data->store_it;
+		return processImage(pos, calibration, pixels);
+	}
+
+	bool IRFileLoader::readImages(int first, int count, int step, int calibration, unsigned short *pixels)
+	{
+		if (!m_data->file || count <= 0 || step <= 0 || first < 0 || first + (int64_t)(count - 1) * step >= size())
+			return false;
+
+		const size_t image_size = (size_t)imageSize().width * (size_t)imageSize().height;
 
+		// special case: other type with its own calibration, let the internal loader read the full range
+		if (m_data->type == BIN_FILE_OTHER && m_data->calib && m_data->calib == m_data->file->other->calibration())
+		{
+			if (!m_data->file->other->readImages(first, count, step, calibration, pixels))
+				return false;
+			for (int i = 0; i < count; ++i)
+			{
+				removeBadPixels(pixels + i * image_size, imageSize().width, imageSize().height);
+				removeMotion(pixels + i * image_size, imageSize().width, imageSize().height, first + i * step);
+			}
+			return true;
+		}
+
+		// BIN/PCR files: read the whole range at once, then process each image
+		if (bin_is_raw(m_data->file.get()))
+		{
+			if (bin_read_raw_images(m_data->file.get(), first, count, step, pixels) != 0)
+				return false;
+			for (int i = 0; i < count; ++i)
+				if (!processImage(first + i * step, calibration, pixels + i * image_size))
+					return false;
+			return true;
+		}
+
+		// H264 files in DL without per frame calibration parameters: decode the whole range at once (possibly in parallel)
+		if (m_data->type == BIN_FILE_H264 && !m_data->store_it && !(m_data->calib && m_data->calib->needPrepareCalibration()))
+		{
+			if (!m_data->file->h264.readImages(first, count, step, 0, pixels))
+				return false;
+			for (int i = 0; i < count; ++i)
+				if (!processImage(first + i * step, calibration, pixels + i * image_size))
+					return false;
+			return true;
+		}
+
+		// other formats: decoding state (like the last IT of H264 files) is bound to the last read image,
+		// so each image must be processed right after being read
+		for (int i = 0; i < count; ++i)
+			if (!readImage(first + i * step, calibration, pixels + i * image_size))
+				return false;
+		return true;
+	}
+
+	void IRFileLoader::prepareImage(unsigned short *pixels)
+	{
 		// If the image is already in temperature with subtracted min, add the min temperature stored as attribute
 		if (m_data->min_T && m_data->min_T_height)
 		{
@@ -1194,6 +1475,13 @@ namespace rir
 		if ((int)m_data->img.size() != m_data->size.height * m_data->size.width)
 			m_data->img.resize(m_data->size.height * m_data->size.width);
 		memcpy(m_data->img.data(), pixels, m_data->img.size() * 2);
+	}
+
+	bool IRFileLoader::processImage(int pos, int calibration, unsigned short *pixels)
+	{
+		bool is_in_T = m_data->store_it;
+
+		prepareImage(pixels);
 
 		m_data->saturate = false;
 
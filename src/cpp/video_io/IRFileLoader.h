@@ -35,6 +35,7 @@
 namespace rir
 {
 	class FileAttributes;
+	class HCCLoader;
 
 	/**
 	File header for PCR files (old Tore Supra video file format)
@@ -78,6 +79,23 @@ namespace rir
 		static int findFileType(std::istream *f, PCR_HEADER *infos, int64_t *start_images, int64_t *start_time, int *frame_count = NULL);
 		static int findFileType(char *buf, PCR_HEADER *infos, int64_t *start_images, int64_t *start_time, int *frame_count = NULL);
 
+		/**
+		Enable/disable the timestamps cache for BIN/PCR/HCC files (disabled by default).
+		When enabled, the timestamps found while opening a BIN/PCR file are stored in a 'filename.rirtimes' file next to it
+		(the frame index of a HCC file in a 'filename.rirhccidx' file), and reused when opening the same file again
+		as long as its size and modification time do not change.
+		*/
+		static void setTimestampCacheEnabled(bool enable);
+		static bool timestampCacheEnabled();
+		/**
+		Enable/disable the bad pixels cache (disabled by default).
+		When enabled, the bad pixels detected on a video file are stored in a 'filename.rirbadpixels' file next to it,
+		and reused when enabling bad pixels correction on the same file again.
+		The cache is discarded when the video file size or modification time changes.
+		*/
+		static void setBadPixelsCacheEnabled(bool enable);
+		static bool badPixelsCacheEnabled();
+
 		IRFileLoader();
 		~IRFileLoader();
 
@@ -112,6 +130,7 @@ namespace rir
 		virtual Size imageSize() const;
 		virtual bool readImage(int pos, int calibration, unsigned short *pixels);
 		virtual bool readImageF(int pos, int calibration, float* pixels);
+		virtual bool readImages(int first, int count, int step, int calibration, unsigned short *pixels);
 		virtual StringList supportedCalibration() const;
 		virtual bool isValid() const { return timestamps().size() > 0; }
 		virtual bool getRawValue(int x, int y, unsigned short *value) const;
@@ -131,13 +150,23 @@ namespace rir
 		void setAttributes(const dict_type& attrs);
 
 		const FileAttributes* fileAttributes() const;
+		/** Returns the internal HCC loader for HCC files, NULL otherwise */
+		HCCLoader* hccLoader() const;
 
 		void removeBadPixels(unsigned short *img, int w, int h);
+		void removeBadPixels(float *img, int w, int h);
+		/** Apply motion correction of image \a pos in-place, without allocation */
 		void removeMotion(unsigned short *img, int w, int h, int pos);
+		void removeMotion(float *img, int w, int h, int pos);
 
 		const IRVideoLoader* internalLoader() const;
 
 	private:
+		// Apply min_T offset, prepare calibration and store the raw image for getRawValue()
+		void prepareImage(unsigned short *pixels);
+		// Apply min_T offset, calibration, bad pixels and motion correction to a freshly read image
+		bool processImage(int pos, int calibration, unsigned short *pixels);
+
 		class PrivateData;
 		PrivateData *m_data;
 	};
@@ -54,6 +54,20 @@ namespace rir
 		_mutex.unlock();
 	}
 
+	bool IRVideoLoader::readImages(int first, int count, int step, int calibration, unsigned short *pixels)
+	{
+		if (count <= 0 || step <= 0 || first < 0 || first + (int64_t)(count - 1) * step >= (int64_t)size())
+			return false;
+		Size s = imageSize();
+		size_t image_size = (size_t)s.width * (size_t)s.height;
+		for (int i = 0; i < count; ++i)
+		{
+			if (!readImage(first + i * step, calibration, pixels + i * image_size))
+				return false;
+		}
+		return true;
+	}
+
 	StringList IRVideoLoader::tableNames() const
 	{
 		if (auto c = calibration())
@@ -115,6 +115,12 @@ namespace rir
 			std::copy(img.begin(), img.end(), pixels);
 			return true;
 		}
+		/**
+		Read \a count images starting at position \a first, every \a step images, using given calibration.
+		Images are stored contiguously in \a pixels, which must hold count*width*height values.
+		The default implementation calls readImage() for each position, derived classes may override it to amortize per-image setup.
+		*/
+		virtual bool readImages(int first, int count, int step, int calibration, unsigned short *pixels);
 		/**Retrieve the raw (DL) value at given position for the last read image*/
 		virtual bool getRawValue(int x, int y, unsigned short *value) const = 0;
 
@@ -5,6 +5,12 @@
 #include <stdlib.h>
 #include <fstream>
 #include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "ZFile.h"
 #include "Log.h"
@@ -12,9 +18,23 @@
 #include "ReadFileChunk.h"
 #include "Misc.h"
 #include "tools.h"
+#include "SIMD.h"
 
 using namespace rir;
 
+/**
+Compression methods stored in BIN_HEADER::compression.
+Methods 2 and 3 are blosc+zstd files written by other tools, which are not supported.
+*/
+#define Z_METHOD_ZSTD 1
+#define Z_METHOD_SHUFFLE_ZSTD 4
+#define Z_METHOD_DELTA_SHUFFLE_ZSTD 5
+
+static bool z_supported_method(int method)
+{
+	return method == Z_METHOD_ZSTD || method == Z_METHOD_SHUFFLE_ZSTD || method == Z_METHOD_DELTA_SHUFFLE_ZSTD;
+}
+
 typedef union BIN_HEADER
 {
 	struct
@@ -45,6 +65,170 @@ typedef union BIN_TRIGGER
 	char reserved[128];
 } BIN_TRIGGER;
 
+struct ZFile;
+static int64_t z_compress_image(const ZFile *f, const unsigned short *img, char *dst, int64_t dst_size, std::vector<char> &tmp);
+static int z_write_compressed(ZFile *f, int64_t timestamp, const char *data, uint32_t csize);
+
+/**
+Asynchronous compression stage of a write-only ZFile.
+
+Frames are compressed concurrently by a pool of worker threads and written back to the file
+in submission order, so that the on-disk layout is the same as for synchronous writing.
+The number of frames waiting to be compressed or written is bounded: push() blocks
+when the queue is full.
+*/
+class ZAsyncWriter
+{
+	struct Job
+	{
+		int64_t timestamp;
+		int64_t csize;
+		bool started;
+		bool done;
+		std::vector<unsigned short> img;
+		std::vector<char> data;
+		std::vector<char> tmp; // shuffle buffer
+	};
+	using JobPtr = std::shared_ptr<Job>;
+
+public:
+	ZAsyncWriter(ZFile *f, int threads, int queue_size)
+		: m_file(f), m_capacity(queue_size > 0 ? queue_size : 2 * threads), m_writing(false), m_stop(false), m_error(false)
+	{
+		for (int i = 0; i < threads; ++i)
+			m_threads.push_back(std::thread(std::bind(&ZAsyncWriter::run, this)));
+	}
+	~ZAsyncWriter()
+	{
+		finish();
+	}
+
+	/**
+	Queue an image for compression and writing.
+	Returns -1 if a previous image could not be compressed or written.
+	*/
+	int push(const unsigned short *img, size_t size, int64_t timestamp, int64_t bound)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while ((int)m_jobs.size() >= m_capacity && !m_error)
+			m_cond.wait(lock);
+		if (m_error)
+			return -1;
+
+		JobPtr job;
+		if (m_pool.size())
+		{
+			job = m_pool.back();
+			m_pool.pop_back();
+		}
+		else
+			job.reset(new Job());
+		job->timestamp = timestamp;
+		job->csize = 0;
+		job->started = job->done = false;
+		job->img.assign(img, img + size);
+		job->data.resize((size_t)bound);
+		m_jobs.push_back(job);
+		lock.unlock();
+		m_cond.notify_all();
+		return 0;
+	}
+
+	/**
+	Wait for all queued images to be written and stop the worker threads.
+	Returns -1 if an image could not be compressed or written, 0 otherwise.
+	*/
+	int finish()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_cond.notify_all();
+		for (size_t i = 0; i < m_threads.size(); ++i)
+			if (m_threads[i].joinable())
+				m_threads[i].join();
+		return m_error ? -1 : 0;
+	}
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			// oldest image not yet compressed
+			JobPtr job;
+			for (size_t i = 0; i < m_jobs.size(); ++i)
+			{
+				if (!m_jobs[i]->started)
+				{
+					job = m_jobs[i];
+					break;
+				}
+			}
+			if (!job)
+			{
+				if (m_stop)
+					break;
+				m_cond.wait(lock);
+				continue;
+			}
+
+			job->started = true;
+			lock.unlock();
+			job->csize = z_compress_image(m_file, job->img.data(), job->data.data(), (int64_t)job->data.size(), job->tmp);
+			lock.lock();
+			job->done = true;
+
+			// in-order write back, performed by a single thread at a time
+			if (!m_writing)
+			{
+				m_writing = true;
+				while (m_jobs.size() && m_jobs.front()->done)
+				{
+					JobPtr front = m_jobs.front();
+					m_jobs.pop_front();
+					lock.unlock();
+					int ret = front->csize < 0 ? -1 : z_write_compressed(m_file, front->timestamp, front->data.data(), (uint32_t)front->csize);
+					lock.lock();
+					if (ret < 0)
+						m_error = true;
+					if ((int)m_pool.size() < m_capacity)
+						m_pool.push_back(front);
+					m_cond.notify_all();
+				}
+				m_writing = false;
+			}
+			m_cond.notify_all();
+		}
+	}
+
+	ZFile *m_file;
+	int m_capacity;
+	bool m_writing;
+	bool m_stop;
+	bool m_error;
+	std::deque<JobPtr> m_jobs; // submission order
+	std::vector<JobPtr> m_pool;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::vector<std::thread> m_threads;
+};
+
+/**
+Per-reader decompression state of a read-only ZFile.
+Contexts are pooled in the ZFile so that different frames can be decompressed concurrently.
+*/
+struct ZReadContext
+{
+	void *dctx;
+	std::vector<char> buffer;	// compressed image read from a file reader
+	std::vector<char> shuffled; // decompressed image for methods 4 and 5
+	ZReadContext() : dctx(zstd_create_decompression_context()) {}
+	~ZReadContext() { zstd_free_decompression_context(dctx); }
+};
+
 typedef struct ZFile
 {
 	BIN_HEADER bheader;
@@ -61,11 +245,19 @@ typedef struct ZFile
 
 	// compression buffer
 	std::vector<char> buffer;
+	std::vector<char> shuffled; // byte shuffled image for methods 4 and 5 (write-only handle)
 	int clevel; // compression level
 
 	// image pos and timestamps for read only seeking
 	std::vector<int64_t> timestamps;
 	std::vector<int64_t> positions;
+
+	// read-only handle: pool of decompression contexts, and mutex protecting file_reader
+	std::vector<std::unique_ptr<ZReadContext>> read_contexts;
+	std::mutex read_mutex;
+
+	// asynchronous compression for write-only handles (declared last to be destroyed first)
+	std::unique_ptr<ZAsyncWriter> async;
 } ZFile;
 
 inline ZFile *createZFile()
@@ -74,7 +266,7 @@ inline ZFile *createZFile()
 	memset(&f->bheader, 0, sizeof(f->bheader));
 	memset(&f->btrigger, 0, sizeof(f->btrigger));
 	f->bheader.version = 1;
-	f->bheader.compression = 2; // 1 for raw zstd, 2 for blosc+zstd
+	f->bheader.compression = Z_METHOD_SHUFFLE_ZSTD;
 	f->bheader.triggers = 1;
 	f->btrigger.rate = 1;
 	f->readOnly = 1;
@@ -140,7 +332,7 @@ void *z_open_file_read(const FileReaderPtr & file_reader)
 	readFile(res->file_reader, &res->btrigger, sizeof(res->btrigger));
 
 	// make sure BIN_HEADER is valid
-	if ((res->bheader.compression != 1 && res->bheader.compression != 2 && res->bheader.compression != 3) || res->bheader.version != 1 || res->bheader.triggers != 1)
+	if (!z_supported_method(res->bheader.compression) || res->bheader.version != 1 || res->bheader.triggers != 1)
 	{
 		destroyZFile(res);
 		// printf("error");
@@ -152,9 +344,6 @@ void *z_open_file_read(const FileReaderPtr & file_reader)
 	{
 		res->readOnly = 1;
 
-		// allocate compression buffer
-		res->buffer.resize((unsigned)zstd_compress_bound(res->btrigger.data_size_x * res->btrigger.data_size_y * 2));
-
 		// grab all images timestamps and positions in file
 		uint64_t pos = posFile(res->file_reader);		   // res->file.tellg();
 		res->timestamps.resize(res->btrigger.samples); // = (int64_t*)malloc(sizeof(uint64_t) *res->btrigger.samples);
@@ -274,7 +463,7 @@ void *z_open_memory_read(void *mem, uint64_t size)
 	res->pos += sizeof(res->btrigger);
 
 	// make sure BIN_HEADER is valid
-	if (res->bheader.compression < 1 || res->bheader.compression > 3 || res->bheader.version != 1 || res->bheader.triggers != 1)
+	if (!z_supported_method(res->bheader.compression) || res->bheader.version != 1 || res->bheader.triggers != 1)
 	{
 		destroyZFile(res);
 		// printf("error");
@@ -286,11 +475,6 @@ void *z_open_memory_read(void *mem, uint64_t size)
 	{
 		res->readOnly = 1;
 
-		// allocate compression buffer
-		// res->buffer_size = (unsigned)ZSTD_compressBound(res->btrigger.data_size_x*res->btrigger.data_size_y * 2);
-		// res->buffer = malloc(res->buffer_size);
-		res->buffer.resize(zstd_compress_bound(res->btrigger.data_size_x * res->btrigger.data_size_y * 2));
-
 		// grab all images timestamps and positions in file
 		uint64_t pos = res->pos;
 		res->timestamps.resize(res->btrigger.samples); // = (int64_t*)malloc(sizeof(uint64_t) *res->btrigger.samples);
@@ -324,6 +508,8 @@ void *z_open_memory_read(void *mem, uint64_t size)
 
 void *z_open_file_write(const char *filename, int width, int height, int rate, int method, int clevel)
 {
+	if (!z_supported_method(method))
+		return NULL;
 	ZFile *res = createZFile();
 	res->file.open(filename, std::ios::binary | std::ios::out); // = fopen(filename, "wb");
 	if (!res->file)
@@ -366,6 +552,8 @@ void *z_open_file_write(const char *filename, int width, int height, int rate, i
 
 void *z_open_memory_write(void *mem, uint64_t size, int width, int height, int rate, int method, int clevel)
 {
+	if (!z_supported_method(method))
+		return NULL;
 	ZFile *res = createZFile();
 	res->tot_size = size;
 	res->mem = (unsigned char *)mem;
@@ -411,8 +599,16 @@ uint64_t z_close_file(void *file)
 {
 	ZFile *f = (ZFile *)file;
 	uint64_t res = 0;
+	bool error = false;
 	if (f && !f->readOnly)
 	{
+		// flush pending images
+		if (f->async)
+		{
+			error = f->async->finish() < 0;
+			f->async.reset();
+		}
+
 		// write again the trigger header to update the sample count
 		if (f->file)
 		{
@@ -448,7 +644,7 @@ uint64_t z_close_file(void *file)
 	}
 
 	destroyZFile(file);
-	return res;
+	return error ? (uint64_t)-1 : res;
 }
 
 int z_image_count(void *file)
@@ -480,42 +676,219 @@ int64_t z_file_size(void *file)
 		return f->tot_size;
 }
 
-int z_write_image(void *file, const unsigned short *img, int64_t timestamp)
+/**
+Byte shuffle a 16 bits image: the low bytes of all pixels are stored first, followed by the high bytes.
+If \a delta is true, each pixel is first replaced by the zigzag encoded difference with its left neighbour.
+Both transforms group similar bytes together, which greatly improves zstd compression ratio on IR images.
+*/
+static void z_shuffle(const unsigned short *src, int width, int height, bool delta, unsigned char *dst)
 {
-	if (!file)
-		return -1;
+	const size_t count = (size_t)width * (size_t)height;
+	unsigned char *lo = dst;
+	unsigned char *hi = dst + count;
 
-	ZFile *f = (ZFile *)file;
-	if (f->readOnly)
+	bool sse2 = detectInstructionSet().HW_SSE2;
+#ifndef __SSE2__
+	sse2 = false;
+#endif
+
+	for (int y = 0; y < height; ++y)
+	{
+		const unsigned short *s = src + (size_t)y * width;
+		unsigned char *l = lo + (size_t)y * width;
+		unsigned char *h = hi + (size_t)y * width;
+		int x = 0;
+		unsigned short prev = 0;
+		if (sse2)
+		{
+#ifdef __SSE2__
+			const __m128i mask = _mm_set1_epi16(0xFF);
+			__m128i last = _mm_setzero_si128();
+			for (; x + 16 <= width; x += 16)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i *)(s + x));
+				__m128i b = _mm_loadu_si128((const __m128i *)(s + x + 8));
+				if (delta)
+				{
+					// left neighbours: shift by one pixel and insert the last pixel of the previous vector
+					__m128i pa = _mm_or_si128(_mm_slli_si128(a, 2), _mm_srli_si128(last, 14));
+					__m128i pb = _mm_or_si128(_mm_slli_si128(b, 2), _mm_srli_si128(a, 14));
+					last = b;
+					a = _mm_sub_epi16(a, pa);
+					b = _mm_sub_epi16(b, pb);
+					a = _mm_xor_si128(_mm_slli_epi16(a, 1), _mm_srai_epi16(a, 15));
+					b = _mm_xor_si128(_mm_slli_epi16(b, 1), _mm_srai_epi16(b, 15));
+				}
+				_mm_storeu_si128((__m128i *)(l + x), _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+				_mm_storeu_si128((__m128i *)(h + x), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+			}
+			if (x > 0)
+				prev = s[x - 1];
+#endif
+		}
+		for (; x < width; ++x)
+		{
+			unsigned short v = s[x];
+			if (delta)
+			{
+				short d = (short)(unsigned short)(s[x] - prev);
+				prev = s[x];
+				v = (unsigned short)((d << 1) ^ (d >> 15));
+			}
+			l[x] = (unsigned char)(v & 0xFF);
+			h[x] = (unsigned char)(v >> 8);
+		}
+	}
+}
+
+/**
+Inverse of z_shuffle()
+*/
+static void z_unshuffle(const unsigned char *src, int width, int height, bool delta, unsigned short *dst)
+{
+	const size_t count = (size_t)width * (size_t)height;
+	const unsigned char *lo = src;
+	const unsigned char *hi = src + count;
+
+	bool sse2 = detectInstructionSet().HW_SSE2;
+#ifndef __SSE2__
+	sse2 = false;
+#endif
+
+	for (int y = 0; y < height; ++y)
+	{
+		unsigned short *d = dst + (size_t)y * width;
+		const unsigned char *l = lo + (size_t)y * width;
+		const unsigned char *h = hi + (size_t)y * width;
+		int x = 0;
+		unsigned short prev = 0;
+		if (sse2)
+		{
+#ifdef __SSE2__
+			const __m128i one = _mm_set1_epi16(1);
+			const __m128i zero = _mm_setzero_si128();
+			__m128i carry = zero;
+			for (; x + 16 <= width; x += 16)
+			{
+				__m128i vl = _mm_loadu_si128((const __m128i *)(l + x));
+				__m128i vh = _mm_loadu_si128((const __m128i *)(h + x));
+				__m128i a = _mm_unpacklo_epi8(vl, vh);
+				__m128i b = _mm_unpackhi_epi8(vl, vh);
+				if (delta)
+				{
+					// zigzag decoding
+					a = _mm_xor_si128(_mm_srli_epi16(a, 1), _mm_sub_epi16(zero, _mm_and_si128(a, one)));
+					b = _mm_xor_si128(_mm_srli_epi16(b, 1), _mm_sub_epi16(zero, _mm_and_si128(b, one)));
+					// prefix sums
+					a = _mm_add_epi16(a, _mm_slli_si128(a, 2));
+					a = _mm_add_epi16(a, _mm_slli_si128(a, 4));
+					a = _mm_add_epi16(a, _mm_slli_si128(a, 8));
+					a = _mm_add_epi16(a, carry);
+					carry = _mm_shufflehi_epi16(a, 0xFF);
+					carry = _mm_unpackhi_epi64(carry, carry);
+					b = _mm_add_epi16(b, _mm_slli_si128(b, 2));
+					b = _mm_add_epi16(b, _mm_slli_si128(b, 4));
+					b = _mm_add_epi16(b, _mm_slli_si128(b, 8));
+					b = _mm_add_epi16(b, carry);
+					carry = _mm_shufflehi_epi16(b, 0xFF);
+					carry = _mm_unpackhi_epi64(carry, carry);
+				}
+				_mm_storeu_si128((__m128i *)(d + x), a);
+				_mm_storeu_si128((__m128i *)(d + x + 8), b);
+			}
+			if (x > 0)
+				prev = d[x - 1];
+#endif
+		}
+		for (; x < width; ++x)
+		{
+			unsigned short v = (unsigned short)(l[x] | (h[x] << 8));
+			if (delta)
+			{
+				v = (unsigned short)((v >> 1) ^ (unsigned short)(-(short)(v & 1)));
+				v = (unsigned short)(v + prev);
+				prev = v;
+			}
+			d[x] = v;
+		}
+	}
+}
+
+static int64_t z_compress_image(const ZFile *f, const unsigned short *img, char *dst, int64_t dst_size, std::vector<char> &tmp)
+{
+	const int width = (int)f->btrigger.data_size_x;
+	const int height = (int)f->btrigger.data_size_y;
+	const int64_t size = (int64_t)width * height * 2;
+	if (f->bheader.compression == Z_METHOD_ZSTD)
+		return zstd_compress((char *)img, size, dst, dst_size, f->clevel);
+	if (f->bheader.compression == Z_METHOD_SHUFFLE_ZSTD || f->bheader.compression == Z_METHOD_DELTA_SHUFFLE_ZSTD)
+	{
+		tmp.resize((size_t)size);
+		z_shuffle(img, width, height, f->bheader.compression == Z_METHOD_DELTA_SHUFFLE_ZSTD, (unsigned char *)tmp.data());
+		return zstd_compress(tmp.data(), size, dst, dst_size, f->clevel);
+	}
+	return -1;
+}
+
+static int z_decompress_image(const ZFile *f, ZReadContext *ctx, const char *src, uint32_t src_size, unsigned short *img)
+{
+	const int width = (int)f->btrigger.data_size_x;
+	const int height = (int)f->btrigger.data_size_y;
+	const int64_t size = (int64_t)width * height * 2;
+	if (f->bheader.compression == Z_METHOD_ZSTD)
+		return zstd_decompress_with_context(ctx->dctx, src, src_size, (char *)img, size) == size ? 0 : -1;
+
+	ctx->shuffled.resize((size_t)size);
+	if (zstd_decompress_with_context(ctx->dctx, src, src_size, ctx->shuffled.data(), size) != size)
 		return -1;
+	z_unshuffle((const unsigned char *)ctx->shuffled.data(), width, height, f->bheader.compression == Z_METHOD_DELTA_SHUFFLE_ZSTD, img);
+	return 0;
+}
 
-	// compress image
-	uint32_t csize = 0;
-	if (f->bheader.compression == 1)
+/**
+Take a decompression context from the pool of a read-only ZFile, and give it back on destruction.
+*/
+class ZReadContextLocker
+{
+	ZFile *m_file;
+	std::unique_ptr<ZReadContext> m_ctx;
+
+public:
+	ZReadContextLocker(ZFile *f) : m_file(f)
 	{
-		csize = (uint32_t)zstd_compress((char *)img, f->btrigger.data_size_x * f->btrigger.data_size_y * 2, f->buffer.data(), f->buffer.size(), f->clevel);
-		if (csize == (uint32_t)-1)
-			return -1;
+		std::lock_guard<std::mutex> lock(m_file->read_mutex);
+		if (m_file->read_contexts.size())
+		{
+			m_ctx = std::move(m_file->read_contexts.back());
+			m_file->read_contexts.pop_back();
+		}
+		else
+			m_ctx.reset(new ZReadContext());
+	}
+	~ZReadContextLocker()
+	{
+		std::lock_guard<std::mutex> lock(m_file->read_mutex);
+		m_file->read_contexts.push_back(std::move(m_ctx));
 	}
+	ZReadContext *get() const { return m_ctx.get(); }
+};
 
+static int z_write_compressed(ZFile *f, int64_t timestamp, const char *data, uint32_t csize)
+{
 	if (f->file)
 	{
 		int64_t pos = f->file.tellp();
 		// write timestamp
-		// fwrite(&timestamp, sizeof(timestamp), 1, f->file);
 		f->file.write((char *)&timestamp, sizeof(timestamp));
 
 		// write compressed size
-		// fwrite(&csize, sizeof(csize), 1, f->file);
 		f->file.write((char *)&csize, sizeof(csize));
 
 		// write compressed image
-		// if (fwrite(f->buffer, csize, 1, f->file) != 1)
-		//	return -1;
-		if (!f->file.write(f->buffer.data(), csize))
+		if (!f->file.write(data, csize))
 			return -1;
 
-		f->pos = f->file.tellp(); // ftell(f->file);
+		f->pos = f->file.tellp();
 		f->btrigger.samples++;
 
 		f->timestamps.push_back(timestamp);
@@ -532,7 +905,7 @@ int z_write_image(void *file, const unsigned short *img, int64_t timestamp)
 		f->pos += sizeof(timestamp);
 		memcpy(f->mem + f->pos, &csize, sizeof(csize));
 		f->pos += sizeof(csize);
-		memcpy(f->mem + f->pos, f->buffer.data(), csize);
+		memcpy(f->mem + f->pos, data, csize);
 		f->pos += csize;
 		f->btrigger.samples++;
 		return 0;
@@ -541,88 +914,107 @@ int z_write_image(void *file, const unsigned short *img, int64_t timestamp)
 	return -1;
 }
 
-int z_read_image(void *file, int pos, unsigned short *img, int64_t *timestamp)
+int z_set_write_threads(void *file, int threads, int queue_size)
 {
 	if (!file)
 		return -1;
 
 	ZFile *f = (ZFile *)file;
-	if (!f->readOnly)
+	if (f->readOnly)
 		return -1;
 
-	if (pos < 0 || pos >= (int)f->btrigger.samples)
+	// flush images queued with the previous settings
+	int res = 0;
+	if (f->async)
+	{
+		res = f->async->finish();
+		f->async.reset();
+	}
+	if (threads > 1)
+		f->async.reset(new ZAsyncWriter(f, threads, queue_size));
+	return res;
+}
+
+int z_write_image(void *file, const unsigned short *img, int64_t timestamp)
+{
+	if (!file)
 		return -1;
 
-	/*if (!f->mem && !f->file && !f->filename.empty()) {
-		f->file.close();
-		f->file.open(f->filename.c_str(), std::ios::in | std::ios::binary);
-	}*/
+	ZFile *f = (ZFile *)file;
+	if (f->readOnly)
+		return -1;
 
-	uint32_t fsize;
-	int64_t time;
-	if (f->file_reader) // f->file)
-	{
-		/*f->file.seekg(f->positions[pos]);
+	if (f->async)
+		return f->async->push(img, f->btrigger.data_size_x * f->btrigger.data_size_y, timestamp, (int64_t)f->buffer.size());
 
-		//read timestamp
-		f->file.read((char*)&time, sizeof(time));
-		if (timestamp) *timestamp = time;
+	// compress image
+	int64_t csize = z_compress_image(f, img, f->buffer.data(), (int64_t)f->buffer.size(), f->shuffled);
+	if (csize < 0)
+		return -1;
 
-		//read compressed data size
-		f->file.read((char*)&fsize, sizeof(fsize));
+	return z_write_compressed(f, timestamp, f->buffer.data(), (uint32_t)csize);
+}
 
-		//read compressed image
-		if (!f->file.read(f->buffer.data(), fsize)) {
-			f->file.clear();
-			return -1;
-		}
-		f->file.clear();*/
+int z_read_image(void *file, int pos, unsigned short *img, int64_t *timestamp)
+{
+	if (!file)
+		return -1;
 
-		seekFile(f->file_reader, f->positions[pos], AVSEEK_SET);
-		readFile(f->file_reader, &time, sizeof(time));
-		if (timestamp)
-			*timestamp = time;
+	ZFile *f = (ZFile *)file;
+	if (!f->readOnly)
+		return -1;
 
-		// read compressed data size
-		readFile(f->file_reader, &fsize, sizeof(fsize));
+	if (pos < 0 || pos >= (int)f->btrigger.samples)
+		return -1;
 
-		// read compressed image
-		if (readFile(f->file_reader, f->buffer.data(), fsize) != (int)fsize)
-		{
-			return -1;
-		}
+	ZReadContextLocker ctx(f);
 
-		if (f->bheader.compression == 1)
-		{
-			if (zstd_decompress(f->buffer.data(), fsize, (char *)img, f->btrigger.data_size_x * f->btrigger.data_size_y * 2) < 0)
-				return -1;
+	uint32_t fsize;
+	int64_t time;
 
-			// if (ZSTD_isError(ZSTD_decompress(img, f->btrigger.data_size_x*f->btrigger.data_size_y * 2, f->buffer.data(), fsize)))
-			//	return -1;
-		}
+	// directly addressable content: decompress in place without copy
+	const uint8_t *data = f->mem;
+	if (!data && f->file_reader)
+		data = fileData(f->file_reader);
 
-		return 0;
-	}
-	else if (f->mem)
+	if (data)
 	{
 		uint64_t loc = f->positions[pos];
-		memcpy(&time, f->mem + loc, sizeof(time));
+		if (loc + sizeof(time) + sizeof(fsize) > f->tot_size)
+			return -1;
+		memcpy(&time, data + loc, sizeof(time));
 		loc += sizeof(time);
 		if (timestamp)
 			*timestamp = time;
-		memcpy(&fsize, f->mem + loc, sizeof(fsize));
+		memcpy(&fsize, data + loc, sizeof(fsize));
 		loc += sizeof(fsize);
-		memcpy(f->buffer.data(), f->mem + loc, fsize);
+		if (loc + fsize > f->tot_size)
+			return -1;
 
-		if (f->bheader.compression == 1)
+		return z_decompress_image(f, ctx.get(), (const char *)data + loc, fsize, img);
+	}
+	else if (f->file_reader)
+	{
 		{
-			// if (ZSTD_isError(ZSTD_decompress(img, f->btrigger.data_size_x*f->btrigger.data_size_y * 2, f->buffer.data(), fsize)))
-			//	return -1;
-			if (zstd_decompress(f->buffer.data(), fsize, (char *)img, f->btrigger.data_size_x * f->btrigger.data_size_y * 2) < 0)
+			// the file reader is shared by all readers of this handle
+			std::lock_guard<std::mutex> lock(f->read_mutex);
+			seekFile(f->file_reader, f->positions[pos], AVSEEK_SET);
+			readFile(f->file_reader, &time, sizeof(time));
+
+			// read compressed data size
+			if (readFile(f->file_reader, &fsize, sizeof(fsize)) != (int)sizeof(fsize))
+				return -1;
+
+			// read compressed image
+			if (ctx.get()->buffer.size() < fsize)
+				ctx.get()->buffer.resize(fsize);
+			if (readFile(f->file_reader, ctx.get()->buffer.data(), fsize) != (int)fsize)
 				return -1;
 		}
+		if (timestamp)
+			*timestamp = time;
 
-		return 0;
+		return z_decompress_image(f, ctx.get(), ctx.get()->buffer.data(), fsize, img);
 	}
 
 	return -1;
@@ -19,6 +19,7 @@ Open in read-only mode given compressed BIN file stored in memory and return an
 IO_EXPORT void *z_open_memory_read(void *mem, uint64_t size);
 /**
 Open in write-only mode given compressed BIN file and return an opaque handle on the file.
+\a method must be 1, 4 or 5 (see open_video_write()), NULL is returned otherwise.
 */
 IO_EXPORT void *z_open_file_write(const char *filename, int width, int height, int rate, int method, int clevel = 2);
 /**
@@ -26,7 +27,8 @@ Open in read-only mode given compressed BIN file stored in memory and return an
 */
 IO_EXPORT void *z_open_memory_write(void *mem, uint64_t size, int width, int height, int rate, int method, int clevel = 2);
 /**
-Close a compressed BIN file and return its size (the size is only valid for write-only handle)
+Close a compressed BIN file and return its size (the size is only valid for write-only handle).
+Returns (uint64_t)-1 if a frame queued by the asynchronous writer could not be written.
 */
 IO_EXPORT uint64_t z_close_file(void *file);
 /**
@@ -42,8 +44,20 @@ Write an image in a write-only handle with given \a timestamp.
 */
 IO_EXPORT int z_write_image(void *file, const unsigned short *img, int64_t timestamp);
 /**
+Enable asynchronous writing for a write-only handle.
+With \a threads > 1, images passed to #z_write_image are compressed concurrently by \a threads worker threads
+and written in submission order. At most \a queue_size images (2 * \a threads if \a queue_size <= 0) are queued,
+#z_write_image blocking when the queue is full. Use \a threads <= 1 to go back to synchronous writing.
+Images already queued are flushed before changing the mode.
+In asynchronous mode, a compression or write error is reported by the next call to #z_write_image or #z_set_write_threads.
+Returns 0 on success, -1 on error.
+*/
+IO_EXPORT int z_set_write_threads(void *file, int threads, int queue_size = 0);
+/**
 Read the image at position \a pos from given handle.
 If \a timestamp is not NULL, the image timestamp in nanoseconds will be stored inside.
+This function can be called concurrently from several threads on the same read-only handle.
+Images stored in memory are decompressed in place, without intermediate copy.
 */
 IO_EXPORT int z_read_image(void *file, int pos, unsigned short *img, int64_t *timestamp = NULL);
 /**
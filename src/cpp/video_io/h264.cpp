@@ -12,6 +12,7 @@
 #include "tools.h"
 #include "Log.h"
 #include "ReadFileChunk.h"
+#include "SIMD.h"
 
 #ifndef INT64_C
 #define INT64_C(c) (c##LL)
@@ -73,6 +74,9 @@ extern "C"
 #include <thread>
 #include <map>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
 
 #include "BadPixels.h"
 
@@ -183,6 +187,7 @@ namespace rir
 		double factor_std;
 		callback_type callback;
 
+		// sliding window of frame difference standard deviations (one scalar per frame, no per pixel running average)
 		std::vector<double> std_dev;
 		std::vector<unsigned short> prev;
 		std::vector<unsigned short> last_saved;
@@ -514,6 +519,103 @@ namespace rir
 		return 0;
 	}
 
+	/**
+	 * Split 16 bits pixels into low and high byte planes.
+	 * If it_out is not NULL, the IT plane is written in the same pass: copied from it, or zeroed if it is NULL.
+	 */
+	static void splitPixels(const unsigned short *RIR_RESTRICT src, unsigned char *RIR_RESTRICT lo, unsigned char *RIR_RESTRICT hi,
+							const unsigned char *RIR_RESTRICT it, unsigned char *RIR_RESTRICT it_out, int n)
+	{
+		int i = 0;
+#ifdef __AVX2__
+		if (detectInstructionSet().HW_AVX2)
+		{
+			const __m256i mask = _mm256_set1_epi16(0xFF);
+			const __m256i zero = _mm256_setzero_si256();
+			for (; i + 32 <= n; i += 32)
+			{
+				const __m256i a = _mm256_loadu_si256((const __m256i *)(src + i));
+				const __m256i b = _mm256_loadu_si256((const __m256i *)(src + i + 16));
+				// packus works per 128 bits lane, restore pixel order with a 64 bits permute
+				const __m256i l = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+				const __m256i h = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+				_mm256_storeu_si256((__m256i *)(lo + i), _mm256_permute4x64_epi64(l, 0xD8));
+				_mm256_storeu_si256((__m256i *)(hi + i), _mm256_permute4x64_epi64(h, 0xD8));
+				if (it_out)
+					_mm256_storeu_si256((__m256i *)(it_out + i), it ? _mm256_loadu_si256((const __m256i *)(it + i)) : zero);
+			}
+		}
+#endif
+#ifdef __SSE2__
+		if (detectInstructionSet().HW_SSE2)
+		{
+			const __m128i mask = _mm_set1_epi16(0xFF);
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= n; i += 16)
+			{
+				const __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+				const __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 8));
+				_mm_storeu_si128((__m128i *)(lo + i), _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+				_mm_storeu_si128((__m128i *)(hi + i), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+				if (it_out)
+					_mm_storeu_si128((__m128i *)(it_out + i), it ? _mm_loadu_si128((const __m128i *)(it + i)) : zero);
+			}
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			lo[i] = src[i] & 0xFF;
+			hi[i] = src[i] >> 8;
+			if (it_out)
+				it_out[i] = it ? it[i] : 0;
+		}
+	}
+
+	/**
+	 * Inverse of splitPixels: rebuild 16 bits pixels from low and high byte planes.
+	 * If it_out is not NULL, the IT plane it is copied in the same pass.
+	 */
+	static void joinPixels(const unsigned char *RIR_RESTRICT lo, const unsigned char *RIR_RESTRICT hi, unsigned short *RIR_RESTRICT dst,
+						   const unsigned char *RIR_RESTRICT it, unsigned char *RIR_RESTRICT it_out, int n)
+	{
+		int i = 0;
+#ifdef __AVX2__
+		if (detectInstructionSet().HW_AVX2)
+		{
+			for (; i + 32 <= n; i += 32)
+			{
+				// unpack works per 128 bits lane, interleave 64 bits blocks first so that the output is in order
+				const __m256i l = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(lo + i)), 0xD8);
+				const __m256i h = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(hi + i)), 0xD8);
+				_mm256_storeu_si256((__m256i *)(dst + i), _mm256_unpacklo_epi8(l, h));
+				_mm256_storeu_si256((__m256i *)(dst + i + 16), _mm256_unpackhi_epi8(l, h));
+				if (it_out)
+					_mm256_storeu_si256((__m256i *)(it_out + i), _mm256_loadu_si256((const __m256i *)(it + i)));
+			}
+		}
+#endif
+#ifdef __SSE2__
+		if (detectInstructionSet().HW_SSE2)
+		{
+			for (; i + 16 <= n; i += 16)
+			{
+				const __m128i l = _mm_loadu_si128((const __m128i *)(lo + i));
+				const __m128i h = _mm_loadu_si128((const __m128i *)(hi + i));
+				_mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi8(l, h));
+				_mm_storeu_si128((__m128i *)(dst + i + 8), _mm_unpackhi_epi8(l, h));
+				if (it_out)
+					_mm_storeu_si128((__m128i *)(it_out + i), _mm_loadu_si128((const __m128i *)(it + i)));
+			}
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			dst[i] = lo[i] | (hi[i] << 8);
+			if (it_out)
+				it_out[i] = it[i];
+		}
+	}
+
 	class H264Capture
 	{
 	public:
@@ -527,6 +629,7 @@ namespace rir
 			frameCounter = 0;
 			lastKeyFrame = 0;
 			GOP = 30;
+			frameHasIT = false;
 		}
 		~H264Capture()
 		{
@@ -566,6 +669,8 @@ namespace rir
 		int GOP;
 		int frame_width;
 		int frame_height;
+		bool frameHasIT;
+		bool AllocFrame();
 		void Free();
 		bool Remux();
 	};
@@ -1019,6 +1124,29 @@ namespace rir
 		return true;
 	}
 
+	bool H264Capture::AllocFrame()
+	{
+		if (videoFrame)
+			return true;
+
+		videoFrame = av_frame_alloc();
+		videoFrame->format = file_format;
+		videoFrame->width = cctx->width;
+		videoFrame->height = cctx->height;
+
+		int err;
+		if ((err = av_frame_get_buffer(videoFrame, 32)) < 0)
+		{
+			RIR_LOG_ERROR("Failed to allocate picture with format %i, w = %i, h = %i", (int)file_format, cctx->width, cctx->height);
+			av_frame_free(&videoFrame);
+			return false;
+		}
+		// AddFrame() only writes the pixels area, padding must stay at 0
+		memset(videoFrame->buf[0]->data, 0, videoFrame->buf[0]->size);
+		frameHasIT = false;
+		return true;
+	}
+
 	bool H264Capture::AddFrame(const unsigned short *img, bool key)
 	{
 
@@ -1030,20 +1158,8 @@ namespace rir
 		const unsigned short *data = img; //(const unsigned short*)tmp.constData();
 
 		int err;
-		if (!videoFrame)
-		{
-
-			videoFrame = av_frame_alloc();
-			videoFrame->format = file_format;
-			videoFrame->width = cctx->width;
-			videoFrame->height = cctx->height;
-
-			if ((err = av_frame_get_buffer(videoFrame, 32)) < 0)
-			{
-				RIR_LOG_ERROR("Failed to allocate picture with format %i, w = %i, h = %i", (int)file_format, cctx->width, cctx->height);
-				return false;
-			}
-		}
+		if (!AllocFrame())
+			return false;
 
 		bool kvazaar = strcmp(codec->name, "libkvazaar") == 0;
 
@@ -1071,34 +1187,24 @@ namespace rir
 				unsigned char *d0 = videoFrame->data[0] + y * videoFrame->linesize[0];
 				unsigned char *d1 = videoFrame->data[1] + y * videoFrame->linesize[1];
 				unsigned char *d2 = videoFrame->data[2] + y * videoFrame->linesize[2];
-				for (int i = 0; i < cctx->width; ++i)
-				{
-					unsigned short v = data[i + y * cctx->width];
-					d1[i] = v & 0xFF;
-					d2[i] = v >> 8;
-					d0[i] = 0;
-				}
+				splitPixels(data + y * cctx->width, d1, d2, NULL, d0, cctx->width);
 			}
 		}
 		else
 		{ // AV_PIX_FMT_YUV420P
-			/*memset(videoFrame->data[0], 0, cctx->height * videoFrame->linesize[0]);
-			memset(videoFrame->data[1],0, cctx->height * videoFrame->linesize[1]);
-			memset(videoFrame->data[2],0, cctx->height * videoFrame->linesize[2]);
-			*/
-			memset(videoFrame->buf[0]->data, 0, videoFrame->buf[0]->size);
+			// Bytes outside the written area were zeroed in AllocFrame() and stay untouched,
+			// unless a previous frame stored its IT in the chroma planes.
+			if (frameHasIT)
+			{
+				memset(videoFrame->buf[0]->data, 0, videoFrame->buf[0]->size);
+				frameHasIT = false;
+			}
 
 			for (int y = 0; y < frame_height; ++y)
 			{
 				unsigned char *d0 = videoFrame->data[0] + y * videoFrame->linesize[0];
 				unsigned char *d0_2 = videoFrame->data[0] + (frame_height + y) * videoFrame->linesize[0];
-
-				for (int i = 0; i < frame_width; ++i)
-				{
-					unsigned short v = data[i + y * frame_width];
-					d0[i] = v & 0xFF;
-					d0_2[i] = v >> 8;
-				}
+				splitPixels(data + y * frame_width, d0, d0_2, NULL, NULL, frame_width);
 			}
 		}
 
@@ -1141,20 +1247,8 @@ namespace rir
 		const unsigned short *data = img; //(const unsigned short*)tmp.constData();
 
 		int err;
-		if (!videoFrame)
-		{
-
-			videoFrame = av_frame_alloc();
-			videoFrame->format = file_format;
-			videoFrame->width = cctx->width;
-			videoFrame->height = cctx->height;
-
-			if ((err = av_frame_get_buffer(videoFrame, 32)) < 0)
-			{
-				RIR_LOG_ERROR("Failed to allocate picture with format %i, w = %i, h = %i", (int)file_format, cctx->width, cctx->height);
-				return false;
-			}
-		}
+		if (!AllocFrame())
+			return false;
 
 		bool kvazaar = strcmp(codec->name, "libkvazaar") == 0;
 
@@ -1181,31 +1275,20 @@ namespace rir
 				unsigned char *d0 = videoFrame->data[0] + y * videoFrame->linesize[0];
 				unsigned char *d1 = videoFrame->data[1] + y * videoFrame->linesize[1];
 				unsigned char *d2 = videoFrame->data[2] + y * videoFrame->linesize[2];
-				for (int i = 0; i < cctx->width; ++i)
-				{
-					unsigned short v = data[i + y * cctx->width];
-					d0[i] = IT[i + y * cctx->width];
-					d1[i] = v & 0xFF;
-					d2[i] = v >> 8;
-				}
+				splitPixels(data + y * cctx->width, d1, d2, IT + y * cctx->width, d0, cctx->width);
 			}
 		}
 		else
 		{ // AV_PIX_FMT_YUV420P
-			memset(videoFrame->buf[0]->data, 0, videoFrame->buf[0]->size);
+			// The written area is the same for each frame, the rest was zeroed in AllocFrame()
+			frameHasIT = true;
 
 			for (int y = 0; y < frame_height; ++y)
 			{
 				unsigned char *d0 = videoFrame->data[0] + y * videoFrame->linesize[0];
 				unsigned char *d0_2 = videoFrame->data[0] + (frame_height + y) * videoFrame->linesize[0];
 				unsigned char *d1 = videoFrame->data[1] + y * videoFrame->linesize[1];
-				for (int i = 0; i < frame_width; ++i)
-				{
-					unsigned short v = data[i + y * frame_width];
-					d0[i] = v & 0xFF;
-					d0_2[i] = v >> 8;
-					d1[i] = IT[i + y * frame_width];
-				}
+				splitPixels(data + y * frame_width, d0, d0_2, IT + y * frame_width, d1, frame_width);
 			}
 		}
 
@@ -1439,15 +1522,29 @@ namespace rir
 		return res;
 	}
 
+// maximum running average length: keeps the per pixel sums within 32 bits and the SSE4.1 pending counters within signed 16 bits
+#define RUNNING_AVERAGE_MAX_SIZE 64
+
+	/**
+	Running average of the last max_size images (at most RUNNING_AVERAGE_MAX_SIZE), used by the loss introduction algorithm.
+
+	Images are stored in a contiguous ring buffer, and the per pixel sums are updated incrementally by adding
+	the new image and subtracting the oldest one (vectorized with SSE4.1 when available).
+	resetPixel() replaces the history of a pixel by a constant value in O(1): this value is subtracted
+	instead of the ring buffer content for the next 'pending' removals.
+	*/
 	struct RunningAverage
 	{
 		int width;
 		int height;
 		int image_len;
-		int max_size; // max number of images
-		int size;	  // current number of images
-		int insert_pos;
+		int max_size;	// max number of images
+		int size;		// current number of images
+		int insert_pos; // ring buffer slot of the next image (oldest image when full)
 		std::vector<unsigned short> images;
+		std::vector<unsigned> sums;
+		std::vector<unsigned short> values;	 // reset values
+		std::vector<unsigned short> pending; // number of reset values still in the window
 
 		RunningAverage()
 			: width(0), height(0), image_len(0), max_size(0), size(0), insert_pos(0)
@@ -1455,163 +1552,245 @@ namespace rir
 		}
 		void reset(int w, int h, int max_images)
 		{
-			if (w == width && h == height && max_images == max_size)
-			{
-				size = 0;
-				insert_pos = 0;
-				return;
-			}
 			width = w;
 			height = h;
 			image_len = w * h;
-			max_size = max_images;
+			max_size = std::min(std::max(max_images, 0), RUNNING_AVERAGE_MAX_SIZE);
 			size = 0;
 			insert_pos = 0;
-			images.resize(w * h * max_images);
+			images.resize((size_t)image_len * max_size);
+			sums.assign(image_len, 0);
+			values.assign(image_len, 0);
+			pending.assign(image_len, 0);
 		}
 		void addImage(const unsigned short *img, int threads = 1)
 		{
-			if (size < max_size)
-			{
-				memcpy(images.data() + size * width * height, img, width * height * 2);
-				++size;
-			}
-			else
+			if (max_size <= 0)
+				return;
+			unsigned short *slot = images.data() + (size_t)insert_pos * image_len;
+			const bool remove = size == max_size;
+
+			bool sse41 = detectInstructionSet().HW_SSE41;
+#ifndef __SSE4_1__
+			sse41 = false;
+#endif
+			const int block = 4096;
+			const int blocks = (image_len + block - 1) / block;
+#pragma omp parallel for num_threads(threads)
+			for (int b = 0; b < blocks; ++b)
 			{
-				// move last images to beginning
-				// memmove(images.data(), images.data() + width*height , (max_size - 1)*width*height * 2);
-				// copy image at the right location
-				memcpy(images.data() + (insert_pos)*width * height, img, width * height * 2);
-				insert_pos++;
-				if (insert_pos >= max_size)
-					insert_pos = 0;
+				const int start = b * block;
+				const int end = std::min(start + block, image_len);
+				if (remove)
+					addRemove(img, slot, start, end, sse41);
+				else
+					add(img, slot, start, end, sse41);
 			}
+
+			if (size < max_size)
+				++size;
+			if (++insert_pos == max_size)
+				insert_pos = 0;
 		}
 		unsigned short pixel(int x, int y) const
 		{
-			int sum = 0;
-			int index = x + y * width;
-			for (int i = 0; i < size; ++i)
-			{
-				sum += images[i * image_len + index];
-			}
-			return size == 32 ? sum >> 5 : sum / size;
+			return pixel(x + y * width);
 		}
 		unsigned short pixel(int index) const
 		{
-			int sum = 0;
-			for (int i = 0; i < size; ++i)
-			{
-				sum += images[i * image_len + index];
-			}
-			return size == 32 ? sum >> 5 : sum / size;
+			return (unsigned short)(sums[index] / size);
 		}
 		void resetPixel(int x, int y, unsigned short value)
 		{
-			int index = x + y * width;
-			for (int i = 0; i < size; ++i)
+			resetPixel(x + y * width, value);
+		}
+		void resetPixel(int index, unsigned short value)
+		{
+			values[index] = value;
+			pending[index] = (unsigned short)size;
+			sums[index] = (unsigned)value * size;
+		}
+
+	private:
+		void add(const unsigned short *img, unsigned short *slot, int start, int end, bool sse41)
+		{
+			int i = start;
+			if (sse41)
+			{
+#ifdef __SSE4_1__
+				for (; i + 8 <= end; i += 8)
+				{
+					const __m128i v = _mm_loadu_si128((const __m128i *)(img + i));
+					_mm_storeu_si128((__m128i *)(slot + i), v);
+					__m128i *s = (__m128i *)(sums.data() + i);
+					_mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_cvtepu16_epi32(v)));
+					_mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), _mm_cvtepu16_epi32(_mm_srli_si128(v, 8))));
+				}
+#endif
+			}
+			for (; i < end; ++i)
 			{
-				images[i * image_len + index] = value;
+				slot[i] = img[i];
+				sums[i] += img[i];
 			}
 		}
-		void resetPixel(int index, unsigned short value)
+		void addRemove(const unsigned short *img, unsigned short *slot, int start, int end, bool sse41)
 		{
-			for (int i = 0; i < size; ++i)
+			int i = start;
+			if (sse41)
+			{
+#ifdef __SSE4_1__
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i one = _mm_set1_epi16(1);
+				for (; i + 8 <= end; i += 8)
+				{
+					const __m128i v = _mm_loadu_si128((const __m128i *)(img + i));
+					const __m128i p = _mm_loadu_si128((const __m128i *)(pending.data() + i));
+					// oldest value, or reset value if still pending (pending <= RUNNING_AVERAGE_MAX_SIZE, signed comparison is fine)
+					const __m128i sub = _mm_blendv_epi8(_mm_loadu_si128((const __m128i *)(slot + i)),
+														_mm_loadu_si128((const __m128i *)(values.data() + i)),
+														_mm_cmpgt_epi16(p, zero));
+					_mm_storeu_si128((__m128i *)(pending.data() + i), _mm_subs_epu16(p, one));
+					_mm_storeu_si128((__m128i *)(slot + i), v);
+					__m128i *s = (__m128i *)(sums.data() + i);
+					const __m128i lo = _mm_sub_epi32(_mm_cvtepu16_epi32(v), _mm_cvtepu16_epi32(sub));
+					const __m128i hi = _mm_sub_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8)), _mm_cvtepu16_epi32(_mm_srli_si128(sub, 8)));
+					_mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), lo));
+					_mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), hi));
+				}
+#endif
+			}
+			for (; i < end; ++i)
 			{
-				images[i * image_len + index] = value;
+				unsigned short sub = slot[i];
+				if (pending[i])
+				{
+					sub = values[i];
+					--pending[i];
+				}
+				sums[i] += (unsigned)img[i] - sub;
+				slot[i] = img[i];
 			}
 		}
 	};
 
-	struct RunningAverage2
+	/**
+	Statistics of one tile of rows, see computeFrameStats()
+	*/
+	struct FrameStats
 	{
-		struct Const
-		{
-			unsigned short value;
-			short count;
-			Const() : value(0), count(0) {}
-		};
-		size_t width;
-		size_t height;
-		size_t image_len;
-		size_t max_size; // max number of images
-
-		std::vector<std::vector<unsigned short>> images;
-		std::vector<unsigned> sums;
-		std::vector<Const> consts;
+		// histogram of the background source, 4 values wide bins
+		std::vector<uint32_t> hist;
+		// difference with the previous image, binned on (split value + 2) >> 2, so that the split
+		// 'value > background' (background being a 4 values wide bin start + 1) falls on a bin boundary
+		std::vector<uint64_t> count;
+		std::vector<uint64_t> sum;
+		std::vector<uint64_t> sum2;
+		// used bin ranges
+		unsigned hist_lo, hist_hi, bin_lo, bin_hi;
 
-		RunningAverage2()
-			: width(0), height(0), image_len(0), max_size(0)
+		FrameStats()
+			: hist(16384, 0), count(16385, 0), sum(16385, 0), sum2(16385, 0), hist_lo(16384), hist_hi(0), bin_lo(16385), bin_hi(0)
 		{
 		}
-		void reset(size_t w, size_t h, size_t max_images)
+		void clear()
 		{
-
-			width = w;
-			height = h;
-			image_len = w * h;
-			max_size = max_images;
-			sums.resize(image_len);
-			std::fill_n(sums.begin(), sums.size(), 0);
-			consts.resize(image_len);
-			std::fill_n(consts.begin(), consts.size(), Const());
+			if (hist_lo <= hist_hi)
+				std::fill(hist.begin() + hist_lo, hist.begin() + hist_hi + 1, 0);
+			if (bin_lo <= bin_hi)
+			{
+				std::fill(count.begin() + bin_lo, count.begin() + bin_hi + 1, 0);
+				std::fill(sum.begin() + bin_lo, sum.begin() + bin_hi + 1, 0);
+				std::fill(sum2.begin() + bin_lo, sum2.begin() + bin_hi + 1, 0);
+			}
+			hist_lo = 16384;
+			hist_hi = 0;
+			bin_lo = 16385;
+			bin_hi = 0;
 		}
-		void addImage(const unsigned short *img, int threads = 1)
+		void merge(const FrameStats &o)
 		{
-
-			// update sums
-#pragma omp parallel for num_threads(threads)
-			for (int i = 0; i < (int)image_len; ++i)
+			for (unsigned i = o.hist_lo; i <= o.hist_hi && o.hist_lo <= o.hist_hi; ++i)
+				hist[i] += o.hist[i];
+			for (unsigned i = o.bin_lo; i <= o.bin_hi && o.bin_lo <= o.bin_hi; ++i)
 			{
-				// add last image
-				sums[i] += img[i];
+				count[i] += o.count[i];
+				sum[i] += o.sum[i];
+				sum2[i] += o.sum2[i];
+			}
+			hist_lo = std::min(hist_lo, o.hist_lo);
+			hist_hi = std::max(hist_hi, o.hist_hi);
+			bin_lo = std::min(bin_lo, o.bin_lo);
+			bin_hi = std::max(bin_hi, o.bin_hi);
+		}
 
-				if (images.size() == max_size)
+		/**
+		Returns the image background, i.e. the first value of the most populated 4 DL wide bin + 1
+		*/
+		unsigned background() const
+		{
+			uint32_t max = 0;
+			unsigned res = hist_lo <= hist_hi ? hist_lo : 0;
+			for (unsigned i = hist_lo; i <= hist_hi && hist_lo <= hist_hi; ++i)
+			{
+				if (hist[i] > max)
 				{
-					// remove first image
-					if (consts[i].count)
-					{
-						--consts[i].count;
-						sums[i] -= consts[i].value;
-					}
-					else if (images.size() > 0)
-						sums[i] -= images[0][i];
+					max = hist[i];
+					res = i;
 				}
 			}
+			return (res << 2) + 1;
+		}
 
-			// update images
-			if (images.size() < max_size)
+		/**
+		Returns the standard deviation of the difference with the previous image.
+		If \a background is not NULL, returns the values for pixels <= background and > background.
+		*/
+		std::pair<double, double> stdDev(const unsigned *background = NULL) const
+		{
+			// first bin containing values > background
+			const unsigned split = background ? ((*background - 1) >> 2) + 1 : 16385;
+			uint64_t b_sum = 0, b_sum_diff = 0, b_sum_diff2 = 0;
+			uint64_t f_sum = 0, f_sum_diff = 0, f_sum_diff2 = 0;
+			for (unsigned i = bin_lo; i <= bin_hi && bin_lo <= bin_hi; ++i)
 			{
-				images.push_back(std::vector<unsigned short>(img, img + image_len));
+				if (i < split)
+				{
+					b_sum += count[i];
+					b_sum_diff += sum[i];
+					b_sum_diff2 += sum2[i];
+				}
+				else
+				{
+					f_sum += count[i];
+					f_sum_diff += sum[i];
+					f_sum_diff2 += sum2[i];
+				}
 			}
-			else
+			const double bd = (double)b_sum_diff;
+			const double fd = (double)f_sum_diff;
+			if (!background)
 			{
-				std::vector<unsigned short> tmp = std::move(images[0]);
-				std::copy(img, img + image_len, tmp.begin());
-				images.erase(images.begin());
-				images.push_back(std::move(tmp));
+				double res = std::sqrt((bd * bd - (double)b_sum_diff2)) / (double)b_sum;
+				return std::pair<double, double>(res, res);
 			}
+			return std::pair<double, double>(std::sqrt((bd * bd - (double)b_sum_diff2)) / (double)b_sum,
+											 std::sqrt((fd * fd - (double)f_sum_diff2)) / (double)f_sum);
 		}
-		unsigned short pixel(size_t x, size_t y) const
-		{
-			size_t index = x + y * width;
-			return pixel(index);
-		}
-		unsigned short pixel(size_t index) const
-		{
-			return sums[index] / images.size();
-		}
-		void resetPixel(size_t x, size_t y, unsigned short value)
-		{
-			size_t index = x + y * width;
-			resetPixel(index, value);
-		}
-		void resetPixel(size_t index, unsigned short value)
-		{
-			consts[index].value = value;
-			consts[index].count = images.size();
-			sums[index] = (unsigned)value * images.size();
-		}
+	};
+
+	/**
+	Frame queued between the stages of an asynchronous H264_Saver
+	*/
+	struct SaverFrame
+	{
+		std::vector<unsigned short> pixels;
+		std::vector<unsigned char> IT;
+		int64_t timestamp;
+		std::map<std::string, std::string> attributes;
+		bool is_key;
+
+		SaverFrame() : timestamp(0), is_key(false) {}
 	};
 
 	class H264_Saver::PrivateData
@@ -1619,6 +1798,8 @@ namespace rir
 	public:
 		H264Capture *encoder;
 		FileAttributes attributes;
+		// protect attributes when the encoding stage runs in its own thread
+		std::mutex attributesMutex;
 		int compressionLevel;
 		int lowValueError;
 		int highValueError;
@@ -1655,14 +1836,45 @@ namespace rir
 		std::vector<unsigned short> lowError;
 		std::vector<unsigned short> highError;
 		// std::vector < std::vector<unsigned short> > cum;
-		RunningAverage2 cum;
+		RunningAverage cum;
 		unsigned runningAverage;
-		unsigned hist[65536 >> 2];
+		std::vector<FrameStats> stats;
+
+		// asynchronous pipeline: caller -> analysis thread -> encoding thread
+		int asyncQueue;
+		bool asyncRunning;
+		std::thread analysisThread;
+		std::thread encodeThread;
+		std::mutex pipelineMutex;
+		std::condition_variable pipelineCond;
+		std::deque<SaverFrame> analysisQueue;
+		std::deque<SaverFrame> encodeQueue;
+		std::vector<SaverFrame> pool;
+		bool analysing;
+		bool encoding;
+		bool stopAnalysis;
+		bool stopEncode;
+		bool pipelineError;
 
 		PrivateData() : encoder(NULL), compressionLevel(0), lowValueError(6), highValueError(2),
 						width(0), height(0), stop_lossy_height(0),
 						fps(0), keyCount(0), frameCount(0), GOP(50), threads(NUM_THREADS_H264), slices(1), smartSmooth(0), inputCamera(0), bp_enabled(false), subtractMin(false), subtractLocalMin(false), meanStdDev(0),
-						stdFactor(5), runningAverage(32) {}
+						stdFactor(5), runningAverage(32), asyncQueue(0), asyncRunning(false), analysing(false), encoding(false),
+						stopAnalysis(false), stopEncode(false), pipelineError(false) {}
+
+		SaverFrame takeFrame()
+		{
+			if (pool.empty())
+				return SaverFrame();
+			SaverFrame f = std::move(pool.back());
+			pool.pop_back();
+			return f;
+		}
+		void recycle(SaverFrame &f)
+		{
+			if (pool.size() < (size_t)asyncQueue * 2)
+				pool.push_back(std::move(f));
+		}
 	};
 
 	H264_Saver::H264_Saver()
@@ -1680,6 +1892,7 @@ namespace rir
 
 	void H264_Saver::setCompressionLevel(int clevel)
 	{
+		waitPipeline();
 		m_data->compressionLevel = clevel;
 		;
 	}
@@ -1690,6 +1903,7 @@ namespace rir
 
 	void H264_Saver::setLowValueError(int max_error_T)
 	{
+		waitPipeline();
 		m_data->lowValueError = max_error_T;
 	}
 	int H264_Saver::lowValueError() const
@@ -1699,6 +1913,7 @@ namespace rir
 
 	void H264_Saver::setHighValueError(int max_error_T)
 	{
+		waitPipeline();
 		m_data->highValueError = max_error_T;
 	}
 	int H264_Saver::highValueError() const
@@ -1708,6 +1923,11 @@ namespace rir
 
 	bool H264_Saver::setParameter(const char *key, const char *value)
 	{
+		// the worker threads read the parameters: wait for them to be idle
+		if (m_data->asyncRunning && strcmp(key, "asyncQueue") == 0)
+			return false;
+		waitPipeline();
+
 		if (strcmp(key, "lowValueError") == 0)
 		{
 			setLowValueError(fromString<int>(value));
@@ -1770,13 +1990,16 @@ namespace rir
 		}
 		else if (strcmp(key, "runningAverage") == 0)
 		{
-			m_data->runningAverage = fromString<int>(value);
-			if (m_data->runningAverage > 64)
-				m_data->runningAverage = 64;
+			m_data->runningAverage = std::min(std::max(fromString<int>(value), 0), RUNNING_AVERAGE_MAX_SIZE);
 			if (m_data->cum.max_size != (int)m_data->runningAverage && m_data->cum.width > 0)
 				m_data->cum.reset(m_data->cum.width, m_data->cum.height, m_data->runningAverage);
 			return true;
 		}
+		else if (strcmp(key, "asyncQueue") == 0)
+		{
+			m_data->asyncQueue = std::max(0, fromString<int>(value));
+			return true;
+		}
 		return false;
 	}
 
@@ -1834,6 +2057,10 @@ namespace rir
 		{
 			return toString(m_data->runningAverage);
 		}
+		else if (strcmp(key, "asyncQueue") == 0)
+		{
+			return toString(m_data->asyncQueue);
+		}
 		return std::string();
 	}
 
@@ -1877,14 +2104,19 @@ namespace rir
 		m_data->localMins.clear();
 		m_data->attributes.open(filename);
 
+		if (m_data->asyncQueue > 0)
+			startPipeline();
 		return true;
 	}
 
-	void H264_Saver::close()
+	bool H264_Saver::close()
 	{
+		bool res = true;
 		if (m_data->encoder)
 		{
-			m_data->encoder->Finish();
+			res = stopPipeline();
+			if (!m_data->encoder->Finish())
+				res = false;
 			delete m_data->encoder;
 			m_data->encoder = NULL;
 			m_data->lastDL.clear();
@@ -1909,42 +2141,183 @@ namespace rir
 			}
 			m_data->attributes.close();
 		}
+		return res;
+	}
+
+	void H264_Saver::startPipeline()
+	{
+		m_data->analysisQueue.clear();
+		m_data->encodeQueue.clear();
+		m_data->analysing = m_data->encoding = false;
+		m_data->stopAnalysis = m_data->stopEncode = false;
+		m_data->pipelineError = false;
+		m_data->asyncRunning = true;
+		m_data->analysisThread = std::thread(std::bind(&H264_Saver::analysisLoop, this));
+		m_data->encodeThread = std::thread(std::bind(&H264_Saver::encodeLoop, this));
+	}
+
+	bool H264_Saver::stopPipeline()
+	{
+		if (!m_data->asyncRunning)
+			return true;
+		// the analysis stage is stopped first as it feeds the encoding stage, both drain their queue before leaving
+		{
+			std::lock_guard<std::mutex> lock(m_data->pipelineMutex);
+			m_data->stopAnalysis = true;
+		}
+		m_data->pipelineCond.notify_all();
+		m_data->analysisThread.join();
+		{
+			std::lock_guard<std::mutex> lock(m_data->pipelineMutex);
+			m_data->stopEncode = true;
+		}
+		m_data->pipelineCond.notify_all();
+		m_data->encodeThread.join();
+		m_data->asyncRunning = false;
+		m_data->pool.clear();
+		bool res = !m_data->pipelineError;
+		m_data->pipelineError = false;
+		return res;
+	}
+
+	void H264_Saver::waitPipeline()
+	{
+		if (!m_data->asyncRunning)
+			return;
+		std::unique_lock<std::mutex> lock(m_data->pipelineMutex);
+		while (!m_data->analysisQueue.empty() || !m_data->encodeQueue.empty() || m_data->analysing || m_data->encoding)
+			m_data->pipelineCond.wait(lock);
+	}
+
+	bool H264_Saver::flush()
+	{
+		if (!m_data->asyncRunning)
+			return true;
+		waitPipeline();
+		std::lock_guard<std::mutex> lock(m_data->pipelineMutex);
+		bool res = !m_data->pipelineError;
+		m_data->pipelineError = false;
+		return res;
+	}
+
+	void H264_Saver::analysisLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_data->pipelineMutex);
+		while (true)
+		{
+			while (m_data->analysisQueue.empty() && !m_data->stopAnalysis)
+				m_data->pipelineCond.wait(lock);
+			if (m_data->analysisQueue.empty())
+				break;
+
+			SaverFrame f = std::move(m_data->analysisQueue.front());
+			m_data->analysisQueue.pop_front();
+			m_data->analysing = true;
+			lock.unlock();
+			m_data->pipelineCond.notify_all();
+
+			bool res = addImageLossyNoCamera(f.pixels.data(), f.timestamp, f.attributes);
+
+			lock.lock();
+			m_data->analysing = false;
+			if (!res)
+				m_data->pipelineError = true;
+			m_data->recycle(f);
+			m_data->pipelineCond.notify_all();
+		}
+	}
+
+	void H264_Saver::encodeLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_data->pipelineMutex);
+		while (true)
+		{
+			while (m_data->encodeQueue.empty() && !m_data->stopEncode)
+				m_data->pipelineCond.wait(lock);
+			if (m_data->encodeQueue.empty())
+				break;
+
+			SaverFrame f = std::move(m_data->encodeQueue.front());
+			m_data->encodeQueue.pop_front();
+			m_data->encoding = true;
+			lock.unlock();
+			m_data->pipelineCond.notify_all();
+
+			bool res = writeImage(f.pixels.data(), f.IT.empty() ? NULL : f.IT.data(), f.timestamp, f.attributes, f.is_key);
+
+			lock.lock();
+			m_data->encoding = false;
+			if (!res)
+				m_data->pipelineError = true;
+			m_data->recycle(f);
+			m_data->pipelineCond.notify_all();
+		}
+	}
+
+	bool H264_Saver::encodeFrame(const unsigned short *img, const unsigned char *IT, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes, bool is_key)
+	{
+		if (!m_data->asyncRunning)
+			return writeImage(img, IT, timestamp_ns, attributes, is_key);
+
+		// called from the analysis thread (or the caller thread with an input camera): hand the frame to the encoding stage
+		std::unique_lock<std::mutex> lock(m_data->pipelineMutex);
+		while ((int)m_data->encodeQueue.size() >= m_data->asyncQueue)
+			m_data->pipelineCond.wait(lock);
+		SaverFrame f = m_data->takeFrame();
+		lock.unlock();
+
+		const size_t size = (size_t)m_data->width * m_data->height;
+		f.pixels.assign(img, img + size);
+		if (IT)
+			f.IT.assign(IT, IT + size);
+		else
+			f.IT.clear();
+		f.timestamp = timestamp_ns;
+		f.attributes = attributes;
+		f.is_key = is_key;
+
+		lock.lock();
+		m_data->encodeQueue.push_back(std::move(f));
+		lock.unlock();
+		m_data->pipelineCond.notify_all();
+		return true;
 	}
 
 	void H264_Saver::addGlobalAttribute(const std::string &key, const std::string &value)
 	{
+		std::lock_guard<std::mutex> lock(m_data->attributesMutex);
 		m_data->attributes.addGlobalAttribute(key, value);
 	}
 	void H264_Saver::clearGlobalAttributes()
 	{
-		setGlobalAttributes(std::map<std::string, std::string>());
+		std::lock_guard<std::mutex> lock(m_data->attributesMutex);
+		m_data->attributes.setGlobalAttributes(std::map<std::string, std::string>());
 	}
 	void H264_Saver::setGlobalAttributes(const std::map<std::string, std::string> &attributes)
 	{
+		std::lock_guard<std::mutex> lock(m_data->attributesMutex);
 		m_data->attributes.setGlobalAttributes(attributes);
 	}
 	bool H264_Saver::addImageLossLess(const unsigned short *img, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes, bool is_key)
 	{
-		if (!isOpen())
-			return false;
-
-		if (!m_data->encoder->AddFrame(img, is_key))
-			return false;
-
-		++m_data->frameCount;
-		m_data->attributes.resize(m_data->frameCount);
-		m_data->attributes.setTimestamp(m_data->frameCount - 1, timestamp_ns);
-		m_data->attributes.setAttributes(m_data->frameCount - 1, attributes);
-		return true;
+		// frames queued by addImageLossy() come first, and the encoder must not be used by the worker threads
+		waitPipeline();
+		return writeImage(img, NULL, timestamp_ns, attributes, is_key);
 	}
 	bool H264_Saver::addImageLossLess(const unsigned short *img, const unsigned char *IT, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes, bool is_key)
+	{
+		waitPipeline();
+		return writeImage(img, IT, timestamp_ns, attributes, is_key);
+	}
+	bool H264_Saver::writeImage(const unsigned short *img, const unsigned char *IT, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes, bool is_key)
 	{
 		if (!isOpen())
 			return false;
 
-		if (!m_data->encoder->AddFrame(img, IT, is_key))
+		if (!(IT ? m_data->encoder->AddFrame(img, IT, is_key) : m_data->encoder->AddFrame(img, is_key)))
 			return false;
 
+		std::lock_guard<std::mutex> lock(m_data->attributesMutex);
 		++m_data->frameCount;
 		m_data->attributes.resize(m_data->frameCount);
 		m_data->attributes.setTimestamp(m_data->frameCount - 1, timestamp_ns);
@@ -1952,91 +2325,142 @@ namespace rir
 		return true;
 	}
 
-	static unsigned get_background(const unsigned short *im, unsigned *hist, int size, unsigned short *min = NULL)
+	/**
+	Single sweep over the lossy part of a frame used by the loss introduction algorithm.
+	For each pixel:
+		-	subtract \a min to \a T (saturated to 0) if \a min is not 0,
+		-	extract integration time from \a back_src if \a IT is not NULL,
+		-	accumulate the histogram of \a back_src (used to compute the background),
+		-	accumulate the difference between \a T and \a prev, split on \a split_src values.
+	Rows are split in tiles processed in parallel, each tile having its own FrameStats. Results are merged into tiles[0].
+	*/
+	static void computeFrameStats(std::vector<FrameStats> &tiles, int threads, unsigned short *T, const unsigned short *prev, const unsigned short *back_src,
+								  const unsigned short *split_src, unsigned short min, unsigned char *IT, int width, int height)
 	{
-		memset(hist, 0, (65536 >> 2) * 4);
-		const unsigned short *ptr = im;
-		if (!min)
-		{
-			for (int i = 0; i < size; ++i)
-				hist[ptr[i] >> 2]++;
-		}
-		else
-		{
-			unsigned short m = 65535;
-			for (int i = 0; i < size; ++i)
+		if (threads < 1)
+			threads = 1;
+		if (threads > height)
+			threads = std::max(1, height);
+		if ((int)tiles.size() < threads)
+			tiles.resize(threads);
+		for (int t = 0; t < threads; ++t)
+			tiles[t].clear();
+
+		bool sse2 = detectInstructionSet().HW_SSE2;
+#ifndef __SSE2__
+		sse2 = false;
+#endif
+
+#pragma omp parallel for num_threads(threads)
+		for (int t = 0; t < threads; ++t)
+		{
+			FrameStats &st = tiles[t];
+			uint32_t *hist = st.hist.data();
+			uint64_t *count = st.count.data();
+			uint64_t *sum = st.sum.data();
+			uint64_t *sum2 = st.sum2.data();
+			unsigned hist_lo = st.hist_lo, hist_hi = st.hist_hi, bin_lo = st.bin_lo, bin_hi = st.bin_hi;
+			unsigned short diffs[256];
+
+			const size_t start = (size_t)height * t / threads * width;
+			const size_t end = (size_t)height * (t + 1) / threads * width;
+			for (size_t chunk = start; chunk < end; chunk += 256)
 			{
-				hist[ptr[i] >> 2]++;
-				if (ptr[i] < m)
-					m = ptr[i];
+				const int n = (int)std::min((size_t)256, end - chunk);
+				unsigned short *v = T + chunk;
+				const unsigned short *p = prev + chunk;
+				int i = 0;
+				if (sse2)
+				{
+#ifdef __SSE2__
+					const __m128i m = _mm_set1_epi16((short)min);
+					for (; i + 8 <= n; i += 8)
+					{
+						const __m128i a = _mm_subs_epu16(_mm_loadu_si128((const __m128i *)(v + i)), m);
+						const __m128i b = _mm_loadu_si128((const __m128i *)(p + i));
+						_mm_storeu_si128((__m128i *)(v + i), a);
+						_mm_storeu_si128((__m128i *)(diffs + i), _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a)));
+					}
+#endif
+				}
+				for (; i < n; ++i)
+				{
+					if (v[i] < min)
+						v[i] = 0;
+					else
+						v[i] -= min;
+					diffs[i] = (unsigned short)std::abs((int)v[i] - (int)p[i]);
+				}
+
+				const unsigned short *bs = back_src + chunk;
+				const unsigned short *ss = split_src + chunk;
+				if (IT)
+				{
+					unsigned char *it = IT + chunk;
+					for (i = 0; i < n; ++i)
+						it[i] = (unsigned char)(bs[i] >> 13);
+				}
+				for (i = 0; i < n; ++i)
+				{
+					const unsigned h = bs[i] >> 2;
+					const unsigned b = ((unsigned)ss[i] + 2) >> 2;
+					const uint64_t d = diffs[i];
+					hist[h]++;
+					count[b]++;
+					sum[b] += d;
+					sum2[b] += d * d;
+					hist_lo = std::min(hist_lo, h);
+					hist_hi = std::max(hist_hi, h);
+					bin_lo = std::min(bin_lo, b);
+					bin_hi = std::max(bin_hi, b);
+				}
 			}
+			st.hist_lo = hist_lo;
+			st.hist_hi = hist_hi;
+			st.bin_lo = bin_lo;
+			st.bin_hi = bin_hi;
 		}
 
-		unsigned max = hist[0];
-		unsigned index = 0;
-		for (int i = 1; i < (65536 >> 2); ++i)
+		for (int t = 1; t < threads; ++t)
 		{
-			if (hist[i] > max)
-			{
-				max = hist[i];
-				index = i;
-			}
+			tiles[0].merge(tiles[t]);
+			tiles[t].clear();
 		}
-		// compute number of pixels before
-		/*int count = 0;
-		for (int i = index; i >= 0; --i)
-		count += hist[i];
-		printf("under back: %f\n", (double)count / size);*/
-		return (index << 2) + 1;
 	}
 
-	static std::pair<double, double> stdDev(const unsigned short *prev, const unsigned short *img, int width, int height, const unsigned short *img_DL = NULL, unsigned *back = NULL)
+	bool H264_Saver::addImageLossy(const unsigned short *img, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes)
 	{
-		if (!back || !img_DL)
+		if (m_data->asyncRunning)
 		{
-			double sum_diff2 = 0;
-			double sum_diff = 0;
-			int s = height * width;
-			for (int i = 0; i < s; ++i)
+			std::unique_lock<std::mutex> lock(m_data->pipelineMutex);
+			if (m_data->pipelineError)
 			{
-				int diff = std::abs(img[i] - prev[i]);
-				sum_diff2 += diff * diff;
-				sum_diff += diff;
+				m_data->pipelineError = false;
+				return false;
 			}
-			double res = std::sqrt((sum_diff * sum_diff - sum_diff2)) / s;
-			return std::pair<double, double>(res, res);
 		}
-		else
-		{
-			double sum_diff2 = 0;
-			double sum_diff = 0;
-			double b_sum_diff2 = 0;
-			double b_sum_diff = 0;
-			int s = height * width;
-			int b_sum = 0, sum = 0;
-			for (int i = 0; i < s; ++i)
-			{
-				int diff = std::abs(img[i] - prev[i]);
-				if (img_DL[i] > *back)
-				{
-					sum_diff2 += diff * diff;
-					sum_diff += diff;
-					sum++;
-				}
-				else
-				{
-					b_sum_diff2 += diff * diff;
-					b_sum_diff += diff;
-					b_sum++;
-				}
-			}
-			return std::pair<double, double>(std::sqrt((b_sum_diff * b_sum_diff - b_sum_diff2)) / b_sum,
-											 std::sqrt((sum_diff * sum_diff - sum_diff2)) / sum);
+		// The input camera calibration depends on the loader state and the caller keeps reading from it:
+		// in this case the analysis stage runs on the calling thread and only the encoding is asynchronous.
+		if (m_data->asyncRunning && !m_data->inputCamera)
+		{
+			std::unique_lock<std::mutex> lock(m_data->pipelineMutex);
+			while ((int)m_data->analysisQueue.size() >= m_data->asyncQueue)
+				m_data->pipelineCond.wait(lock);
+			SaverFrame f = m_data->takeFrame();
+			lock.unlock();
+
+			f.pixels.assign(img, img + (size_t)m_data->width * m_data->height);
+			f.IT.clear();
+			f.timestamp = timestamp_ns;
+			f.attributes = attributes;
+
+			lock.lock();
+			m_data->analysisQueue.push_back(std::move(f));
+			lock.unlock();
+			m_data->pipelineCond.notify_all();
+			return true;
 		}
-	}
 
-	bool H264_Saver::addImageLossy(const unsigned short *img, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes)
-	{
 		if (m_data->inputCamera)
 			// In this case the input image must be in DL
 			return addImageLossyWithCamera(img, timestamp_ns, attributes);
@@ -2057,7 +2481,7 @@ namespace rir
 
 		if (m_data->bp_enabled)
 		{
-			if (m_data->attributes.size() == 0)
+			if (m_data->lowError.empty())
 				m_data->bp.init(img_DL, m_data->width, m_data->stop_lossy_height);
 			m_data->bp.correct(img_DL, m_data->tmp.data());
 			// copy the rest
@@ -2068,8 +2492,9 @@ namespace rir
 			// copy the full image
 			std::copy(img_DL, img_DL + m_data->width * m_data->height, m_data->tmp.begin());
 		}
+		if (m_data->lowError.empty())
 		{
-			// compute integration time
+			// compute integration time (done by computeFrameStats() for the next frames)
 			int s = m_data->width * m_data->stop_lossy_height;
 			for (int i = 0; i < s; ++i)
 				m_data->IT[i] = m_data->tmp[i] >> 13;
@@ -2078,7 +2503,7 @@ namespace rir
 				m_data->IT[i] = 0;
 		}
 
-		if (m_data->attributes.size() == 0)
+		if (m_data->lowError.empty())
 		{
 			// First image
 
@@ -2116,7 +2541,7 @@ namespace rir
 			addGlobalAttribute("GlobalBackgroundError", toString(m_data->lowValueError));
 			addGlobalAttribute("GlobalForegroundError", toString(m_data->highValueError));
 
-			bool res = addImageLossLess(m_data->tmp.data(), m_data->IT.data(), timestamp_ns, attributes);
+			bool res = encodeFrame(m_data->tmp.data(), m_data->IT.data(), timestamp_ns, attributes);
 
 			m_data->lowError.push_back(m_data->lowValueError);
 			m_data->highError.push_back(m_data->highValueError);
@@ -2130,38 +2555,28 @@ namespace rir
 		std::copy(m_data->tmp.begin(), m_data->tmp.end(), m_data->tmpT.begin());
 		l->calibrateInplace(m_data->tmpT.data(), m_data->width * m_data->stop_lossy_height, 1);
 
-		// subtract min to image T
 		int s = m_data->width * m_data->stop_lossy_height;
 
-		if (m_data->subtractMin || m_data->subtractLocalMin)
+		// recompute min for subtractLocalMin
+		if (m_data->subtractLocalMin)
 		{
-			// recompute min for subtractLocalMin
-			if (m_data->subtractLocalMin)
-			{
-				unsigned min = 65535;
-				int s = m_data->width * m_data->stop_lossy_height;
-				for (int i = 0; i < s; ++i)
-					if (m_data->tmpT[i] < m_data->min)
-						m_data->min = m_data->tmpT[i];
-				if (min < m_data->min)
-					m_data->min = min;
-				m_data->localMins.push_back(m_data->min);
-				// printf("First image min: %i\n", (int)m_data->min);
-			}
-
-			// subtract min T
-#pragma omp parallel for num_threads(threads)
+			unsigned min = 65535;
 			for (int i = 0; i < s; ++i)
-			{
 				if (m_data->tmpT[i] < m_data->min)
-					m_data->tmpT[i] = 0;
-				else
-					m_data->tmpT[i] -= m_data->min;
-			}
+					m_data->min = m_data->tmpT[i];
+			if (min < m_data->min)
+				m_data->min = min;
+			m_data->localMins.push_back(m_data->min);
+			// printf("First image min: %i\n", (int)m_data->min);
 		}
 
+		// subtract min T, extract integration times, compute background and differences with previous image
+		computeFrameStats(m_data->stats, threads, m_data->tmpT.data(), m_data->prevT.data(), m_data->tmp.data(), img_DL,
+						  (m_data->subtractMin || m_data->subtractLocalMin) ? m_data->min : 0, m_data->IT.data(), m_data->width, m_data->stop_lossy_height);
+		std::fill(m_data->IT.begin() + s, m_data->IT.end(), 0);
+
 		bool res = false;
-		unsigned background = get_background(m_data->tmp.data(), m_data->hist, m_data->width * m_data->stop_lossy_height);
+		unsigned background = m_data->stats[0].background();
 
 		int lowError = m_data->lowValueError;
 		int highError = m_data->highValueError;
@@ -2169,9 +2584,9 @@ namespace rir
 		int running_average_frames = 40;
 		int start_running_average_frames = 1;
 		if ((int)m_data->stdDevs.size() < running_average_frames)
-			std = stdDev(m_data->prevT.data(), m_data->tmpT.data(), m_data->width, m_data->stop_lossy_height);
+			std = m_data->stats[0].stdDev();
 		else
-			std = stdDev(m_data->prevT.data(), m_data->tmpT.data(), m_data->width, m_data->stop_lossy_height, img_DL, &background);
+			std = m_data->stats[0].stdDev(&background);
 		if ((int)m_data->firstStdDevs.size() < start_running_average_frames)
 			m_data->firstStdDevs.push_back(std);
 
@@ -2245,7 +2660,7 @@ namespace rir
 		// copy the remaining DL values (last X lines)
 		std::copy(m_data->tmp.data() + m_data->width * m_data->stop_lossy_height, m_data->tmp.data() + m_data->width * m_data->height, m_data->tmpT.data() + m_data->width * m_data->stop_lossy_height);
 
-		res = addImageLossLess(m_data->tmpT.data(), m_data->IT.data(), timestamp_ns, attrs);
+		res = encodeFrame(m_data->tmpT.data(), m_data->IT.data(), timestamp_ns, attrs);
 
 		return res;
 	}
@@ -2258,7 +2673,7 @@ namespace rir
 
 		if (m_data->bp_enabled)
 		{
-			if (m_data->attributes.size() == 0)
+			if (m_data->lowError.empty())
 				m_data->bp.init(img, m_data->width, m_data->stop_lossy_height);
 			m_data->bp.correct(img, m_data->tmp.data());
 			// copy the rest
@@ -2270,7 +2685,7 @@ namespace rir
 			std::copy(img, img + m_data->width * m_data->height, m_data->tmp.begin());
 		}
 
-		if (m_data->attributes.size() == 0)
+		if (m_data->lowError.empty())
 		{
 			// First image
 
@@ -2304,7 +2719,7 @@ namespace rir
 			m_data->lowError.push_back(m_data->lowValueError);
 			m_data->highError.push_back(m_data->highValueError);
 
-			bool res = addImageLossLess(m_data->tmp.data(), timestamp_ns, attributes);
+			bool res = encodeFrame(m_data->tmp.data(), NULL, timestamp_ns, attributes);
 
 			memcpy(m_data->refT.data(), m_data->tmp.data(), m_data->width * m_data->stop_lossy_height * 2);
 			memcpy(m_data->prevT.data(), m_data->tmp.data(), m_data->width * m_data->stop_lossy_height * 2);
@@ -2314,23 +2729,12 @@ namespace rir
 		// convert to T
 		std::copy(m_data->tmp.begin(), m_data->tmp.end(), m_data->tmpT.begin());
 
-		// subtract min to image T
-		int s = m_data->width * m_data->stop_lossy_height;
-
-		if (m_data->subtractMin)
-		{
-#pragma omp parallel for num_threads(threads)
-			for (int i = 0; i < s; ++i)
-			{
-				if (m_data->tmpT[i] < m_data->min)
-					m_data->tmpT[i] = 0;
-				else
-					m_data->tmpT[i] -= m_data->min;
-			}
-		}
+		// subtract min T, compute background and differences with previous image
+		computeFrameStats(m_data->stats, threads, m_data->tmpT.data(), m_data->prevT.data(), m_data->tmp.data(), img,
+						  m_data->subtractMin ? m_data->min : 0, NULL, m_data->width, m_data->stop_lossy_height);
 
 		bool res = false;
-		unsigned background = get_background(m_data->tmp.data(), m_data->hist, m_data->width * m_data->stop_lossy_height);
+		unsigned background = m_data->stats[0].background();
 
 		int lowError = m_data->lowValueError;
 		int highError = m_data->highValueError;
@@ -2338,9 +2742,9 @@ namespace rir
 		int running_average_frames = 40;
 		int start_running_average_frames = 1;
 		if ((int)m_data->stdDevs.size() < running_average_frames)
-			std = stdDev(m_data->prevT.data(), m_data->tmpT.data(), m_data->width, m_data->stop_lossy_height);
+			std = m_data->stats[0].stdDev();
 		else
-			std = stdDev(m_data->prevT.data(), m_data->tmpT.data(), m_data->width, m_data->stop_lossy_height, img, &background);
+			std = m_data->stats[0].stdDev(&background);
 		if ((int)m_data->firstStdDevs.size() < start_running_average_frames)
 			m_data->firstStdDevs.push_back(std);
 
@@ -2418,13 +2822,16 @@ namespace rir
 		// copy the remaining DL values (last X lines)
 		std::copy(m_data->tmp.data() + m_data->width * m_data->stop_lossy_height, m_data->tmp.data() + m_data->width * m_data->height, m_data->tmpT.data() + m_data->width * m_data->stop_lossy_height);
 
-		res = addImageLossLess(m_data->tmpT.data(), timestamp_ns, attrs, is_key);
+		res = encodeFrame(m_data->tmpT.data(), NULL, timestamp_ns, attrs, is_key);
 
 		return res;
 	}
 
 	bool H264_Saver::addLoss(unsigned short *img)
 	{
+		// the loss introduction state is shared with the analysis thread
+		waitPipeline();
+
 		int threads = m_data->threads;
 		if (threads < 1)
 			threads = 1;
@@ -2491,23 +2898,12 @@ namespace rir
 		// convert to T
 		std::copy(m_data->tmp.begin(), m_data->tmp.end(), m_data->tmpT.begin());
 
-		// subtract min to image T
-		int s = m_data->width * m_data->stop_lossy_height;
-
-		if (m_data->subtractMin)
-		{
-#pragma omp parallel for num_threads(threads)
-			for (int i = 0; i < s; ++i)
-			{
-				if (m_data->tmpT[i] < m_data->min)
-					m_data->tmpT[i] = 0;
-				else
-					m_data->tmpT[i] -= m_data->min;
-			}
-		}
+		// subtract min T, compute background and differences with previous image
+		computeFrameStats(m_data->stats, threads, m_data->tmpT.data(), m_data->prevT.data(), m_data->tmp.data(), img,
+						  m_data->subtractMin ? m_data->min : 0, NULL, m_data->width, m_data->stop_lossy_height);
 
 		bool res = false;
-		unsigned background = get_background(m_data->tmp.data(), m_data->hist, m_data->width * m_data->stop_lossy_height);
+		unsigned background = m_data->stats[0].background();
 
 		int lowError = m_data->lowValueError;
 		int highError = m_data->highValueError;
@@ -2515,9 +2911,9 @@ namespace rir
 		int running_average_frames = 40;
 		int start_running_average_frames = 1;
 		if ((int)m_data->stdDevs.size() < running_average_frames)
-			std = stdDev(m_data->prevT.data(), m_data->tmpT.data(), m_data->width, m_data->stop_lossy_height);
+			std = m_data->stats[0].stdDev();
 		else
-			std = stdDev(m_data->prevT.data(), m_data->tmpT.data(), m_data->width, m_data->stop_lossy_height, img, &background);
+			std = m_data->stats[0].stdDev(&background);
 		if ((int)m_data->firstStdDevs.size() < start_running_average_frames)
 			m_data->firstStdDevs.push_back(std);
 
@@ -2616,6 +3012,7 @@ namespace rir
 	}
 
 #define H264_READ_THREADS 1 // read thread count, must be >= 1
+#define H264_PREFETCH_SIZE 0 // default number of frames decoded ahead by H264_Loader, 0 to disable (opt-in)
 
 	class VideoGrabber
 	{
@@ -2634,6 +3031,10 @@ namespace rir
 		const std::vector<unsigned short> &GetCurrentFrame();
 		const std::vector<unsigned char> &GetCurrentIT();
 		const std::vector<unsigned char> &GetITByNumber(int num);
+		// reference to the current decoded frame, stays valid after decoding the next ones
+		std::shared_ptr<AVFrame> GetCurrentAVFrame() const;
+		// unpack the current frame in pixels and IT (if not NULL)
+		bool CopyCurrentFrame(unsigned short *pixels, unsigned char *IT = NULL) const;
 
 		// position actuelle (en frame), peut etre approximatif
 		long int GetCurrentFramePos() const;
@@ -2655,14 +3056,29 @@ namespace rir
 		// NEW methods
 		bool Init();
 		const std::vector<unsigned short> &GetFrame(int num);
+		// Decode frame num without unpacking it, returns false on error
+		bool SeekFrame(int num);
+		// Decode frame num and unpack it directly in pixels and IT (if not NULL)
+		bool ReadFrame(int num, unsigned short *pixels, unsigned char *IT = NULL);
+		// Build the key frame index from the container index (if any)
+		bool BuildIndex();
+		bool HasIndex() const { return !m_keyframes.empty(); }
 
 	public:
+		// Decode the next frame in the stream into pFrame, returns false on error
+		bool DecodeNext();
 		double getTime();
-		void toArray(AVFrame *frame);
+		// Unpack a decoded frame of size width x height, data and IT can be NULL
+		static void toArray(const AVFrame *frame, int width, int height, unsigned short *data, unsigned char *IT);
+		// pFrame holds a new frame: invalidate the unpacked images
+		void setCurrentFrame();
 		void free_packet();
 
+		// current frame, unpacked on request
 		std::vector<unsigned short> m_image;
 		std::vector<unsigned char> m_IT;
+		bool m_image_valid;
+		bool m_IT_valid;
 		double m_current_time;
 		std::string m_filename;
 		int m_width;
@@ -2680,6 +3096,9 @@ namespace rir
 		int m_thread_count;
 		int m_GOP;
 		int m_skip_packets;
+		// key frame index: timestamp of each packet (decoding order) and positions of key frames
+		std::vector<int64_t> m_index_ts;
+		std::vector<int> m_keyframes;
 
 		// variables ffmpeg
 		AVFormatContext *pFormatCtx;
@@ -2725,6 +3144,8 @@ namespace rir
 		m_file_open = false;
 		m_is_packet = false;
 		m_last_key = false;
+		m_image_valid = false;
+		m_IT_valid = false;
 		pFormatCtx = NULL;
 		pCodecCtx = NULL;
 		pCodec = NULL;
@@ -2743,6 +3164,8 @@ namespace rir
 		m_file_open = false;
 		m_is_packet = false;
 		m_last_key = false;
+		m_image_valid = false;
+		m_IT_valid = false;
 		m_GOP = -1;
 		Open(name, file_reader, thread_count);
 	}
@@ -2941,6 +3364,7 @@ namespace rir
 			}
 		}
 
+		BuildIndex();
 		return Init();
 
 	error:
@@ -3000,54 +3424,77 @@ namespace rir
 		buffer = NULL;
 		m_file_open = false;
 		m_is_packet = false;
+		m_image_valid = false;
+		m_IT_valid = false;
 		m_reader.reset();
+		m_index_ts.clear();
+		m_keyframes.clear();
 	}
 
 	const std::vector<unsigned short> &VideoGrabber::GetCurrentFrame()
 	{
+		if (!m_image_valid && pFrame && pFrame->data[0])
+		{
+			toArray(pFrame, m_width, m_height, m_image.data(), NULL);
+			m_image_valid = true;
+		}
 		return m_image;
 	}
 
 	const std::vector<unsigned char> &VideoGrabber::GetCurrentIT()
 	{
+		if (!m_IT_valid && pFrame && pFrame->data[0])
+		{
+			toArray(pFrame, m_width, m_height, NULL, m_IT.data());
+			m_IT_valid = true;
+		}
 		return m_IT;
 	}
 
-	void VideoGrabber::toArray(AVFrame *frame)
+	std::shared_ptr<AVFrame> VideoGrabber::GetCurrentAVFrame() const
 	{
-		unsigned short *data = (unsigned short *)m_image.data();
-		unsigned char *IT = (unsigned char *)m_IT.data();
+		if (!pFrame || !pFrame->data[0])
+			return std::shared_ptr<AVFrame>();
+		return std::shared_ptr<AVFrame>(av_frame_clone(pFrame), [](AVFrame *f)
+										{ av_frame_free(&f); });
+	}
 
-		if (pCodecCtx->pix_fmt == AV_PIX_FMT_YUV444P)
+	bool VideoGrabber::CopyCurrentFrame(unsigned short *pixels, unsigned char *IT) const
+	{
+		if (!pFrame || !pFrame->data[0])
+			return false;
+		toArray(pFrame, m_width, m_height, pixels, IT);
+		return true;
+	}
+
+	void VideoGrabber::toArray(const AVFrame *frame, int width, int height, unsigned short *data, unsigned char *IT)
+	{
+		if (frame->format == AV_PIX_FMT_YUV444P)
 		{
-			for (int y = 0; y < frame->height; ++y)
+			for (int y = 0; y < height; ++y)
 			{
-				unsigned char *d0 = frame->data[0] + y * frame->linesize[0];
-				unsigned char *d1 = frame->data[1] + y * frame->linesize[1];
-				unsigned char *d2 = frame->data[2] + y * frame->linesize[2];
-				for (int i = 0; i < frame->width; ++i)
-				{
-					data[i + y * frame->width] = d1[i] | (d2[i] << 8);
-					IT[i + y * frame->width] = d0[i];
-				}
+				const unsigned char *d0 = frame->data[0] + y * frame->linesize[0];
+				const unsigned char *d1 = frame->data[1] + y * frame->linesize[1];
+				const unsigned char *d2 = frame->data[2] + y * frame->linesize[2];
+				if (data)
+					joinPixels(d1, d2, data + y * width, d0, IT ? IT + y * width : NULL, width);
+				else if (IT)
+					memcpy(IT + y * width, d0, width);
 			}
 		}
-		else if (pCodecCtx->pix_fmt == AV_PIX_FMT_YUV420P)
+		else if (frame->format == AV_PIX_FMT_YUV420P)
 		{
-			for (int y = 0; y < m_height; ++y)
+			for (int y = 0; y < height; ++y)
 			{
-				unsigned char *d0 = frame->data[0] + y * frame->linesize[0];
-				unsigned char *d0_2 = frame->data[0] + (y + m_height) * frame->linesize[0];
-				unsigned char *d1 = frame->data[1] + y * frame->linesize[1];
-				for (int i = 0; i < m_width; ++i)
-				{
-					data[i + y * m_width] = d0[i] | (d0_2[i] << 8);
-					IT[i + y * frame->width] = d1[i];
-				}
+				const unsigned char *d0 = frame->data[0] + y * frame->linesize[0];
+				const unsigned char *d0_2 = frame->data[0] + (y + height) * frame->linesize[0];
+				const unsigned char *d1 = frame->data[1] + y * frame->linesize[1];
+				if (data)
+					joinPixels(d0, d0_2, data + y * width, d1, IT ? IT + y * width : NULL, width);
+				else if (IT)
+					memcpy(IT + y * width, d1, width);
 			}
 		}
-
-		m_last_key = frame->key_frame || (frame->pict_type == AV_PICTURE_TYPE_I);
 	}
 
 	bool VideoGrabber::Init()
@@ -3087,18 +3534,96 @@ namespace rir
 			{
 				av_packet_unref(&p);
 			}
-			toArray(pFrame);
+			setCurrentFrame();
 			m_frame_pos = 0;
-			// int value = m_image[0];
 		}
 		return true;
 	}
+	bool VideoGrabber::BuildIndex()
+	{
+		m_index_ts.clear();
+		m_keyframes.clear();
+
+		// use the container index (MP4 sample table), available without reading the file
+		AVStream *st = pFormatCtx->streams[videoStream];
+		int count = avformat_index_get_entries_count(st);
+		if (count <= 0 || count != m_frame_count)
+			return false;
+
+		m_index_ts.resize(count);
+		for (int i = 0; i < count; ++i)
+		{
+			const AVIndexEntry *e = avformat_index_get_entry(st, i);
+			if (!e)
+			{
+				m_index_ts.clear();
+				m_keyframes.clear();
+				return false;
+			}
+			m_index_ts[i] = e->timestamp;
+			if (e->flags & AVINDEX_KEYFRAME)
+				m_keyframes.push_back(i);
+		}
+		if (m_keyframes.empty() || m_keyframes.front() != 0)
+		{
+			m_index_ts.clear();
+			m_keyframes.clear();
+			return false;
+		}
+		return true;
+	}
+
+	bool VideoGrabber::DecodeNext()
+	{
+		AVPacket p;
+		av_init_packet(&p);
+		p.data = NULL;
+		p.size = 0;
+		int finish = 0;
+		while (finish == 0)
+		{
+			if (p.buf)
+				av_packet_unref(&p);
+			if (av_read_frame(pFormatCtx, &p) < 0)
+				av_init_packet(&p);
+			int ret = decode(pCodecCtx, pFrame, &finish, &p);
+			if (ret < 0 && ret != AVERROR(EAGAIN) && !p.data)
+			{
+				// end of stream reached without output frame
+				break;
+			}
+		}
+		if (p.buf)
+			av_packet_unref(&p);
+		return finish != 0;
+	}
+
+	void VideoGrabber::setCurrentFrame()
+	{
+		m_image_valid = false;
+		m_IT_valid = false;
+		m_last_key = pFrame->key_frame || (pFrame->pict_type == AV_PICTURE_TYPE_I);
+	}
+
 	const std::vector<unsigned short> &VideoGrabber::GetFrame(int num)
 	{
 		static const std::vector<unsigned short> null_image;
+		if (!SeekFrame(num))
+			return null_image;
+		return GetCurrentFrame();
+	}
 
+	bool VideoGrabber::ReadFrame(int num, unsigned short *pixels, unsigned char *IT)
+	{
+		if (!SeekFrame(num))
+			return false;
+		return CopyCurrentFrame(pixels, IT);
+	}
+
+	bool VideoGrabber::SeekFrame(int num)
+	{
 		if (num == m_frame_pos)
-			return m_image;
+			return true;
 
 		AVPacket p;
 		av_init_packet(&p);
@@ -3122,15 +3647,43 @@ namespace rir
 					if (p.buf)
 						av_packet_unref(&p);
 					m_frame_pos = -1; // in case of error, invalidate m_frame_pos to be sure to call av_seek_frame next time
-					return null_image;
+					return false;
 				}
 			}
-			toArray(pFrame);
+			setCurrentFrame();
 			m_frame_pos = num;
 			if (p.buf)
 				av_packet_unref(&p);
-			int value = m_image[0];
-			return m_image;
+			return true;
+		}
+
+		if (m_keyframes.size())
+		{
+			// exact seek to the key frame preceding the requested one, then decode forward
+			int key = *(std::upper_bound(m_keyframes.begin(), m_keyframes.end(), num) - 1);
+			int pos = m_frame_pos;
+			if (pos < key || pos >= num)
+			{
+				int ret = av_seek_frame(pFormatCtx, videoStream, m_index_ts[key], AVSEEK_FLAG_BACKWARD);
+				avcodec_flush_buffers(pCodecCtx);
+				if (ret < 0 || !DecodeNext())
+				{
+					m_frame_pos = -1;
+					return false;
+				}
+				pos = key;
+			}
+			for (; pos < num; ++pos)
+			{
+				if (!DecodeNext())
+				{
+					m_frame_pos = -1;
+					return false;
+				}
+			}
+			setCurrentFrame();
+			m_frame_pos = num;
+			return true;
 		}
 
 		if (m_skip_packets && num < m_skip_packets)
@@ -3153,18 +3706,17 @@ namespace rir
 					if (p.buf)
 						av_packet_unref(&p);
 					m_frame_pos = -1; // in case of error, invalidate m_frame_pos to be sure to call av_seek_frame next time
-					return null_image;
+					return false;
 				}
 				if (finish)
 				{
 					if (count == num)
 					{
 						m_frame_pos = num;
-						toArray(pFrame);
+						setCurrentFrame();
 						if (p.buf)
 							av_packet_unref(&p);
-						int value = m_image[0];
-						return m_image;
+						return true;
 					}
 					++count;
 				}
@@ -3177,15 +3729,15 @@ namespace rir
 			int pos = m_frame_count - m_skip_packets * 2;
 			if (pos < 0)
 				pos = 0;
-			GetFrame(pos);
-			return GetFrame(num);
+			SeekFrame(pos);
+			return SeekFrame(num);
 		}
 
 		int ret = av_seek_frame(pFormatCtx, videoStream, (num) * 12800, AVSEEK_FLAG_BACKWARD);
 
 		avcodec_flush_buffers(pCodecCtx);
 		if (ret < 0)
-			return null_image;
+			return false;
 
 		int64_t target_dts = (num + m_skip_packets) * 12800;
 
@@ -3211,7 +3763,7 @@ namespace rir
 						av_packet_unref(&p);
 					}
 					m_frame_pos = -1; // in case of error, invalidate m_frame_pos to be sure to call av_seek_frame next time
-					return null_image;
+					return false;
 				}
 			}
 
@@ -3220,12 +3772,11 @@ namespace rir
 				break;
 			}
 		}
-		toArray(pFrame);
+		setCurrentFrame();
 		m_frame_pos = num;
 		if (p.buf)
 			av_packet_unref(&p);
-		int value = m_image[0];
-		return m_image;
+		return true;
 	}
 
 	int VideoGrabber::ComputeImageCount()
@@ -3260,9 +3811,8 @@ namespace rir
 					bool stop = true;
 			}
 			++count;
-			toArray(pFrame);
+			setCurrentFrame();
 			size_t dts = pFrame->pkt_dts; // USE pkt_dts
-			int value = m_image[0];
 			bool stop = true;
 		}
 		return count;
@@ -3280,142 +3830,309 @@ namespace rir
 	long int VideoGrabber::GetCurrentFramePos() const { return m_frame_pos; }
 	double VideoGrabber::GetFps() const { return m_fps; }
 
-	struct ReadThread
+	/**
+	Decoded frame with its integration time image.
+	It holds a reference to the decoder output: pixels and IT are only unpacked on request.
+	*/
+	struct DecodedFrame
 	{
-		struct Img
+		int pos;
+		int width;
+		int height;
+		std::shared_ptr<AVFrame> frame;
+		std::vector<unsigned short> pixels;
+		std::vector<unsigned char> IT;
+
+		DecodedFrame() : pos(-1), width(0), height(0) {}
+
+		/** Reference the current frame of given grabber */
+		bool set(int p, const VideoGrabber &g)
 		{
-			std::vector<unsigned short> data;
-			int pos;
-		};
+			pos = p;
+			width = g.GetWidth();
+			height = g.GetHeight();
+			frame = g.GetCurrentAVFrame();
+			pixels.clear();
+			IT.clear();
+			return frame != NULL;
+		}
+		void reset()
+		{
+			pos = -1;
+			frame.reset();
+			pixels.clear();
+			IT.clear();
+		}
+		/** Unpack the pixels in dst */
+		bool copyTo(unsigned short *dst) const
+		{
+			if (!pixels.empty())
+				std::copy(pixels.begin(), pixels.end(), dst);
+			else if (frame)
+				VideoGrabber::toArray(frame.get(), width, height, dst, NULL);
+			else
+				return false;
+			return true;
+		}
+		const std::vector<unsigned short> &image()
+		{
+			if (pixels.empty() && frame)
+			{
+				pixels.resize((size_t)width * height);
+				VideoGrabber::toArray(frame.get(), width, height, pixels.data(), NULL);
+			}
+			return pixels;
+		}
+		const std::vector<unsigned char> &it()
+		{
+			if (IT.empty() && frame)
+			{
+				IT.resize((size_t)width * height);
+				VideoGrabber::toArray(frame.get(), width, height, NULL, IT.data());
+			}
+			return IT;
+		}
+	};
 
-		H264_Loader *loader;
-		int frameStep;
-		int frameFinished;
-		int frameRequest;
-		int frameLastRequest;
-		Img null;
-		Img res;
-		std::map<int, Img> imgs;
-		std::mutex mutex;
-		std::thread *th;
+	/**
+	Asynchronous decode-ahead stage for H264_Loader.
 
-		ReadThread(H264_Loader *l)
-			: loader(l), frameStep(0), frameFinished(0), frameRequest(-1), frameLastRequest(-1)
+	A worker thread decodes the frames following the last requested one into a bounded ring of frames.
+	The stride between consecutive requests is detected, so that forward, backward and strided playback
+	are all prefetched. For backward playback, frames belonging to the same GOP are decoded in increasing
+	order to avoid seeking back to the key frame for each frame.
+
+	The VideoGrabber is shared between the worker and the caller and protected by the grabber mutex.
+	*/
+	class FramePrefetcher
+	{
+	public:
+		FramePrefetcher(VideoGrabber *grabber, std::mutex *grabber_mutex, int capacity)
+			: m_grabber(grabber), m_grabber_mutex(grabber_mutex), m_capacity(std::max(1, capacity)),
+			  m_last(-1), m_stride(0), m_inflight(-1), m_stop(false)
 		{
-			null.pos = res.pos = -1;
-			th = new std::thread(std::bind(&ReadThread::start, this));
+			m_thread = std::thread(std::bind(&FramePrefetcher::run, this));
 		}
-		~ReadThread()
+		~FramePrefetcher()
 		{
-			loader = NULL;
-			th->join();
-			delete th;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_cond.notify_all();
+			m_thread.join();
 		}
 
-		Img pop(int pos)
+		/**
+		Retrieve frame at given position, either from the ring or by decoding it.
+		The previous content of \a out is recycled.
+		*/
+		bool get(int pos, DecodedFrame &out)
 		{
-			std::lock_guard<std::mutex> lock(mutex);
-			std::map<int, Img>::const_iterator it = imgs.find(pos);
-			if (it != imgs.end())
+			std::unique_lock<std::mutex> lock(m_mutex);
+			updateRequest(pos);
+
+			// the worker is decoding the requested frame: wait for it
+			while (m_inflight == pos)
+				m_cond.wait(lock);
+
+			for (size_t i = 0; i < m_frames.size(); ++i)
 			{
-				Img res = std::move(it->second);
-				imgs.erase(it);
-				return res;
+				if (m_frames[i].pos == pos)
+				{
+					std::swap(out, m_frames[i]);
+					recycle(m_frames[i]);
+					m_frames.erase(m_frames.begin() + i);
+					lock.unlock();
+					m_cond.notify_all();
+					return true;
+				}
 			}
-			return null;
+			lock.unlock();
+			m_cond.notify_all();
+
+			// not prefetched: decode it right now
+			return decode(pos, out);
 		}
 
-		void push(const Img &img)
+	private:
+		bool decode(int pos, DecodedFrame &f)
 		{
-			std::lock_guard<std::mutex> lock(mutex);
-			std::map<int, Img>::const_iterator it = imgs.find(img.pos);
-			if (it != imgs.end())
-				return;
-			imgs.insert(std::pair<int, Img>(img.pos, std::move(img)));
+			std::lock_guard<std::mutex> lock(*m_grabber_mutex);
+			if (!m_grabber->SeekFrame(pos))
+				return false;
+			return f.set(pos, *m_grabber);
+		}
+
+		void recycle(DecodedFrame &f)
+		{
+			// release the decoder frame, keep the buffers
+			f.reset();
+			if (m_pool.size() < (size_t)m_capacity)
+				m_pool.push_back(std::move(f));
 		}
 
-		void start()
+		void updateRequest(int pos)
 		{
-			while (H264_Loader *l = loader)
+			int stride = m_last >= 0 ? pos - m_last : 1;
+			if (stride != 0)
 			{
-				if (frameRequest >= 0)
+				// large jumps are considered as random access: do not prefetch
+				int max_stride = std::max(16, m_grabber->m_GOP);
+				m_stride = std::abs(stride) <= max_stride ? stride : 0;
+			}
+			m_last = pos;
+
+			// drop frames outside of the prefetch window
+			for (size_t i = 0; i < m_frames.size();)
+			{
+				if (m_frames[i].pos != pos && !inWindow(m_frames[i].pos))
 				{
+					recycle(m_frames[i]);
+					m_frames.erase(m_frames.begin() + i);
+				}
+				else
+					++i;
+			}
+		}
 
-					frameStep = frameRequest - frameLastRequest;
-					frameLastRequest = frameRequest;
+		bool inWindow(int pos) const
+		{
+			if (m_stride == 0)
+				return false;
+			int diff = pos - m_last;
+			if (diff % m_stride != 0)
+				return false;
+			int k = diff / m_stride;
+			return k >= 1 && k <= m_capacity;
+		}
 
-					int saved = frameRequest;
-					frameRequest = -1;
-					// look for img
-					res = pop(saved);
-					if (res.pos >= 0)
-						frameFinished = 1;
-					else
-					{
-						res.pos = saved;
-						res.data.resize(l->imageSize().width * l->imageSize().height);
-						l->readImageInternal(saved, res.data.data());
-						frameFinished = 1;
-					}
+		bool isAvailable(int pos) const
+		{
+			for (size_t i = 0; i < m_frames.size(); ++i)
+				if (m_frames[i].pos == pos)
+					return true;
+			return false;
+		}
 
-					// read next
-					if (frameStep && std::abs(frameStep) < 8)
-					{
-						int new_pos = saved + frameStep;
-						if (new_pos < 0 || new_pos >= l->size())
-							continue;
-						std::lock_guard<std::mutex> lock(mutex);
-						std::map<int, Img>::const_iterator it = imgs.find(saved + frameStep);
-						if (it == imgs.end())
-						{
-							Img tmp;
-							tmp.pos = saved + frameStep;
-							tmp.data.resize(l->imageSize().width * l->imageSize().height);
-							l->readImageInternal(saved + frameStep, tmp.data.data());
-							imgs.insert(std::pair<int, Img>(tmp.pos, std::move(tmp)));
-						}
-					}
+		/** Returns the next frame to prefetch, or -1 */
+		int nextPosition() const
+		{
+			if (m_stride == 0 || m_last < 0 || (int)m_frames.size() >= m_capacity)
+				return -1;
+			const int count = m_grabber->GetFrameCount();
+
+			// first missing frame in the prefetch window
+			int next = -1;
+			for (int k = 1; k <= m_capacity; ++k)
+			{
+				int p = m_last + k * m_stride;
+				if (p < 0 || p >= count)
+					break;
+				if (!isAvailable(p))
+				{
+					next = p;
+					break;
 				}
 			}
+			if (next < 0 || m_stride > 0 || m_grabber->m_GOP <= 0)
+				return next;
+
+			// backward playback: decode the missing frames of the same GOP in increasing order
+			int gop_start = (next / m_grabber->m_GOP) * m_grabber->m_GOP;
+			int res = next;
+			for (int k = 1; k <= m_capacity; ++k)
+			{
+				int p = m_last + k * m_stride;
+				if (p < gop_start || p < 0)
+					break;
+				if (!isAvailable(p))
+					res = p;
+			}
+			return res;
 		}
 
-		bool get(int pos, unsigned short *pixels)
+		void run()
 		{
-			if (pos < 0 || pos >= loader->size())
-				return false;
-			if (res.pos == pos)
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_stop)
 			{
-				std::copy(res.data.begin(), res.data.end(), pixels);
-				return true;
+				int next = nextPosition();
+				if (next < 0)
+				{
+					m_cond.wait(lock);
+					continue;
+				}
+
+				DecodedFrame f;
+				if (m_pool.size())
+				{
+					f = std::move(m_pool.back());
+					m_pool.pop_back();
+				}
+				m_inflight = next;
+				lock.unlock();
+
+				bool ok = decode(next, f);
+
+				lock.lock();
+				m_inflight = -1;
+				// keep the frame if it is still useful for the current request
+				if (ok && (next == m_last || inWindow(next)) && !isAvailable(next))
+					m_frames.push_back(std::move(f));
+				else
+				{
+					recycle(f);
+					if (!ok)
+						m_stride = 0; // decoding error: stop prefetching until next request
+				}
+				m_cond.notify_all();
 			}
-			frameFinished = 0;
-			frameRequest = pos;
-			while (frameFinished != 1)
-				msleep(1);
-			std::copy(res.data.begin(), res.data.end(), pixels);
-			return true;
 		}
+
+		VideoGrabber *m_grabber;
+		std::mutex *m_grabber_mutex;
+		int m_capacity;
+		int m_last;
+		int m_stride;
+		int m_inflight;
+		bool m_stop;
+		std::deque<DecodedFrame> m_frames;
+		std::vector<DecodedFrame> m_pool;
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		std::thread m_thread;
 	};
 
 	class H264_Loader::PrivateData
 	{
 	public:
 		VideoGrabber grabber;
+		std::mutex grabber_mutex;
 		FileAttributes attrs;
 		std::vector<int64_t> timestamps;
 		int readThreadCount;
+		int prefetchSize;
 		std::vector<std::vector<unsigned short>> firstImages;
 		std::vector<std::vector<unsigned short>> lastImages;
 		FileReaderPtr file_reader;
-		// ReadThread *th;
+		// last image returned by readImage()
+		DecodedFrame current;
+		std::unique_ptr<FramePrefetcher> prefetcher;
+		// with several read threads: one file reader per decoder, and additional decoders used by readImages()
+		std::vector<FileReaderPtr> shared_readers;
+		std::vector<std::unique_ptr<VideoGrabber>> decoders;
 	};
 
+	static std::atomic<int> _default_read_threads(H264_READ_THREADS);
+	static std::atomic<int> _default_prefetch_size(H264_PREFETCH_SIZE);
+
 	H264_Loader::H264_Loader()
 	{
 		m_data = new PrivateData();
-		m_data->readThreadCount = H264_READ_THREADS;
+		m_data->readThreadCount = _default_read_threads;
+		m_data->prefetchSize = _default_prefetch_size;
 		m_data->file_reader = NULL;
-		// m_data->th = new ReadThread(this);
 	}
 	H264_Loader::~H264_Loader()
 	{
@@ -3433,6 +4150,34 @@ namespace rir
 		return m_data->readThreadCount;
 	}
 
+	void H264_Loader::setDefaultReadThreadCount(int count)
+	{
+		_default_read_threads = std::max(1, count);
+	}
+	int H264_Loader::defaultReadThreadCount()
+	{
+		return _default_read_threads;
+	}
+
+	void H264_Loader::setPrefetchSize(int count)
+	{
+		m_data->prefetcher.reset();
+		m_data->prefetchSize = std::max(0, count);
+	}
+	int H264_Loader::prefetchSize() const
+	{
+		return m_data->prefetchSize;
+	}
+
+	void H264_Loader::setDefaultPrefetchSize(int count)
+	{
+		_default_prefetch_size = std::max(0, count);
+	}
+	int H264_Loader::defaultPrefetchSize()
+	{
+		return _default_prefetch_size;
+	}
+
 	bool H264_Loader::isValidFile(const char *filename)
 	{
 		VideoGrabber g;
@@ -3443,7 +4188,7 @@ namespace rir
 	{
 		if (!file_exists(filename))
 			return false;
-		m_data->file_reader = createFileReader(createFileAccess(filename));
+		m_data->file_reader = createFileReader(createMappedFileAccess(filename));
 		return open(m_data->file_reader);
 	}
 
@@ -3454,12 +4199,23 @@ namespace rir
 
 	bool H264_Loader::open(const FileReaderPtr & file_reader)
 	{
+		m_data->prefetcher.reset();
+		m_data->decoders.clear();
+		m_data->shared_readers.clear();
 		int threads = m_data->readThreadCount;
 		if (threads <= 0)
 			threads = 1;
-		// TEST: 2 threads instead of 1
+
+		// several decoders: each one reads the file through its own file reader
+		FileReaderPtr reader = file_reader;
+		if (threads > 1)
+		{
+			m_data->shared_readers = createSharedFileReaders(file_reader, threads);
+			reader = m_data->shared_readers.front();
+		}
+
 		// open the video file
-		if (m_data->grabber.Open(std::string(), file_reader, threads))
+		if (m_data->grabber.Open(std::string(), reader, threads))
 		{
 			if (m_data->attrs.openReadOnly(file_reader))
 			{
@@ -3490,6 +4246,9 @@ namespace rir
 						m_data->grabber.m_GOP = gop;
 				}
 
+				// the grabber is positioned on the first frame
+				m_data->current.set(m_data->grabber.GetCurrentFramePos(), m_data->grabber);
+
 				return true;
 			}
 			else
@@ -3518,21 +4277,112 @@ namespace rir
 		if (pos < 0 || pos >= size())
 			return false;
 
-		// thread count ==1: standard reading
-		m_data->grabber.GetFrame(pos);
-		std::copy(m_data->grabber.GetCurrentFrame().begin(), m_data->grabber.GetCurrentFrame().end(), pixels);
-
+		// unpack straight into the output, the IT is only unpacked if requested through lastIt()
+		std::lock_guard<std::mutex> lock(m_data->grabber_mutex);
+		if (!m_data->grabber.ReadFrame(pos, pixels))
+			return false;
+		m_data->current.set(pos, m_data->grabber);
 		return true;
 	}
 
 	bool H264_Loader::readImage(int pos, int, unsigned short *pixels)
 	{
-		// return m_data->th->get(pos, pixels);
-		return readImageInternal(pos, pixels);
+		if (pos < 0 || pos >= size())
+			return false;
+		if (m_data->prefetchSize <= 0)
+			return readImageInternal(pos, pixels);
+
+		// start the decode-ahead thread on first read
+		if (!m_data->prefetcher)
+			m_data->prefetcher.reset(new FramePrefetcher(&m_data->grabber, &m_data->grabber_mutex, m_data->prefetchSize));
+
+		if (!m_data->prefetcher->get(pos, m_data->current))
+			return false;
+		return m_data->current.copyTo(pixels);
 	}
+	bool H264_Loader::readImages(int first, int count, int step, int calibration, unsigned short *pixels)
+	{
+		if (count <= 0 || step <= 0 || first < 0 || first + (int64_t)(count - 1) * step >= (int64_t)size())
+			return false;
+
+		// shared_readers holds readThreadCount() readers when the file was opened with more than one read thread
+		const int threads = std::min(m_data->readThreadCount, (int)m_data->shared_readers.size());
+		if (threads <= 1 || count == 1)
+			return IRVideoLoader::readImages(first, count, step, calibration, pixels);
+
+		// open additional decoders on first use.
+		// Parallelism comes from the decoders themselves, so each additional one uses a single codec thread.
+		if (m_data->decoders.empty())
+		{
+			for (int i = 1; i < threads; ++i)
+			{
+				std::unique_ptr<VideoGrabber> g(new VideoGrabber());
+				if (!g->Open(std::string(), m_data->shared_readers[i], 1))
+					break;
+				g->m_GOP = m_data->grabber.m_GOP;
+				m_data->decoders.push_back(std::move(g));
+			}
+		}
+
+		// split requested frames in ranges belonging to the same GOP, each range is decoded sequentially by a single decoder
+		const int gop = m_data->grabber.m_GOP > 0 ? m_data->grabber.m_GOP : 64;
+		std::vector<std::pair<int, int>> ranges; // [start, end) indexes in the requested frames
+		for (int i = 0; i < count;)
+		{
+			int start = i;
+			int g = (first + i * step) / gop;
+			while (i < count && (first + i * step) / gop == g)
+				++i;
+			ranges.push_back(std::pair<int, int>(start, i));
+		}
+
+		const size_t image_size = (size_t)imageSize().width * (size_t)imageSize().height;
+		const int last = first + (count - 1) * step;
+		std::atomic<int> next_range(0);
+		std::atomic<bool> ok(true);
+		DecodedFrame last_frame;
+
+		auto decode_ranges = [&](VideoGrabber *g, std::mutex *mutex)
+		{
+			int r;
+			while (ok && (r = next_range++) < (int)ranges.size())
+			{
+				for (int i = ranges[r].first; i < ranges[r].second; ++i)
+				{
+					int pos = first + i * step;
+					std::unique_lock<std::mutex> lock;
+					if (mutex)
+						lock = std::unique_lock<std::mutex>(*mutex);
+					if (!g->ReadFrame(pos, pixels + i * image_size))
+					{
+						ok = false;
+						return;
+					}
+					if (pos == last)
+						last_frame.set(pos, *g);
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < m_data->decoders.size(); ++i)
+			workers.push_back(std::thread(decode_ranges, m_data->decoders[i].get(), (std::mutex *)NULL));
+		// the main decoder might be used by the prefetch thread
+		decode_ranges(&m_data->grabber, &m_data->grabber_mutex);
+		for (size_t i = 0; i < workers.size(); ++i)
+			workers[i].join();
+
+		if (!ok)
+			return false;
+
+		// last decoded image becomes the current one
+		m_data->current = std::move(last_frame);
+		return true;
+	}
+
 	const std::vector<unsigned char> &H264_Loader::lastIt() const
 	{
-		return m_data->grabber.GetCurrentIT();
+		return m_data->current.it();
 	}
 
 	bool H264_Loader::getRawValue(int x, int y, unsigned short *value) const
@@ -3545,8 +4395,11 @@ namespace rir
 			return false;
 		else if (y >= m_data->grabber.GetHeight())
 			return false;
+		const std::vector<unsigned short> &img = m_data->current.image();
+		if (img.empty())
+			return false;
 
-		*value = m_data->grabber.GetCurrentFrame()[x + y * m_data->grabber.GetWidth()];
+		*value = img[x + y * m_data->grabber.GetWidth()];
 		return true;
 	}
 
@@ -3562,7 +4415,12 @@ namespace rir
 
 	void H264_Loader::close()
 	{
+		// stop the decode-ahead thread before closing the grabber
+		m_data->prefetcher.reset();
+		m_data->current = DecodedFrame();
+		m_data->decoders.clear();
 		m_data->grabber.Close();
+		m_data->shared_readers.clear();
 		m_data->attrs.close();
 		if (m_data->file_reader)
 			m_data->file_reader.reset();
@@ -3575,8 +4433,8 @@ namespace rir
 
 	bool H264_Loader::extractAttributes(std::map<std::string, std::string> &attrs) const
 	{
-		int pos = m_data->grabber.GetCurrentFramePos();
-		if (pos >= (int)m_data->attrs.size())
+		int pos = m_data->current.pos;
+		if (pos < 0 || pos >= (int)m_data->attrs.size())
 			attrs.clear();
 		else
 			attrs = m_data->attrs.attributes(pos);
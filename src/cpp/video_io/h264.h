@@ -58,7 +58,14 @@ namespace rir
 		bool open(const char *filename, int width, int height, int stop_lossy_height, int fps);
 
 		/// @brief Close recorded video file and write attributes (if any).
-		void close();
+		/// Pending frames are flushed first in asynchronous mode.
+		/// @return false if the trailer could not be written or if an error occurred on a queued frame, true otherwise.
+		bool close();
+
+		/// @brief Wait for all frames queued by addImageLossy() to be analysed and encoded.
+		/// This is a no-op if the "asyncQueue" parameter is 0.
+		/// @return false if an error occurred on a queued frame since the last call to flush(), true otherwise.
+		bool flush();
 
 		/// @brief Add a global video attribute.
 		/// Global video attributes can be added until the call to close().
@@ -78,7 +85,8 @@ namespace rir
 		/// @param timestamp_ns image timestamp in nanoseconds
 		/// @param attributes image attributes
 		/// @param is_key if true, force this frame to become a key frame. If false, the GOP (Group Of Pictures) attribute is used to determine if this is a key frame.
-		/// @return true on success, false otherwise
+		/// @return true on success, false otherwise.
+		/// In asynchronous mode, frames queued by addImageLossy() are encoded first.
 		bool addImageLossLess(const unsigned short *img, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes, bool is_key = false);
 
 		/// @brief Add image to the video saver that will be compressed in a lossless way
@@ -87,7 +95,8 @@ namespace rir
 		/// @param timestamp_ns image timestamp in nanoseconds
 		/// @param attributes image attributes
 		/// @param is_key if true, force this frame to become a key frame. If false, the GOP (Group Of Pictures) attribute is used to determine if this is a key frame.
-		/// @return true on success, false otherwise
+		/// @return true on success, false otherwise.
+		/// In asynchronous mode, frames queued by addImageLossy() are encoded first.
 		bool addImageLossLess(const unsigned short *img, const unsigned char *IT, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes, bool is_key = false);
 
 		/// @brief Add image to the video saver that will be compressed in a lossy way.
@@ -101,6 +110,9 @@ namespace rir
 		/// @param timestamp_ns image timestamp in nanoseconds
 		/// @param attributes image attributes
 		/// @return true on success, false otherwise.
+		/// In asynchronous mode (see "asyncQueue" parameter), the image is copied and queued, and errors are reported by the next call to addImageLossy() or flush().
+		/// If "inputCamera" is set, the loss introduction runs on the calling thread (the calibration uses the input camera state, which the caller keeps modifying)
+		/// and only the encoding is asynchronous.
 		bool addImageLossy(const unsigned short *img_DL_or_T, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes);
 
 		/// @brief Set the compression level, from 0 (default) to 8 (maximum compression).
@@ -121,6 +133,7 @@ namespace rir
 
 		/// @brief Generic way to set parameters passed as string values.
 		/// Parameters must be all set before the call to open().
+		/// In asynchronous mode, queued frames are processed before changing a parameter, and "asyncQueue" cannot be changed while the file is open.
 		/// Currently supported parameters are:
 		///		-	lowValueError: see setLowValueError().
 		///		-	highValueError: see setHighValueError().
@@ -132,7 +145,10 @@ namespace rir
 		///		-	stdFactor: factor used by the error reduction mechanism as described in []. Default to 5.
 		///		-	inputCamera: input camera identifier used for the DL to temperature calibration (see addImageLossy() function). Default to 0 (disabled).
 		///		-	removeBadPixels: remove images bad pixels if set to 1. Default to 0 (disabled)
-		///		-	runningAverage: running average length as described in []. Default to 32.
+		///		-	runningAverage: running average length as described in [], clamped to [0, 64] (0 disables it). Default to 32.
+		///		-	asyncQueue: if > 0, addImageLossy() only queues the image and returns. Loss introduction and encoding are performed
+		///			by 2 worker threads connected by queues of at most asyncQueue frames. Default to 0 (synchronous).
+		///			With an inputCamera, only the encoding is performed by a worker thread.
 		///
 		/// @param key parameter name
 		/// @param value parameter value
@@ -149,13 +165,22 @@ namespace rir
 		bool addLoss(unsigned short *img_T);
 
 		/// @brief Returns the low error value for each compressed frame so far.
+		/// In asynchronous mode, call flush() first.
 		const std::vector<unsigned short> &lowErrors() const;
 		/// @brief Returns the high error value for each compressed frame so far.
+		/// In asynchronous mode, call flush() first.
 		const std::vector<unsigned short> &highErrors() const;
 
 	private:
 		bool addImageLossyWithCamera(const unsigned short *img_DL, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes);
 		bool addImageLossyNoCamera(const unsigned short *img_T, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes);
+		bool encodeFrame(const unsigned short *img, const unsigned char *IT, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes, bool is_key = false);
+		bool writeImage(const unsigned short *img, const unsigned char *IT, int64_t timestamp_ns, const std::map<std::string, std::string> &attributes, bool is_key);
+		void startPipeline();
+		bool stopPipeline();
+		void waitPipeline();
+		void analysisLoop();
+		void encodeLoop();
 
 		class PrivateData;
 		PrivateData *m_data;
@@ -182,13 +207,30 @@ namespace rir
 		/// @return true on success, false otherwise
 		bool open(const FileReaderPtr &file_reader);
 
-		/// @brief Set the number of threads used to decompress each frame.
-		/// This number is bounded by the "slices" parameter set through H264_Saver::setParameter().
+		/// @brief Set the number of decoders used to read the video.
+		/// With more than one decoder, readImages() decodes disjoint GOP ranges in parallel, each decoder using its own codec context.
+		/// The main decoder uses this number of codec threads, the additional ones used by readImages() are single threaded.
 		/// This function must be called BEFORE opening the video with H264_Loader::open().
-		/// @param thread number, default to 1
+		/// @param thread number, default to defaultReadThreadCount()
 		void setReadThreadCount(int);
 		int readThreadCount() const;
 
+		/// @brief Set the read thread count used by H264_Loader objects created afterward (default to 1).
+		static void setDefaultReadThreadCount(int);
+		static int defaultReadThreadCount();
+
+		/// @brief Set the number of frames decoded ahead by a background thread while reading the video.
+		/// The stride between consecutive calls to readImage() is detected, so that forward, backward and strided
+		/// reads are all prefetched. Random accesses are not prefetched.
+		/// Prefetching is opt-in: it costs one background thread and memory for the decoded frames.
+		/// @param count maximum number of prefetched frames, 0 to disable prefetching. Default to defaultPrefetchSize().
+		void setPrefetchSize(int count);
+		int prefetchSize() const;
+
+		/// @brief Set the prefetch size used by H264_Loader objects created afterward (default to 0, disabled).
+		static void setDefaultPrefetchSize(int count);
+		static int defaultPrefetchSize();
+
 		/// @brief Reimplemented from IRVideoLoader
 		virtual bool supportBadPixels() const { return false; }
 		/// @brief Returns the total number of frames within the video
@@ -203,6 +245,8 @@ namespace rir
 		/// @param pixels output image
 		/// @return true on success, false otherwise
 		virtual bool readImage(int pos, int calibration, unsigned short *pixels);
+		/// @brief Read several images, decoding disjoint GOP ranges in parallel if readThreadCount() > 1
+		virtual bool readImages(int first, int count, int step, int calibration, unsigned short *pixels);
 
 		/// @brief Returns the integration time image for the last read image.
 		const std::vector<unsigned char> &lastIt() const;
@@ -9,6 +9,9 @@ extern "C"
 #include "h264.h"
 #include "HCCLoader.h"
 #include "ReadFileChunk.h"
+#ifdef USE_ZFILE
+#include "ZFile.h"
+#endif
 
 using namespace rir;
 
@@ -390,6 +393,22 @@ int load_imageF(int cam, int pos, int calibration, float *pixels)
 		return -1;
 }
 
+int load_images(int cam, int first, int count, int step, int calibration, unsigned short *pixels)
+{
+	void *camera = get_void_ptr(cam);
+	IRVideoLoader *l = static_cast<IRVideoLoader *>(camera);
+	if (!l)
+	{
+		logError("load_images: NULL camera");
+		return -1;
+	}
+
+	if (l->readImages(first, count, step, calibration, pixels))
+		return 0;
+	else
+		return -1;
+}
+
 int calibrate_inplace(int cam, unsigned short *img, int size, int calibration)
 {
 	void *camera = get_void_ptr(cam);
@@ -648,6 +667,46 @@ IO_EXPORT void set_ffmpeg_log_enabled(int enable)
 	rir::setFFmpegLogEnabled((bool)enable);
 }
 
+void set_h264_read_threads(int count)
+{
+	H264_Loader::setDefaultReadThreadCount(count);
+}
+
+int get_h264_read_threads()
+{
+	return H264_Loader::defaultReadThreadCount();
+}
+
+void set_h264_prefetch_size(int count)
+{
+	H264_Loader::setDefaultPrefetchSize(count);
+}
+
+int get_h264_prefetch_size()
+{
+	return H264_Loader::defaultPrefetchSize();
+}
+
+void enable_timestamp_cache(int enable)
+{
+	IRFileLoader::setTimestampCacheEnabled(enable != 0);
+}
+
+int timestamp_cache_enabled()
+{
+	return IRFileLoader::timestampCacheEnabled() ? 1 : 0;
+}
+
+void enable_bad_pixels_cache(int enable)
+{
+	IRFileLoader::setBadPixelsCacheEnabled(enable != 0);
+}
+
+int bad_pixels_cache_enabled()
+{
+	return IRFileLoader::badPixelsCacheEnabled() ? 1 : 0;
+}
+
 struct H264 : public BaseShared
 {
 	H264_Saver saver;
@@ -676,16 +735,22 @@ int h264_open_file(const char *filename, int width, int height, int lossy_height
 	return set_void_ptr(saver.get());
 }
 
-void h264_close_file(int file)
+int h264_close_file(int file)
 {
 	H264 *saver = (H264 *)get_void_ptr(file);
 	if (!saver)
 	{
 		logError("h264_close_file: NULL identifier");
-		return;
+		return -1;
 	}
-	saver->saver.close();
+	bool res = saver->saver.close();
 	rm_void_ptr(file);
+	if (!res)
+	{
+		logError("h264_close_file: failed to write video");
+		return -1;
+	}
+	return 0;
 }
 int h264_set_parameter(int file, const char *param, const char *value)
 {
@@ -805,6 +870,17 @@ int h264_add_loss(int file, unsigned short *img)
 	return -1;
 }
 
+int h264_flush(int file)
+{
+	H264 *saver = (H264 *)get_void_ptr(file);
+	if (!saver)
+	{
+		logError("h264_flush: NULL identifier");
+		return -1;
+	}
+	return saver->saver.flush() ? 0 : -1;
+}
+
 int h264_get_low_errors(int file, unsigned short *errors, int *size)
 {
 	H264 *saver = (H264 *)get_void_ptr(file);
@@ -813,6 +889,7 @@ int h264_get_low_errors(int file, unsigned short *errors, int *size)
 		logError("h264_get_low_erros: NULL identifier");
 		return -1;
 	}
+	saver->saver.flush();
 	const std::vector<unsigned short> &err = saver->saver.lowErrors();
 	if (*size < (int)err.size())
 	{
@@ -831,6 +908,7 @@ int h264_get_high_errors(int file, unsigned short *errors, int *size)
 		logError("h264_get_high_erros: NULL identifier");
 		return -1;
 	}
+	saver->saver.flush();
 	const std::vector<unsigned short> &err = saver->saver.highErrors();
 	if (*size < (int)err.size())
 	{
@@ -893,6 +971,88 @@ int get_table(int cam, const char *name, float *dst, int *dst_size)
 	return 0;
 }
 
+#ifdef USE_ZFILE
+struct ZWriter : public BaseShared
+{
+	void *file;
+	ZWriter() : file(NULL) {}
+	~ZWriter()
+	{
+		if (file)
+			z_close_file(file);
+	}
+};
+
+int open_video_write(const char *filename, int width, int height, int rate, int method, int clevel)
+{
+	std::shared_ptr<ZWriter> writter(new ZWriter());
+	writter->file = z_open_file_write(filename, width, height, rate, method, clevel);
+	if (!writter->file)
+	{
+		logError(("open_video_write: unable to open output file " + std::string(filename)).c_str());
+		return -1;
+	}
+	return set_void_ptr(writter.get());
+}
+
+int set_video_write_threads(int writter, int threads, int queue_size)
+{
+	ZWriter *w = (ZWriter *)get_void_ptr(writter);
+	if (!w)
+	{
+		logError("set_video_write_threads: NULL identifier");
+		return -1;
+	}
+	return z_set_write_threads(w->file, threads, queue_size);
+}
+
+int image_write(int writter, unsigned short *img, int64_t time)
+{
+	ZWriter *w = (ZWriter *)get_void_ptr(writter);
+	if (!w)
+	{
+		logError("image_write: NULL identifier");
+		return -1;
+	}
+	return z_write_image(w->file, img, time);
+}
+
+int64_t close_video(int writter)
+{
+	ZWriter *w = (ZWriter *)get_void_ptr(writter);
+	if (!w)
+	{
+		logError("close_video: NULL identifier");
+		return -1;
+	}
+	int64_t res = (int64_t)z_close_file(w->file);
+	w->file = NULL;
+	rm_void_ptr(writter);
+	return res;
+}
+#else
+int open_video_write(const char *, int, int, int, int, int)
+{
+	logError("open_video_write: library compiled without ZSTD file support");
+	return -1;
+}
+int set_video_write_threads(int, int, int)
+{
+	logError("set_video_write_threads: library compiled without ZSTD file support");
+	return -1;
+}
+int image_write(int, unsigned short *, int64_t)
+{
+	logError("image_write: library compiled without ZSTD file support");
+	return -1;
+}
+int64_t close_video(int)
+{
+	logError("close_video: library compiled without ZSTD file support");
+	return -1;
+}
+#endif
+
 int get_last_image_raw_value(int cam, int x, int y, unsigned short *value)
 {
 	void *camera = get_void_ptr(cam);
@@ -955,4 +1115,70 @@ int change_hcc_external_blackbody_temperature(const char *filename, float temper
 	}
 	fout.close();
 	return 0;
-}
\ No newline at end of file
+}
+
+/**
+Returns the IRFileLoader of given HCC camera, or NULL (and log an error on behalf of \a function) if the camera is not a HCC file
+*/
+static IRFileLoader *hcc_file_loader(int cam, const char *function)
+{
+	void *camera = get_void_ptr(cam);
+	IRVideoLoader *l = static_cast<IRVideoLoader *>(camera);
+	if (!l)
+	{
+		logError((std::string(function) + ": NULL camera").c_str());
+		return NULL;
+	}
+	if (strcmp(l->typeName(), "IRFileLoader") != 0 || !static_cast<IRFileLoader *>(l)->isHCC())
+	{
+		logError((std::string(function) + ": not a HCC file").c_str());
+		return NULL;
+	}
+	return static_cast<IRFileLoader *>(l);
+}
+
+int hcc_extract_header_columns(int cam, const char *names, int first, int count, double *out)
+{
+	IRFileLoader *l = hcc_file_loader(cam, "hcc_extract_header_columns");
+	if (!l)
+		return -1;
+	if (!HCC_extractHeaderColumns(l, split(names, "\n"), first, count, out))
+		return -1;
+	return 0;
+}
+
+int hcc_has_header_timestamps(int cam)
+{
+	IRFileLoader *l = hcc_file_loader(cam, "hcc_has_header_timestamps");
+	if (!l)
+		return -1;
+	return l->hccLoader()->hasHeaderTimestamps() ? 1 : 0;
+}
+
+int hcc_dropped_frame_count(int cam)
+{
+	IRFileLoader *l = hcc_file_loader(cam, "hcc_dropped_frame_count");
+	if (!l)
+		return -1;
+	return l->hccLoader()->droppedFrameCount();
+}
+
+int hcc_frame_gaps(int cam, int *positions, int *counts, int *size)
+{
+	IRFileLoader *l = hcc_file_loader(cam, "hcc_frame_gaps");
+	if (!l)
+		return -1;
+	const std::vector<std::pair<int, int>> &gaps = l->hccLoader()->frameGaps();
+	if ((int)gaps.size() > *size)
+	{
+		*size = (int)gaps.size();
+		return -2;
+	}
+	for (size_t i = 0; i < gaps.size(); ++i)
+	{
+		positions[i] = gaps[i].first;
+		counts[i] = gaps[i].second;
+	}
+	*size = (int)gaps.size();
+	return 0;
+}
@@ -102,6 +102,14 @@ extern "C"
 	IO_EXPORT int load_image(int camera, int pos, int calibration, unsigned short *pixels);
 	IO_EXPORT int load_imageF(int camera, int pos, int calibration, float* pixels);
 
+	/**
+	Reads \a count images from \a camera starting at position \a first, every \a step images, using given \a calibration.
+	Images are stored contiguously in \a pixels, which must hold count*width*height values.
+	This is much faster than calling load_image() for each position, as backends can read whole ranges at once.
+	Returns 0 on success, -1 otherwise.
+	*/
+	IO_EXPORT int load_images(int camera, int first, int count, int step, int calibration, unsigned short *pixels);
+
 	/**
 	Apply given calibration to a DL image (inplace)
 	*/
@@ -214,6 +222,35 @@ extern "C"
 
 	IO_EXPORT void set_ffmpeg_log_enabled(int);
 
+	/**
+	Set the number of decoders used to read H264 videos opened afterward.
+	With more than one decoder, load_images() decodes disjoint GOP ranges in parallel.
+	*/
+	IO_EXPORT void set_h264_read_threads(int count);
+	IO_EXPORT int get_h264_read_threads();
+
+	/**
+	Set the number of frames decoded ahead by a background thread for H264 videos opened afterward.
+	Prefetching speeds up sequential (or regularly strided) reads with load_image(). Default to 0 (disabled).
+	*/
+	IO_EXPORT void set_h264_prefetch_size(int count);
+	IO_EXPORT int get_h264_prefetch_size();
+
+	/**
+	Enable/disable the timestamps cache for BIN/PCR/HCC files.
+	When enabled, timestamps are stored in a 'filename.rirtimes' file ('filename.rirhccidx' for HCC files) the first time a video
+	is opened, and reused afterward as long as the video file size and modification time do not change.
+	*/
+	IO_EXPORT void enable_timestamp_cache(int enable);
+	IO_EXPORT int timestamp_cache_enabled();
+	/**
+	Enable/disable the bad pixels cache for BIN/PCR files.
+	When enabled, bad pixels are stored in a 'filename.rirbadpixels' file the first time they are detected, and reused afterward
+	as long as the video file size and modification time do not change.
+	*/
+	IO_EXPORT void enable_bad_pixels_cache(int enable);
+	IO_EXPORT int bad_pixels_cache_enabled();
+
 	/**
 	Open output video file with given width and height.
 	In case of lossy compression, lossy_height  controls where the loss stops (in order to keep the last rows lossless).
@@ -221,9 +258,10 @@ extern "C"
 	*/
 	IO_EXPORT int h264_open_file(const char *filename, int width, int height, int lossy_height);
 	/**
-	Close h264 video saver
+	Close h264 video saver.
+	Returns 0 on success, -1 if the trailer could not be written or if an asynchronous frame failed.
 	*/
-	IO_EXPORT void h264_close_file(int file);
+	IO_EXPORT int h264_close_file(int file);
 	/**
 	Set a compression parameter. Supported values:
 		- compressionLevel: h264 compression level (0 for very fast, 8 for maximum compression)
@@ -276,6 +314,13 @@ extern "C"
 	 */
 	IO_EXPORT int h264_add_loss(int file, unsigned short *img);
 
+	/**
+	Wait for all images queued by h264_add_image_lossy to be compressed.
+	Only useful when the 'asyncQueue' parameter is > 0.
+	Returns 0 on success, -1 if an error occurred on a queued image.
+	 */
+	IO_EXPORT int h264_flush(int file);
+
 	IO_EXPORT int h264_get_low_errors(int file, unsigned short *errors, int *size);
 	IO_EXPORT int h264_get_high_errors(int file, unsigned short *errors, int *size);
 
@@ -298,18 +343,27 @@ extern "C"
 	/**
 	Open output video file with given image width and height, frame rate, comrpession method and compression level.
 	method == 1 means ZSTD standard compression (clevel goes from 0 to 22),
-	method == 2 means blosc+ZSTD standard compression (clevel goes from 1 to 10),
-	method == 3 means blosc+ZSTD advanced compression (clevel goes from 1 to 10).
+	method == 4 means byte shuffling + ZSTD compression (clevel goes from 0 to 22),
+	method == 5 means horizontal delta + byte shuffling + ZSTD compression (clevel goes from 0 to 22).
+	Methods 4 and 5 usually provide a better compression ratio than method 1 on IR images.
+	Methods 2 and 3 (blosc+ZSTD) are not supported.
 	Returns the video writer identifier on success, -1 on error.
 	*/
 	IO_EXPORT int open_video_write(const char *filename, int width, int height, int rate, int method, int clevel);
 	/**
+	Enable asynchronous compression for given writter: images are compressed by \a threads worker threads
+	and written in order, with at most \a queue_size pending images (2 * threads if queue_size <= 0).
+	Use threads <= 1 for synchronous writing (default).
+	Returns 0 on success, -1 on error.
+	*/
+	IO_EXPORT int set_video_write_threads(int writter, int threads, int queue_size);
+	/**
 	Write an image to given writter.
 	Returns 0 on success, -1 on error.
 	*/
 	IO_EXPORT int image_write(int writter, unsigned short *img, int64_t time);
 	/**
-	Close video writter. Returns the file size.
+	Close video writter. Returns the file size, or -1 if a queued frame could not be written.
 	*/
 	IO_EXPORT int64_t close_video(int writter);
 
@@ -320,6 +374,29 @@ extern "C"
 
 	IO_EXPORT int change_hcc_external_blackbody_temperature(const char *filename, float temperature);
 
+	/**
+	Extract numerical HCC frame header fields for \a count frames starting at \a first, in one pass over the file.
+	\a names contains the field names (HCCImageHeader members, like FWPosition or ExposureTime) separated by '\n'.
+	Values of field i are written to out[i*count] ... out[(i+1)*count-1].
+	Returns 0 on success, -1 on error.
+	*/
+	IO_EXPORT int hcc_extract_header_columns(int camera, const char *names, int first, int count, double *out);
+	/**
+	Returns 1 if the timestamps of given HCC camera were read from the frame headers (POSIXTime/SubSecondTime),
+	0 if they were computed from the acquisition frame rate, -1 on error.
+	*/
+	IO_EXPORT int hcc_has_header_timestamps(int camera);
+	/**
+	Returns the total number of frames missing from given HCC camera file (detected from frame IDs or timestamps), -1 on error.
+	*/
+	IO_EXPORT int hcc_dropped_frame_count(int camera);
+	/**
+	Returns the positions where frames are missing in given HCC camera file, and the number of frames missing just before each position.
+	On input, \a size is the capacity of \a positions and \a counts. On output, it is the number of gaps.
+	Returns 0 on success, -1 on error, -2 if \a size is too small.
+	*/
+	IO_EXPORT int hcc_frame_gaps(int camera, int *positions, int *counts, int *size);
+
 	
 
 #ifdef __cplusplus
@@ -0,0 +1,32 @@
+from .rir_geometry import (
+    polygon_index_create,
+    polygon_index_find,
+    polygon_index_overlapping,
+    polygon_index_destroy,
+)
+
+
+class PolygonIndex:
+    """
+    Spatial index over a fixed set of polygons (tiles, antennas...) used to
+    map many points to the polygon containing them in one call.
+    """
+
+    def __init__(self, polygons):
+        self.handle = polygon_index_create(polygons)
+
+    def __del__(self):
+        polygon_index_destroy(self.handle)
+
+    def find(self, points):
+        """
+        For each point of a (N,2) array of x,y values, returns the index of
+        the first polygon containing it, or -1
+        """
+        return polygon_index_find(self.handle, points)
+
+    def overlapping(self, polygon):
+        """
+        Returns the indexes of all polygons overlapping given polygon
+        """
+        return polygon_index_overlapping(self.handle, polygon)
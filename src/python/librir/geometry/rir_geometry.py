@@ -334,3 +334,93 @@ def count_pixel_in_polygon(points):
         raise RuntimeError("count_pixel_in_polygon: unknown error")
 
     return area[0]
+
+
+def polygon_index_create(polygons):
+    """
+    Create a spatial index over a list of polygons (each one on the form [[x1,y1],...,[xn,yn]])
+    and returns its handle
+    """
+    polys = [np.array(p, dtype=np.float64).reshape((-1, 2)) for p in polygons]
+    counts = np.array([len(p) for p in polys], dtype=np.int32)
+    if len(polys):
+        xy = np.ascontiguousarray(np.concatenate(polys), dtype=np.float64)
+    else:
+        xy = np.zeros((0, 2), dtype=np.float64)
+
+    _geometry.polygon_index_create.argtypes = [
+        ct.POINTER(ct.c_double),
+        ct.POINTER(ct.c_int),
+        ct.c_int,
+    ]
+    ret = _geometry.polygon_index_create(
+        xy.ctypes.data_as(ct.POINTER(ct.c_double)),
+        counts.ctypes.data_as(ct.POINTER(ct.c_int)),
+        len(polys),
+    )
+    if ret == 0:
+        raise RuntimeError("polygon_index_create: unknown error")
+    return ret
+
+
+def polygon_index_find(handle, points):
+    """
+    For each point of points ([[x1,y1],...,[xn,yn]]), returns the index of the first
+    polygon containing it, or -1
+    """
+    xy = np.ascontiguousarray(points, dtype=np.float64).reshape((-1, 2))
+    out = np.zeros((len(xy)), dtype=np.int32)
+
+    _geometry.polygon_index_find.argtypes = [
+        ct.c_int,
+        ct.POINTER(ct.c_double),
+        ct.c_int,
+        ct.POINTER(ct.c_int),
+    ]
+    tmp = _geometry.polygon_index_find(
+        handle,
+        xy.ctypes.data_as(ct.POINTER(ct.c_double)),
+        len(xy),
+        out.ctypes.data_as(ct.POINTER(ct.c_int)),
+    )
+    if tmp < 0:
+        raise RuntimeError("polygon_index_find: invalid handle")
+    return out
+
+
+def polygon_index_overlapping(handle, polygon):
+    """
+    Returns the indexes of all polygons overlapping given polygon ([[x1,y1],...,[xn,yn]])
+    """
+    xy = np.ascontiguousarray(polygon, dtype=np.float64).reshape((-1, 2))
+    count = _geometry.polygon_index_count(handle)
+    if count < 0:
+        raise RuntimeError("polygon_index_overlapping: invalid handle")
+    out = np.zeros((count), dtype=np.int32)
+    outsize = np.zeros((1), dtype=np.int32)
+    outsize[0] = count
+
+    _geometry.polygon_index_overlapping.argtypes = [
+        ct.c_int,
+        ct.POINTER(ct.c_double),
+        ct.c_int,
+        ct.POINTER(ct.c_int),
+        ct.POINTER(ct.c_int),
+    ]
+    tmp = _geometry.polygon_index_overlapping(
+        handle,
+        xy.ctypes.data_as(ct.POINTER(ct.c_double)),
+        len(xy),
+        out.ctypes.data_as(ct.POINTER(ct.c_int)),
+        outsize.ctypes.data_as(ct.POINTER(ct.c_int)),
+    )
+    if tmp < 0:
+        raise RuntimeError("polygon_index_overlapping: unknown error")
+    return out[0 : outsize[0]]
+
+
+def polygon_index_destroy(handle):
+    """
+    Destroy polygon index
+    """
+    _geometry.polygon_index_destroy(handle)
@@ -8,8 +8,13 @@ Created on Wed Sep 16 12:59:54 2020
 
 from .rir_signal_processing import (
     bad_pixels_create,
+    bad_pixels_create_from_stack,
     bad_pixels_correct,
     bad_pixels_destroy,
+    bad_pixels_save,
+    bad_pixels_load,
+    bad_pixels_coordinates,
+    bad_pixels_set_low_value_threshold,
 )
 
 
@@ -18,8 +23,40 @@ class BadPixels:
     Class used to correct bad pixels inside an IR handle
     """
 
-    def __init__(self, first_image):
-        self.handle = bad_pixels_create(first_image)
+    def __init__(self, first_image=None, handle=None):
+        self.handle = handle
+        if self.handle is None:
+            self.handle = bad_pixels_create(first_image)
+
+    @staticmethod
+    def from_stack(images, std_factor=5.0):
+        """
+        Build the bad pixels list from a stack of images (3D array)
+        """
+        return BadPixels(handle=bad_pixels_create_from_stack(images, std_factor))
+
+    @staticmethod
+    def load(filename):
+        """
+        Load a bad pixels file written with save()
+        """
+        return BadPixels(handle=bad_pixels_load(filename))
+
+    def save(self, filename):
+        bad_pixels_save(self.handle, filename)
+
+    @property
+    def coordinates(self):
+        """
+        Bad pixel coordinates as a (N,2) array of x,y values
+        """
+        return bad_pixels_coordinates(self.handle)
+
+    def set_low_value_threshold(self, threshold):
+        """
+        Set the value to which corrected images are clamped (<= 0 disables it)
+        """
+        bad_pixels_set_low_value_threshold(self.handle, threshold)
 
     def __del__(self):
         bad_pixels_destroy(self.handle)
@@ -0,0 +1,53 @@
+from .rir_signal_processing import (
+    hot_spot_tracker_create,
+    hot_spot_tracker_add_image,
+    hot_spot_tracker_track_count,
+    hot_spot_tracker_track,
+    hot_spot_tracker_polygon,
+    hot_spot_tracker_destroy,
+)
+
+
+class HotSpotTracker:
+    """
+    Track hot spots (connected regions of a mask) across consecutive frames.
+
+    Each hot spot of a frame is associated to the track of the previous frame
+    it overlaps the most (overlap of at least min_overlap times the smallest
+    area). Hot spots smaller than min_area pixels are ignored.
+    """
+
+    def __init__(self, min_overlap=0.1, min_area=1, compute_polygons=False):
+        self.handle = hot_spot_tracker_create(min_overlap, min_area, compute_polygons)
+
+    def __del__(self):
+        hot_spot_tracker_destroy(self.handle)
+
+    def add(self, mask, time, values=None, background_value=0):
+        """
+        Add a frame as a mask image, pixels different from background_value
+        being hot spots. values is an optional image (typically temperatures)
+        used to compute the hot spots maximum values.
+        """
+        hot_spot_tracker_add_image(self.handle, mask, time, values, background_value)
+
+    def __len__(self):
+        return hot_spot_tracker_track_count(self.handle)
+
+    def track(self, index):
+        """
+        Returns the time series of a track as a dict of arrays
+        (see hot_spot_tracker_track)
+        """
+        return hot_spot_tracker_track(self.handle, index)
+
+    @property
+    def tracks(self):
+        return [self.track(i) for i in range(len(self))]
+
+    def polygon(self, track, sample):
+        """
+        Returns the bounding polygon of a track sample
+        (requires compute_polygons=True)
+        """
+        return hot_spot_tracker_polygon(self.handle, track, sample)
@@ -0,0 +1,39 @@
+from .rir_signal_processing import (
+    roi_stats_create,
+    roi_stats_add_polygon,
+    roi_stats_compute,
+    roi_stats_destroy,
+)
+
+
+class RoiStatistics:
+    """
+    Compute statistics of several polygon ROIs over a stream of images.
+
+    ROIs are rasterized once, and statistics are computed directly on the
+    images without building masks.
+    """
+
+    def __init__(self, width, height, polygons=()):
+        self.handle = roi_stats_create(width, height)
+        for p in polygons:
+            self.add_polygon(p)
+
+    def __del__(self):
+        roi_stats_destroy(self.handle)
+
+    def add_polygon(self, polygon):
+        """
+        Add a polygon ROI given as a (N,2) array of x,y values, and returns its index
+        """
+        return roi_stats_add_polygon(self.handle, polygon)
+
+    def compute(self, images, percent=-1):
+        """
+        Returns an array of shape (image_count, roi_count, 5) containing for
+        each image and ROI the pixel count, mean, min, max and percentile values.
+        The percentile is the smallest value v such that at least round(count*percent)
+        pixels are <= v (0 if round(count*percent) is 0, as for find_median_pixel),
+        and is only computed if percent is in [0, 1].
+        """
+        return roi_stats_compute(self.handle, images, percent)
@@ -8,9 +8,11 @@ from .rir_signal_processing import (
     translate,
     gaussian_filter,
     find_median_pixel,
+    find_quantiles,
     extract_times,
     resample_time_serie,
     label_image,
+    label_image_stats,
     keep_largest_area,
 )
 
@@ -18,8 +20,10 @@ __all__ = [
     "translate",
     "gaussian_filter",
     "find_median_pixel",
+    "find_quantiles",
     "extract_times",
     "resample_time_serie",
     "label_image",
+    "label_image_stats",
     "keep_largest_area",
 ]
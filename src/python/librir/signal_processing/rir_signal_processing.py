@@ -82,33 +82,49 @@ def translate(image, dx, dy, strategy=str(), background=None):
     return res
 
 
-def gaussian_filter(image, sigma=1.0):
+_GAUSSIAN_METHODS = {"fir": 0, "iir": 1, "auto": 2}
+
+
+def gaussian_filter(image, sigma=1.0, method="fir"):
     """
     Apply a gaussian filter on input image with given sigma value.
+    image can be a 2D image or a 3D stack of images, in which case each image is filtered independently.
+
+    method controls the filter implementation:
+    "fir" uses a separable convolution with a kernel of radius 2*sigma,
+    "iir" uses a recursive approximation whose cost does not depend on sigma,
+    "auto" selects "iir" for large sigma values.
     The result image is always of type np.float32.
     """
-    _signal_processing.gaussian_filter.argtypes = [
+    _signal_processing.gaussian_filter_stack.argtypes = [
         ct.POINTER(ct.c_float),
         ct.POINTER(ct.c_float),
         ct.c_int,
         ct.c_int,
+        ct.c_int,
         ct.c_float,
+        ct.c_int,
     ]
-    if len(image.shape) != 2:
+    if len(image.shape) not in (2, 3):
         raise RuntimeError("gaussian_filter: wrong input image dimension")
+    if method not in _GAUSSIAN_METHODS:
+        raise RuntimeError("gaussian_filter: unknown method " + str(method))
 
-    img = np.array(image, dtype=np.float32)
+    img = np.ascontiguousarray(image, dtype=np.float32)
     res = np.zeros(image.shape, dtype=np.float32)
+    count = 1 if len(image.shape) == 2 else image.shape[0]
 
-    tmp = _signal_processing.gaussian_filter(
+    tmp = _signal_processing.gaussian_filter_stack(
         img.ctypes.data_as(ct.POINTER(ct.c_float)),
         res.ctypes.data_as(ct.POINTER(ct.c_float)),
-        img.shape[1],
-        img.shape[0],
+        img.shape[-1],
+        img.shape[-2],
+        count,
         sigma,
+        _GAUSSIAN_METHODS[method],
     )
-    # if tmp < 0:
-    #     raise RuntimeError("An error occured while calling gaussian_filter")
+    if tmp < 0:
+        raise RuntimeError("An error occured while calling gaussian_filter")
 
     return res
 
@@ -147,6 +163,51 @@ def find_median_pixel(image, percent=0.5, mask=None):
     return res
 
 
+def find_quantiles(images, percents, mask=None):
+    """
+    Compute several quantiles in one pass over one image (2D) or a stack of images (3D).
+    mask (optional) is a 2D array applied to each image.
+    Returns a numpy array of quantile values.
+    """
+    _signal_processing.find_quantiles.argtypes = [
+        ct.POINTER(ct.c_uint16),
+        ct.POINTER(ct.c_uint8),
+        ct.c_int,
+        ct.c_int,
+        ct.POINTER(ct.c_float),
+        ct.c_int,
+        ct.POINTER(ct.c_int),
+    ]
+    images = np.ascontiguousarray(images, dtype=np.uint16)
+    if len(images.shape) == 2:
+        images = images.reshape((1,) + images.shape)
+    if len(images.shape) != 3:
+        raise RuntimeError("find_quantiles: wrong input image dimension")
+    size = images.shape[1] * images.shape[2]
+
+    mask_ptr = None
+    if mask is not None:
+        mask = np.ascontiguousarray(mask, dtype=np.uint8)
+        if mask.size != size:
+            raise RuntimeError("find_quantiles: wrong mask size")
+        mask_ptr = mask.ctypes.data_as(ct.POINTER(ct.c_uint8))
+
+    percents = np.ascontiguousarray(np.atleast_1d(percents), dtype=np.float32)
+    out = np.zeros(percents.shape, dtype=np.int32)
+    res = _signal_processing.find_quantiles(
+        images.ctypes.data_as(ct.POINTER(ct.c_uint16)),
+        mask_ptr,
+        size,
+        images.shape[0],
+        percents.ctypes.data_as(ct.POINTER(ct.c_float)),
+        percents.size,
+        out.ctypes.data_as(ct.POINTER(ct.c_int)),
+    )
+    if res < 0:
+        raise RuntimeError("find_quantiles: invalid input")
+    return out
+
+
 def extract_times(time_series, strategy="union"):
     """
     Create a unique time vector from several ones.
@@ -288,6 +349,95 @@ def bad_pixels_create(first_image):
     return ret
 
 
+def bad_pixels_create_from_stack(images, std_factor=5.0):
+    """
+    Create an object meant to correct bad pixels inside IR videos.
+    The list of bad pixels is constructed from a stack of images (3D array),
+    detecting spatial outliers as well as stuck and blinking pixels.
+    Returns the object handle.
+    """
+    imgs = np.ascontiguousarray(images, dtype=np.uint16)
+    if len(imgs.shape) == 2:
+        imgs = imgs.reshape((1,) + imgs.shape)
+    if len(imgs.shape) != 3:
+        raise RuntimeError("'bad_pixels_create_from_stack': wrong input dimensions")
+    _signal_processing.bad_pixels_create_from_stack.argtypes = [
+        ct.POINTER(ct.c_ushort),
+        ct.c_int,
+        ct.c_int,
+        ct.c_int,
+        ct.c_double,
+    ]
+    ret = _signal_processing.bad_pixels_create_from_stack(
+        imgs.ctypes.data_as(ct.POINTER(ct.c_ushort)),
+        imgs.shape[0],
+        imgs.shape[2],
+        imgs.shape[1],
+        std_factor,
+    )
+    if ret == 0:
+        raise RuntimeError("'bad_pixels_create_from_stack': unknown error")
+    return ret
+
+
+def bad_pixels_save(handle, filename):
+    """
+    Save the bad pixel map to a file
+    """
+    _signal_processing.bad_pixels_save.argtypes = [ct.c_int, ct.c_char_p]
+    if _signal_processing.bad_pixels_save(handle, filename.encode()) < 0:
+        raise RuntimeError("'bad_pixels_save': unable to write " + filename)
+
+
+def bad_pixels_load(filename):
+    """
+    Create a bad pixels correction object from a file written with bad_pixels_save().
+    Returns the object handle.
+    """
+    _signal_processing.bad_pixels_load.argtypes = [ct.c_char_p]
+    ret = _signal_processing.bad_pixels_load(filename.encode())
+    if ret == 0:
+        raise RuntimeError("'bad_pixels_load': unable to read " + filename)
+    return ret
+
+
+def bad_pixels_coordinates(handle):
+    """
+    Returns the bad pixel coordinates as a (N,2) array of x,y values
+    """
+    _signal_processing.bad_pixels_coordinates.argtypes = [
+        ct.c_int,
+        ct.POINTER(ct.c_int),
+        ct.POINTER(ct.c_int),
+    ]
+    size = ct.c_int(0)
+    xy = np.zeros((0, 2), dtype=np.int32)
+    res = _signal_processing.bad_pixels_coordinates(
+        handle, xy.ctypes.data_as(ct.POINTER(ct.c_int)), ct.byref(size)
+    )
+    if res == -2:
+        xy = np.zeros((size.value, 2), dtype=np.int32)
+        res = _signal_processing.bad_pixels_coordinates(
+            handle, xy.ctypes.data_as(ct.POINTER(ct.c_int)), ct.byref(size)
+        )
+    if res < 0:
+        raise RuntimeError("'bad_pixels_coordinates': unknown error")
+    return xy
+
+
+def bad_pixels_set_low_value_threshold(handle, threshold):
+    """
+    Set the low value threshold used by bad_pixels_correct() (<= 0 disables it)
+    """
+    _signal_processing.bad_pixels_set_low_value_threshold.argtypes = [
+        ct.c_int,
+        ct.c_int,
+    ]
+    res = _signal_processing.bad_pixels_set_low_value_threshold(handle, int(threshold))
+    if res < 0:
+        raise RuntimeError("'bad_pixels_set_low_value_threshold': invalid handle")
+
+
 def bad_pixels_destroy(handle):
     """
     Destroy bad pixel object
@@ -370,6 +520,310 @@ def label_image(image: np.ndarray, background_value=0):
     return (res, areas, xy)
 
 
+def label_image_stats(image: np.ndarray, background_value=0, values=None):
+    """
+    Closed Component Labelling algorithm with per label statistics.
+    Returns a tuple (image, areas, bboxes, centroids, max_values), each index
+    of the arrays corresponding to the label value (index 0 being the background).
+    bboxes are given as (xmin, ymin, xmax, ymax) with max excluded, centroids
+    as (x, y).
+    max_values contains the maximum of the optional values image (same shape
+    as input image) inside each label, 0 if values is None.
+    """
+
+    _signal_processing.label_image_stats.argtypes = [
+        ct.c_int,
+        ct.c_void_p,
+        ct.POINTER(ct.c_int),
+        ct.c_int,
+        ct.c_int,
+        ct.c_void_p,
+        ct.POINTER(ct.c_float),
+        ct.c_int,
+        ct.POINTER(ct.c_int),
+        ct.POINTER(ct.c_int),
+        ct.POINTER(ct.c_double),
+        ct.POINTER(ct.c_double),
+    ]
+
+    if len(image.shape) != 2:
+        raise RuntimeError("label_image_stats: wrong input image dimension")
+
+    _dtype = _DTYPES.get(image.dtype, None)
+    if _dtype is None:
+        raise RuntimeError("An error occured while calling 'label_image_stats'")
+
+    img = np.ascontiguousarray(image)
+    pvalues = None
+    if values is not None:
+        values = np.ascontiguousarray(values, dtype=np.float32)
+        if values.shape != image.shape:
+            raise RuntimeError("label_image_stats: wrong values image shape")
+        pvalues = values.ctypes.data_as(ct.POINTER(ct.c_float))
+
+    res = np.zeros(image.shape, dtype=np.int32)
+    background = np.zeros(1, dtype=image.dtype)
+    background[0] = background_value
+    capacity = img.size + 1
+    areas = np.zeros(capacity, dtype=np.int32)
+    bboxes = np.zeros((capacity, 4), dtype=np.int32)
+    centroids = np.zeros((capacity, 2), dtype=np.float64)
+    maxs = np.zeros(capacity, dtype=np.float64)
+
+    r = _signal_processing.label_image_stats(
+        ord(_dtype),
+        img.ctypes.data_as(ct.c_void_p),
+        res.ctypes.data_as(ct.POINTER(ct.c_int)),
+        img.shape[1],
+        img.shape[0],
+        background.ctypes.data_as(ct.c_void_p),
+        pvalues,
+        capacity,
+        areas.ctypes.data_as(ct.POINTER(ct.c_int)),
+        bboxes.ctypes.data_as(ct.POINTER(ct.c_int)),
+        centroids.ctypes.data_as(ct.POINTER(ct.c_double)),
+        maxs.ctypes.data_as(ct.POINTER(ct.c_double)),
+    )
+    if r < 0:
+        raise RuntimeError("An error occured while calling 'label_image_stats'")
+
+    return (res, areas[0:r], bboxes[0:r], centroids[0:r], maxs[0:r])
+
+
+def hot_spot_tracker_create(min_overlap=0.1, min_area=1, compute_polygons=False):
+    """
+    Create a hot spot tracker and returns its handle
+    """
+    _signal_processing.hot_spot_tracker_create.argtypes = [
+        ct.c_double,
+        ct.c_int,
+        ct.c_int,
+    ]
+    ret = _signal_processing.hot_spot_tracker_create(
+        min_overlap, min_area, int(compute_polygons)
+    )
+    if ret == 0:
+        raise RuntimeError("'hot_spot_tracker_create': unknown error")
+    return ret
+
+
+def hot_spot_tracker_add_image(handle, mask, time, values=None, background_value=0):
+    """
+    Add a mask image to the hot spot tracker.
+    values is an optional image used to compute the hot spots maximum values.
+    """
+    if len(mask.shape) != 2:
+        raise RuntimeError("hot_spot_tracker_add_image: wrong input image dimension")
+    _dtype = _DTYPES.get(mask.dtype, None)
+    if _dtype is None:
+        raise RuntimeError("An error occured while calling 'hot_spot_tracker_add_image'")
+
+    img = np.ascontiguousarray(mask)
+    pvalues = None
+    if values is not None:
+        values = np.ascontiguousarray(values, dtype=np.float32)
+        if values.shape != mask.shape:
+            raise RuntimeError("hot_spot_tracker_add_image: wrong values image shape")
+        pvalues = values.ctypes.data_as(ct.POINTER(ct.c_float))
+    background = np.zeros(1, dtype=mask.dtype)
+    background[0] = background_value
+
+    _signal_processing.hot_spot_tracker_add_image.argtypes = [
+        ct.c_int,
+        ct.c_int,
+        ct.c_void_p,
+        ct.c_int,
+        ct.c_int,
+        ct.c_void_p,
+        ct.POINTER(ct.c_float),
+        ct.c_double,
+    ]
+    r = _signal_processing.hot_spot_tracker_add_image(
+        handle,
+        ord(_dtype),
+        img.ctypes.data_as(ct.c_void_p),
+        img.shape[1],
+        img.shape[0],
+        background.ctypes.data_as(ct.c_void_p),
+        pvalues,
+        time,
+    )
+    if r < 0:
+        raise RuntimeError("An error occured while calling 'hot_spot_tracker_add_image'")
+
+
+def hot_spot_tracker_track_count(handle):
+    """
+    Returns the number of tracks of a hot spot tracker
+    """
+    r = _signal_processing.hot_spot_tracker_track_count(handle)
+    if r < 0:
+        raise RuntimeError("'hot_spot_tracker_track_count': invalid handle")
+    return r
+
+
+def hot_spot_tracker_track(handle, track):
+    """
+    Returns the time series of a track as a dict of arrays with keys
+    'frames', 'times', 'areas', 'max_values', 'centroids' (x, y) and
+    'bboxes' (xmin, ymin, xmax, ymax with max excluded)
+    """
+    _signal_processing.hot_spot_tracker_track_size.argtypes = [ct.c_int, ct.c_int]
+    size = _signal_processing.hot_spot_tracker_track_size(handle, track)
+    if size < 0:
+        raise RuntimeError("'hot_spot_tracker_track': invalid track")
+
+    res = {
+        "frames": np.zeros(size, dtype=np.int32),
+        "times": np.zeros(size, dtype=np.float64),
+        "areas": np.zeros(size, dtype=np.int32),
+        "max_values": np.zeros(size, dtype=np.float64),
+        "centroids": np.zeros((size, 2), dtype=np.float64),
+        "bboxes": np.zeros((size, 4), dtype=np.int32),
+    }
+    _signal_processing.hot_spot_tracker_track.argtypes = [
+        ct.c_int,
+        ct.c_int,
+        ct.POINTER(ct.c_int),
+        ct.POINTER(ct.c_double),
+        ct.POINTER(ct.c_int),
+        ct.POINTER(ct.c_double),
+        ct.POINTER(ct.c_double),
+        ct.POINTER(ct.c_int),
+    ]
+    r = _signal_processing.hot_spot_tracker_track(
+        handle,
+        track,
+        res["frames"].ctypes.data_as(ct.POINTER(ct.c_int)),
+        res["times"].ctypes.data_as(ct.POINTER(ct.c_double)),
+        res["areas"].ctypes.data_as(ct.POINTER(ct.c_int)),
+        res["max_values"].ctypes.data_as(ct.POINTER(ct.c_double)),
+        res["centroids"].ctypes.data_as(ct.POINTER(ct.c_double)),
+        res["bboxes"].ctypes.data_as(ct.POINTER(ct.c_int)),
+    )
+    if r < 0:
+        raise RuntimeError("'hot_spot_tracker_track': unknown error")
+    return res
+
+
+def hot_spot_tracker_polygon(handle, track, sample):
+    """
+    Returns the bounding polygon of a track sample as a (N,2) array of x,y values
+    """
+    _signal_processing.hot_spot_tracker_polygon.argtypes = [
+        ct.c_int,
+        ct.c_int,
+        ct.c_int,
+        ct.POINTER(ct.c_int),
+        ct.POINTER(ct.c_int),
+    ]
+    size = ct.c_int(0)
+    xy = np.zeros((0, 2), dtype=np.int32)
+    r = _signal_processing.hot_spot_tracker_polygon(
+        handle, track, sample, xy.ctypes.data_as(ct.POINTER(ct.c_int)), ct.byref(size)
+    )
+    if r == -2:
+        xy = np.zeros((size.value, 2), dtype=np.int32)
+        r = _signal_processing.hot_spot_tracker_polygon(
+            handle,
+            track,
+            sample,
+            xy.ctypes.data_as(ct.POINTER(ct.c_int)),
+            ct.byref(size),
+        )
+    if r < 0:
+        raise RuntimeError("'hot_spot_tracker_polygon': unknown error")
+    return xy
+
+
+def hot_spot_tracker_destroy(handle):
+    """
+    Destroy hot spot tracker object
+    """
+    _signal_processing.hot_spot_tracker_destroy(handle)
+
+
+def roi_stats_create(width, height):
+    """
+    Create a ROI statistics object for images of given size and returns its handle
+    """
+    _signal_processing.roi_stats_create.argtypes = [ct.c_int, ct.c_int]
+    ret = _signal_processing.roi_stats_create(width, height)
+    if ret == 0:
+        raise RuntimeError("'roi_stats_create': wrong image size")
+    return ret
+
+
+def roi_stats_add_polygon(handle, polygon):
+    """
+    Add a polygon ROI given as a (N,2) array of x,y values and returns its index
+    """
+    xy = np.ascontiguousarray(polygon, dtype=np.float64)
+    if len(xy.shape) != 2 or xy.shape[1] != 2:
+        raise RuntimeError("'roi_stats_add_polygon': wrong polygon shape")
+    _signal_processing.roi_stats_add_polygon.argtypes = [
+        ct.c_int,
+        ct.POINTER(ct.c_double),
+        ct.c_int,
+    ]
+    r = _signal_processing.roi_stats_add_polygon(
+        handle, xy.ctypes.data_as(ct.POINTER(ct.c_double)), xy.shape[0]
+    )
+    if r < 0:
+        raise RuntimeError("'roi_stats_add_polygon': invalid handle")
+    return r
+
+
+def roi_stats_compute(handle, images, percent=-1):
+    """
+    Compute the statistics of all ROIs on a stack of images (2D or 3D array).
+    Returns an array of shape (image_count, roi_count, 5) containing for each
+    ROI the pixel count, mean, min, max and percentile values.
+    The percentile is only computed if percent is in [0, 1].
+    """
+    if images.dtype == np.float32 or images.dtype == np.float64:
+        imgs = np.ascontiguousarray(images, dtype=np.float32)
+        _dtype = "f"
+    else:
+        imgs = np.ascontiguousarray(images, dtype=np.uint16)
+        _dtype = "H"
+    if len(imgs.shape) == 2:
+        imgs = imgs.reshape((1,) + imgs.shape)
+    if len(imgs.shape) != 3:
+        raise RuntimeError("'roi_stats_compute': wrong input dimensions")
+
+    roi_count = _signal_processing.roi_stats_count(handle)
+    if roi_count < 0:
+        raise RuntimeError("'roi_stats_compute': invalid handle")
+    out = np.zeros((imgs.shape[0], roi_count, 5), dtype=np.float64)
+    _signal_processing.roi_stats_compute.argtypes = [
+        ct.c_int,
+        ct.c_int,
+        ct.c_void_p,
+        ct.c_int,
+        ct.c_double,
+        ct.POINTER(ct.c_double),
+    ]
+    r = _signal_processing.roi_stats_compute(
+        handle,
+        ord(_dtype),
+        imgs.ctypes.data_as(ct.c_void_p),
+        imgs.shape[0],
+        percent,
+        out.ctypes.data_as(ct.POINTER(ct.c_double)),
+    )
+    if r < 0:
+        raise RuntimeError("'roi_stats_compute': unknown error")
+    return out
+
+
+def roi_stats_destroy(handle):
+    """
+    Destroy ROI statistics object
+    """
+    _signal_processing.roi_stats_destroy(handle)
+
+
 def keep_largest_area(image, background_value=0, foreground_value=1):
     """
     Returns an image where the largest closed region of input image is set to
@@ -14,6 +14,7 @@ from .rir_video_io import (
     h264_add_image_lossless,
     h264_add_image_lossy,
     h264_add_loss,
+    h264_flush,
     h264_get_low_errors,
     h264_get_high_errors,
 )
@@ -81,8 +82,9 @@ class IRSaver(object):
         the file trailer (image timestamps and attributes).
         """
         if self.handle > 0:
-            h264_close_file(self.handle)
+            handle = self.handle
             self.handle = 0
+            h264_close_file(handle)
 
     def open(self, outfile, width, height, lossy_height=None):
         """
@@ -123,7 +125,8 @@ class IRSaver(object):
                 - stdFactor: factor used by the error reduction mechanism as described in []. Default to 5.
                 - inputCamera: input camera identifier used for the DL to temperature calibration (see addImageLossy() function). Default to 0 (disabled).
                 - removeBadPixels: remove images bad pixels if set to 1. Default to 0 (disabled)
-                - runningAverage: running average length as described in [], used for lossy compression. Default to 32.
+                - runningAverage: running average length as described in [], used for lossy compression, clamped to [0, 64]. Default to 32.
+                - asyncQueue: if > 0, add_image_lossy() only queues the image, and loss introduction and encoding run in background threads (only encoding with an inputCamera). Default to 0.
         """
         if self.is_open():
             h264_set_parameter(self.handle, param, str(value))
@@ -183,6 +186,13 @@ class IRSaver(object):
 
         return h264_add_loss(self.handle, image)
 
+    def flush(self):
+        """
+        Wait for all images queued by add_image_lossy() to be compressed (asyncQueue parameter > 0)
+        """
+        if self.handle > 0:
+            h264_flush(self.handle)
+
     def get_low_errors(self):
         return h264_get_low_errors(self.handle)
 
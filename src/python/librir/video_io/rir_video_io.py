@@ -245,6 +245,65 @@ def load_image(camera, pos, calibration):
     return pixels
 
 
+def load_imageF(camera, pos, calibration):
+    """
+    Returns the image at position 'pos' for given camera as a float32 array.
+    Unlike load_image(), calibrated temperatures keep their sub-degree precision.
+
+    C signature:
+    int load_imageF(int camera, int pos, int calibration, float * pixels);
+    """
+    size = get_image_size(camera)
+    pixels = np.zeros(size, dtype=np.float32)
+
+    res = _video_io.load_imageF(
+        camera,
+        ct.c_int32(pos),
+        calibration,
+        pixels.ctypes.data_as(ct.POINTER(ct.c_float)),
+    )
+    if res < 0:
+        raise RuntimeError(
+            "cannot retrieve camera image for position "
+            + str(pos)
+            + " and calibration "
+            + str(calibration)
+        )
+
+    return pixels
+
+
+def load_images(camera, first, count, step, calibration):
+    """
+    Returns 'count' images starting at position 'first', every 'step' images,
+    as a (count, height, width) array.
+    This is much faster than calling load_image() for each position.
+
+    C signature:
+    int load_images(int camera, int first, int count, int step, int calibration, unsigned short * pixels);
+    """
+    size = get_image_size(camera)
+    pixels = np.zeros((count,) + tuple(size), dtype=np.ushort)
+
+    res = _video_io.load_images(
+        camera,
+        ct.c_int32(first),
+        ct.c_int32(count),
+        ct.c_int32(step),
+        calibration,
+        pixels.ctypes.data_as(ct.POINTER(ct.c_ushort)),
+    )
+    if res < 0:
+        raise RuntimeError(
+            "cannot retrieve camera images from position "
+            + str(first)
+            + " and calibration "
+            + str(calibration)
+        )
+
+    return pixels
+
+
 def set_global_emissivity(camera, emi_value):
     """Set the global scene emissivity for given camera file"""
     _video_io.set_global_emissivity.argtypes = [ct.c_int, ct.c_float]
@@ -512,7 +571,9 @@ def h264_close_file(saver):
     """
     Close h264 video saver
     """
-    _video_io.h264_close_file(saver)
+    tmp = _video_io.h264_close_file(saver)
+    if tmp < 0:
+        raise RuntimeError("An error occured while calling 'h264_close_file'")
 
 
 def h264_set_parameter(saver, param, value):
@@ -690,6 +751,16 @@ def h264_add_loss(saver, image):
     return image
 
 
+def h264_flush(saver):
+    """
+    Wait for all images queued by h264_add_image_lossy to be compressed
+    (only useful when the 'asyncQueue' parameter is > 0).
+    """
+    tmp = _video_io.h264_flush(saver)
+    if tmp < 0:
+        raise RuntimeError("An error occured while calling 'h264_flush'")
+
+
 def h264_get_low_errors(saver: int):
     """
     Returns the low error vector for last saved movie
@@ -750,6 +821,123 @@ def h264_get_high_errors(saver):
     return err[0 : size[0]]
 
 
+def set_h264_read_threads(count):
+    """
+    Set the number of decoders used to read H264 videos opened afterward.
+    With more than one decoder, load_images() decodes disjoint GOP ranges in parallel.
+    """
+    _video_io.set_h264_read_threads(int(count))
+
+
+def get_h264_read_threads():
+    """
+    Returns the number of decoders used to read H264 videos opened afterward.
+    """
+    return _video_io.get_h264_read_threads()
+
+
+def set_h264_prefetch_size(count):
+    """
+    Set the number of frames decoded ahead by a background thread for H264 videos
+    opened afterward (0 disables prefetching).
+    """
+    _video_io.set_h264_prefetch_size(int(count))
+
+
+def get_h264_prefetch_size():
+    """
+    Returns the number of frames decoded ahead for H264 videos opened afterward.
+    """
+    return _video_io.get_h264_prefetch_size()
+
+
+def enable_timestamp_cache(enable=True):
+    """
+    Enable/disable the timestamps cache for BIN/PCR/HCC files opened afterward.
+    When enabled, timestamps are stored next to the video file the first time it is opened,
+    and reused as long as the video file size and modification time do not change.
+    """
+    _video_io.enable_timestamp_cache(int(enable))
+
+
+def timestamp_cache_enabled():
+    """
+    Returns True if the timestamps cache is enabled
+    """
+    return _video_io.timestamp_cache_enabled() != 0
+
+
+def enable_bad_pixels_cache(enable=True):
+    """
+    Enable/disable the bad pixels cache for BIN/PCR files.
+    When enabled, bad pixels are stored in a 'filename.rirbadpixels' file the first time they are detected,
+    and reused as long as the video file size and modification time do not change.
+    """
+    _video_io.enable_bad_pixels_cache(int(enable))
+
+
+def bad_pixels_cache_enabled():
+    """
+    Returns True if the bad pixels cache is enabled
+    """
+    return _video_io.bad_pixels_cache_enabled() != 0
+
+
+def open_video_write(filename, width, height, rate, method=1, clevel=3):
+    """
+    Open a ZSTD compressed output video file (requires librir built with USE_ZFILE).
+    Supported methods are 1 (ZSTD), 4 (byte shuffle + ZSTD) and 5 (delta + byte shuffle + ZSTD).
+    Returns the writer identifier.
+    """
+    _video_io.open_video_write.argtypes = [
+        ct.c_char_p,
+        ct.c_int,
+        ct.c_int,
+        ct.c_int,
+        ct.c_int,
+        ct.c_int,
+    ]
+    res = _video_io.open_video_write(
+        str(filename).encode(), width, height, rate, method, clevel
+    )
+    if res < 0:
+        raise RuntimeError("cannot open output video file " + str(filename))
+    return res
+
+
+def set_video_write_threads(writer, threads, queue_size=0):
+    """
+    Compress images passed to image_write() with 'threads' worker threads
+    (threads <= 1 for synchronous writing).
+    """
+    if _video_io.set_video_write_threads(writer, threads, queue_size) < 0:
+        raise RuntimeError("An error occured while calling 'set_video_write_threads'")
+
+
+def image_write(writer, image, timestamp):
+    """
+    Write an image to given ZSTD video writer
+    """
+    _video_io.image_write.argtypes = [ct.c_int, ct.POINTER(ct.c_uint16), ct.c_longlong]
+    image = np.ascontiguousarray(image, dtype=np.uint16)
+    res = _video_io.image_write(
+        writer, image.ctypes.data_as(ct.POINTER(ct.c_uint16)), int(timestamp)
+    )
+    if res < 0:
+        raise RuntimeError("An error occured while calling 'image_write'")
+
+
+def close_video(writer):
+    """
+    Close ZSTD video writer and returns the file size
+    """
+    _video_io.close_video.restype = ct.c_int64
+    res = _video_io.close_video(writer)
+    if res < 0:
+        raise RuntimeError("An error occured while calling 'close_video'")
+    return res
+
+
 def correct_PCR_file(filename, width, height, frequency):
     """
     Attempt to correct an ill-formed PCR video file by rewriting the file header.
@@ -845,3 +1033,89 @@ def change_hcc_external_blackbody_temperature(filename: str, temperature: float)
     if tmp < 0:
         raise RuntimeError("An error occured while calling 'enable_motion_correction'")
     return tmp
+
+
+def hcc_header_columns(camera, names, first=0, count=None):
+    """
+    Extract numerical HCC frame header fields (like 'FWPosition', 'ExposureTime' or 'POSIXTime')
+    for 'count' frames starting at 'first', in one pass over the file.
+    Returns a dict of field name -> numpy array.
+    """
+    if isinstance(names, str):
+        names = [names]
+    if count is None:
+        count = get_image_count(camera) - first
+    _video_io.hcc_extract_header_columns.argtypes = [
+        ct.c_int,
+        ct.c_char_p,
+        ct.c_int,
+        ct.c_int,
+        ct.POINTER(ct.c_double),
+    ]
+    out = np.zeros((len(names), count), dtype=np.float64)
+    tmp = _video_io.hcc_extract_header_columns(
+        camera,
+        "\n".join(names).encode(),
+        first,
+        count,
+        out.ctypes.data_as(ct.POINTER(ct.c_double)),
+    )
+    if tmp < 0:
+        raise RuntimeError("An error occured while calling 'hcc_extract_header_columns'")
+    return {name: out[i] for i, name in enumerate(names)}
+
+
+def hcc_has_header_timestamps(camera):
+    """
+    Returns True if the timestamps of given HCC camera were read from the frame headers,
+    False if they were computed from the acquisition frame rate.
+    """
+    tmp = _video_io.hcc_has_header_timestamps(camera)
+    if tmp < 0:
+        raise RuntimeError("An error occured while calling 'hcc_has_header_timestamps'")
+    return tmp == 1
+
+
+def hcc_dropped_frame_count(camera):
+    """
+    Returns the total number of frames missing from given HCC camera file.
+    """
+    tmp = _video_io.hcc_dropped_frame_count(camera)
+    if tmp < 0:
+        raise RuntimeError("An error occured while calling 'hcc_dropped_frame_count'")
+    return tmp
+
+
+def hcc_frame_gaps(camera):
+    """
+    Returns the frame gaps of given HCC camera file as a list of (position, missing frame count) tuples,
+    position being the index of the first frame following the missing ones.
+    """
+    _video_io.hcc_frame_gaps.argtypes = [
+        ct.c_int,
+        ct.POINTER(ct.c_int),
+        ct.POINTER(ct.c_int),
+        ct.POINTER(ct.c_int),
+    ]
+    size = np.zeros((1), dtype=np.int32)
+    size[0] = 100
+    positions = np.zeros((size[0]), dtype=np.int32)
+    counts = np.zeros((size[0]), dtype=np.int32)
+    res = _video_io.hcc_frame_gaps(
+        camera,
+        positions.ctypes.data_as(ct.POINTER(ct.c_int)),
+        counts.ctypes.data_as(ct.POINTER(ct.c_int)),
+        size.ctypes.data_as(ct.POINTER(ct.c_int)),
+    )
+    if res == -2:
+        positions = np.zeros((size[0]), dtype=np.int32)
+        counts = np.zeros((size[0]), dtype=np.int32)
+        res = _video_io.hcc_frame_gaps(
+            camera,
+            positions.ctypes.data_as(ct.POINTER(ct.c_int)),
+            counts.ctypes.data_as(ct.POINTER(ct.c_int)),
+            size.ctypes.data_as(ct.POINTER(ct.c_int)),
+        )
+    if res < 0:
+        raise RuntimeError("An error occured while calling 'hcc_frame_gaps'")
+    return [(int(positions[i]), int(counts[i])) for i in range(size[0])]
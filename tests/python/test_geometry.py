@@ -16,3 +16,53 @@ def points():
 def test_count_pixel_in_polygon(points):
     area = count_pixel_in_polygon(points)
     assert area == 1640
+
+
+def test_polygon_index():
+    from librir.geometry.PolygonIndex import PolygonIndex
+
+    polygons = [
+        [(0, 0), (10, 0), (10, 10), (0, 10)],
+        [(20, 0), (30, 5), (20, 10)],
+        [(0, 20), (10, 20), (10, 30), (5, 25), (0, 30)],
+    ]
+    index = PolygonIndex(polygons)
+    points = [(5, 5), (22, 5), (29, 9), (1, 26), (5, 28), (-1, 5), (15, 15)]
+    assert list(index.find(points)) == [0, 1, -1, 2, -1, -1, -1]
+
+    assert list(index.overlapping([(8, 8), (22, 8), (22, 12), (8, 12)])) == [0, 1]
+    assert list(index.overlapping([(2, 2), (3, 2), (3, 3)])) == [0]
+    assert list(index.overlapping([(-5, -5), (40, -5), (40, 40), (-5, 40)])) == [0, 1, 2]
+    assert len(index.overlapping([(12, 12), (18, 12), (18, 18)])) == 0
+
+
+def _contains(polygon, x, y):
+    inside = False
+    j = len(polygon) - 1
+    for i in range(len(polygon)):
+        (xi, yi), (xj, yj) = polygon[i], polygon[j]
+        if (yi > y) != (yj > y) and x < xi + (y - yi) * (xj - xi) / (yj - yi):
+            inside = not inside
+        j = i
+    return inside
+
+
+def test_polygon_index_many_polygons():
+    import numpy as np
+    from librir.geometry.PolygonIndex import PolygonIndex
+
+    rng = np.random.default_rng(0)
+    polygons = []
+    for i, (x, y) in enumerate(rng.integers(0, 500, size=(300, 2)).tolist()):
+        if i % 2:
+            polygons.append([(x, y), (x + 8, y), (x + 8, y + 6), (x, y + 6)])
+        else:
+            polygons.append([(x, y), (x + 7, y + 3), (x + 1, y + 9)])
+    index = PolygonIndex(polygons)
+
+    points = rng.uniform(0, 510, size=(5000, 2))
+    expected = [
+        next((p for p, poly in enumerate(polygons) if _contains(poly, x, y)), -1)
+        for x, y in points
+    ]
+    assert list(index.find(points)) == expected
@@ -1,11 +1,40 @@
 import os
 from pathlib import Path
 from typing import Optional
+import numpy as np
 from librir.video_io import IRMovie
-from librir.video_io.rir_video_io import change_hcc_external_blackbody_temperature
+from librir.video_io.rir_video_io import (
+    change_hcc_external_blackbody_temperature,
+    hcc_header_columns,
+    hcc_dropped_frame_count,
+    hcc_frame_gaps,
+    hcc_has_header_timestamps,
+)
 import pytest
 
 
+def write_synthetic_hcc(filename, frame_ids, width=16, height=8, rate_mhz=50000):
+    """
+    Write a minimal HCC file: 256 bytes frame headers (signature, header length, FrameID,
+    image size, frame rate and POSIXTime/SubSecondTime) followed by 16 bits pixels.
+    """
+    with open(filename, "wb") as f:
+        for i, frame_id in enumerate(frame_ids):
+            header = bytearray(256)
+            header[0:2] = b"TC"
+            header[4:6] = np.uint16(256).tobytes()
+            header[8:12] = np.uint32(frame_id).tobytes()
+            header[32:34] = np.uint16(width).tobytes()
+            header[34:36] = np.uint16(height).tobytes()
+            header[44:48] = np.uint32(rate_mhz).tobytes()
+            # 100ns units, 20ms per frame at 50Hz
+            sub_second = (frame_id - frame_ids[0]) * 200000
+            header[100:104] = np.uint32(1700000000).tobytes()
+            header[104:108] = np.uint32(sub_second).tobytes()
+            f.write(bytes(header))
+            f.write(np.full((height, width), i, dtype=np.uint16).tobytes())
+
+
 @pytest.fixture
 def hcc_filename():
     p = os.environ.get("HCC_FILE_TEST", None)
@@ -23,6 +52,35 @@ def test_read_hcc_file(hcc_filename):
         mov.attributes
 
 
+def test_hcc_header_columns(hcc_filename):
+    if hcc_filename is None or not hcc_filename.exists():
+        pytest.skip("No HCC test file")
+    with IRMovie.from_filename(hcc_filename) as mov:
+        count = min(len(mov), 10)
+        cols = hcc_header_columns(mov.handle, ["FWPosition", "FrameID"], 0, count)
+        assert cols["FWPosition"].shape == (count,)
+        mov[count - 1]
+        assert cols["FrameID"][-1] == float(mov.frame_attributes["FrameID"])
+        with pytest.raises(RuntimeError):
+            hcc_header_columns(mov.handle, "NotAField")
+
+
+def test_hcc_dropped_frames(tmp_path):
+    filename = tmp_path / "gaps.hcc"
+    write_synthetic_hcc(filename, [10, 11, 12, 15, 16, 20])
+    with IRMovie.from_filename(filename) as mov:
+        assert len(mov) == 6
+        assert hcc_has_header_timestamps(mov.handle)
+        assert hcc_dropped_frame_count(mov.handle) == 5
+        assert hcc_frame_gaps(mov.handle) == [(3, 2), (5, 3)]
+
+    filename = tmp_path / "no_gap.hcc"
+    write_synthetic_hcc(filename, [0, 1, 2])
+    with IRMovie.from_filename(filename) as mov:
+        assert hcc_dropped_frame_count(mov.handle) == 0
+        assert hcc_frame_gaps(mov.handle) == []
+
+
 @pytest.mark.parametrize("temperature", [300])
 def test_change_hcc_external_blackbody_temperature(
     hcc_filename: Optional[Path], temperature
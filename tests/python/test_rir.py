@@ -3,6 +3,8 @@ import librir.geometry as ge
 from librir.low_level.misc import get_memory_folder, toArray, toCharP, toString
 import librir.signal_processing as sp
 import librir.signal_processing.BadPixels as bp
+from librir.signal_processing.HotSpotTracker import HotSpotTracker
+from librir.signal_processing.RoiStatistics import RoiStatistics
 from librir.signal_processing.rir_signal_processing import (
     bad_pixels_correct,
     keep_largest_area,
@@ -211,6 +213,24 @@ def test_translate(img):
         img = sp.translate(img, 1.2, 1.3, "constant", 0)
 
 
+def test_translate_specialized_kernel():
+    # unsigned short and float images use a specialized kernel, compare it with
+    # the generic implementation used for unsigned int and double images
+    rng = np.random.default_rng(0)
+    img = rng.integers(0, 60000, (37, 53))
+    # shifts exactly representable in float, so that both versions interpolate at the same positions
+    shifts = [(1.25, -0.5), (-2.75, 3.0), (0.0, 0.5), (3.0, -2.0), (-60.5, 1.5)]
+    for dx, dy in shifts:
+        for strategy in ("", "constant", "nearest"):
+            ref = sp.translate(img.astype(np.uint32), dx, dy, strategy, 7)
+            res = sp.translate(img.astype(np.uint16), dx, dy, strategy, 7)
+            npt.assert_array_equal(res, ref.astype(np.uint16))
+
+            ref = sp.translate(img.astype(np.float64), dx, dy, strategy, 7)
+            res = sp.translate(img.astype(np.float32), dx, dy, strategy, 7)
+            npt.assert_array_equal(res, ref.astype(np.float32))
+
+
 def test_gaussian_filter(img):
     # global img
     img = sp.gaussian_filter(img, 0.75)
@@ -218,6 +238,23 @@ def test_gaussian_filter(img):
         img = sp.gaussian_filter(np.ones(3), 0.75)
 
 
+def test_gaussian_filter_stack():
+    rng = np.random.default_rng(0)
+    stack = rng.uniform(0, 100, (3, 40, 50)).astype(np.float32)
+    res = sp.gaussian_filter(stack, 1.5)
+    assert res.shape == stack.shape
+    for i in range(stack.shape[0]):
+        npt.assert_allclose(res[i], sp.gaussian_filter(stack[i], 1.5), rtol=1e-5)
+
+    # constant images are left unchanged whatever the method
+    ones = np.ones((30, 30), dtype=np.float32)
+    for method in ("fir", "iir", "auto"):
+        npt.assert_allclose(sp.gaussian_filter(ones, 10, method), ones, rtol=1e-4)
+
+    with pytest.raises(RuntimeError):
+        sp.gaussian_filter(stack, 1.5, "unknown")
+
+
 def test_find_median_pixel():
     img = np.array(range(100), dtype=np.uint16)
     img.shape = (10, 10)
@@ -229,6 +266,33 @@ def test_find_median_pixel():
         img = sp.find_median_pixel(np.ones(3), 0.75)
 
 
+def test_find_quantiles():
+    rng = np.random.default_rng(0)
+    imgs = rng.integers(1000, 5000, (4, 32, 40)).astype(np.uint16)
+    mask = np.ones((32, 40), dtype=np.uint8)
+    mask[:, :10] = 0
+
+    q = sp.find_quantiles(imgs[0], [0.2, 0.5, 0.9])
+    assert q[1] == sp.find_median_pixel(imgs[0], 0.5)
+    assert q[0] == sp.find_median_pixel(imgs[0], 0.2)
+    assert q[2] == sp.find_median_pixel(imgs[0], 0.9)
+
+    # accumulation over several frames
+    q = sp.find_quantiles(imgs, [0.5, 0.1], mask=mask)
+    ref = np.sort(imgs[:, mask > 0].ravel())
+    assert q[0] == ref[int(round(ref.size * 0.5)) - 1]
+    assert q[1] == ref[int(round(ref.size * 0.1)) - 1]
+    with pytest.raises(RuntimeError):
+        sp.find_quantiles(np.ones(3), 0.5)
+
+    # bounds: 0 for a null quantile (as find_median_pixel always did), largest value above 1
+    q = sp.find_quantiles(imgs[0], [0.0, 1.0, 1.5])
+    assert q[0] == 0
+    assert q[1] == imgs[0].max()
+    assert q[2] == imgs[0].max()
+    assert sp.find_median_pixel(imgs[0], 0) == 0
+
+
 def test_extract_times():
     times1 = [0, 0.2, 1, 1.5, 2.3, 3.3, 4, 5]
     times2 = [-1, 3, 4, 4.3, 4.7]
@@ -272,6 +336,75 @@ def test_bad_pixels(img):
     del b
 
 
+def test_bad_pixels_from_stack(tmp_path):
+    rng = np.random.default_rng(0)
+    imgs = (3000 + rng.normal(0, 8, (16, 64, 80))).astype(np.uint16)
+    imgs[:, 10, 20] = 3000  # stuck
+    imgs[:, 30, 40] = 9000  # hot
+    imgs[::2, 50, 60] = 3300  # blinking
+    b = bp.BadPixels.from_stack(imgs)
+    coords = {tuple(c) for c in b.coordinates}
+    assert {(20, 10), (40, 30), (60, 50)} <= coords
+
+    filename = str(tmp_path / "camera.rirbadpixels")
+    b.save(filename)
+    b2 = bp.BadPixels.load(filename)
+    npt.assert_array_equal(b.coordinates, b2.coordinates)
+
+    out = b2.correct(imgs[0])
+    assert abs(int(out[30, 40]) - 3000) < 50
+
+
+def _bad_pixels_reference(img, coords):
+    # 3x3 window clipped to the image, including the bad pixel itself, upper median
+    h, w = img.shape
+    out = img.copy()
+    for x, y in coords:
+        window = img[max(0, y - 1) : y + 2, max(0, x - 1) : x + 2].ravel()
+        out[y, x] = np.sort(window)[window.size // 2]
+    return out
+
+
+def test_bad_pixels_correct_median(tmp_path):
+    rng = np.random.default_rng(1)
+    img = rng.integers(1000, 2000, (24, 32)).astype(np.uint16)
+    img[0, 0] = img[5, 7] = img[5, 8] = img[23, 31] = 60000
+    img[12, 0] = img[0, 15] = 50000
+    b = bp.BadPixels(img)
+    coords = [tuple(c) for c in b.coordinates]
+    assert {(0, 0), (7, 5), (8, 5), (31, 23)} <= set(coords)
+
+    # disable low value removal to compare with the plain median
+    b.set_low_value_threshold(-1)
+    npt.assert_array_equal(b.correct(img), _bad_pixels_reference(img, coords))
+
+    # the threshold is saved with the map
+    filename = str(tmp_path / "map.rirbadpixels")
+    b.save(filename)
+    b = bp.BadPixels.load(filename)
+    npt.assert_array_equal(b.correct(img), _bad_pixels_reference(img, coords))
+
+
+def test_bad_pixels_load_corrupted(tmp_path):
+    img = np.full((8, 8), 1000, dtype=np.uint16)
+    img[3, 3] = 60000
+    filename = str(tmp_path / "map.rirbadpixels")
+    bp.BadPixels(img).save(filename)
+    data = open(filename, "rb").read()
+
+    # truncated pixel list
+    open(filename, "wb").write(data[:-4])
+    with pytest.raises(RuntimeError):
+        bp.BadPixels.load(filename)
+
+    # more bad pixels than image pixels
+    header = np.frombuffer(data[8:24], dtype=np.int32).copy()
+    header[3] = 2**30
+    open(filename, "wb").write(data[:8] + header.tobytes() + data[24:])
+    with pytest.raises(RuntimeError):
+        bp.BadPixels.load(filename)
+
+
 def test_bad_pixels_correct_runtime_errors():
     with pytest.raises(RuntimeError):
         bad_pixels_correct(0, 0)
@@ -314,6 +447,70 @@ def test_label_image(img):
     sp.keep_largest_area(img)
 
 
+def test_label_image_stats():
+    img = np.zeros((20, 30), np.uint8)
+    img[2:5, 3:10] = 1
+    img[10:18, 20:22] = 1
+    values = np.arange(img.size, dtype=np.float32).reshape(img.shape)
+    labels, areas, bboxes, centroids, maxs = sp.label_image_stats(img, 0, values)
+    assert labels.max() == 2
+    npt.assert_array_equal(areas[1:], [21, 16])
+    npt.assert_array_equal(bboxes[1], [3, 2, 10, 5])
+    npt.assert_array_equal(bboxes[2], [20, 10, 22, 18])
+    npt.assert_allclose(centroids[1], [6, 3])
+    npt.assert_allclose(centroids[2], [20.5, 13.5])
+    npt.assert_allclose(maxs[1:], [values[4, 9], values[17, 21]])
+    npt.assert_array_equal(labels, sp.label_image(img)[0])
+
+
+def test_hot_spot_tracker():
+    tracker = HotSpotTracker(compute_polygons=True)
+    for i in range(10):
+        mask = np.zeros((48, 64), np.uint8)
+        mask[10:16, 5 + 2 * i : 12 + 2 * i] = 1
+        if i < 5:
+            mask[30:34, 40:44] = 1
+        tracker.add(mask, i * 0.1, values=mask * (100.0 + i))
+    assert len(tracker) == 2
+    moving, fixed = tracker.tracks
+    npt.assert_array_equal(moving["frames"], np.arange(10))
+    npt.assert_array_equal(moving["areas"], 42)
+    npt.assert_allclose(moving["max_values"], 100.0 + np.arange(10))
+    npt.assert_allclose(moving["centroids"][:, 0], 8 + 2 * np.arange(10))
+    assert len(fixed["frames"]) == 5
+    assert len(tracker.polygon(0, 0)) > 0
+
+
+def test_roi_statistics():
+    polygons = [
+        [[0, 0], [5, 0], [5, 5], [0, 5]],
+        [[10, 2], [18, 9], [3, 15]],
+    ]
+    images = np.random.randint(0, 1000, (4, 20, 30)).astype(np.uint16)
+    stats = RoiStatistics(30, 20, polygons).compute(images, 0.5)
+    assert stats.shape == (4, 2, 5)
+    for i, poly in enumerate(polygons):
+        mask = ge.draw_polygon(np.zeros((20, 30), np.uint8), poly, 1) > 0
+        for j, img in enumerate(images):
+            pixels = img[mask]
+            npt.assert_allclose(
+                stats[j, i, :4], [pixels.size, pixels.mean(), pixels.min(), pixels.max()]
+            )
+            # smallest value with at least round(n * 0.5) pixels below or equal
+            # (round half away from zero, as std::round)
+            k = int(np.floor(pixels.size * 0.5 + 0.5)) - 1
+            assert stats[j, i, 4] == np.sort(pixels)[k]
+
+    # same definition as find_median_pixel for small ROIs and percents close to 0
+    small = [[[2, 2], [3, 2], [3, 3], [2, 3]]]
+    mask = ge.draw_polygon(np.zeros((20, 30), np.uint8), small[0], 1) > 0
+    for percent in (0.0, 0.05, 0.3, 1.0):
+        stats = RoiStatistics(30, 20, small).compute(images, percent)
+        for j, img in enumerate(images):
+            pixels = np.ascontiguousarray(img[mask])
+            assert stats[j, 0, 4] == sp.find_median_pixel(pixels, percent)
+
+
 def test_ir_saver_movie():
     img0 = np.zeros((20, 20), dtype=np.int32)
     img1 = np.ones((20, 20), dtype=np.int32)
@@ -2,33 +2,53 @@ import os
 import shutil
 import tempfile
 import time
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 
 import numpy as np
 import numpy.testing as npt
 import pytest
 from librir.video_io import IRMovie, IRSaver
+from librir.video_io.IRMovie import create_pcr_header
 from librir.video_io.rir_video_io import (
     FileFormat,
+    bad_pixels_cache_enabled,
     calibrate_image,
     camera_saturate,
     close_camera,
+    close_video,
     correct_PCR_file,
+    enable_bad_pixels,
+    enable_bad_pixels_cache,
+    enable_timestamp_cache,
     get_emissivity,
     get_filename,
+    get_image_count,
+    get_h264_prefetch_size,
+    get_h264_read_threads,
     get_image_size,
     get_image_time,
     h264_add_loss,
     h264_close_file,
+    h264_flush,
     h264_open_file,
+    image_write,
     load_image,
+    load_imageF,
+    load_images,
+    open_camera_file,
     open_camera_memory,
+    open_video_write,
     set_emissivity,
     h264_get_high_errors,
     h264_get_low_errors,
     set_global_emissivity,
+    set_h264_prefetch_size,
+    set_h264_read_threads,
+    set_video_write_threads,
     support_emissivity,
     supported_calibrations,
+    timestamp_cache_enabled,
     video_file_format,
 )
 from tests.python.conftest import suppress_stdout_stderr
@@ -144,6 +164,73 @@ def test_record_movie_with_lossy_compression(images):
     print("Lossy compression factor is {}".format(float(theoric_size) / file_size))
 
 
+def test_record_movie_lossy_async(images):
+    temp_folder = Path(tempfile.gettempdir())
+    imgs = [np.ascontiguousarray(img[:64, :80]) for img in images[:20]]
+    files = []
+    errors = []
+    for queue in (0, 4):
+        filename = temp_folder / "lossy_async_{}.bin".format(queue)
+        s = IRSaver(filename, 80, 64)
+        s.set_parameter("asyncQueue", queue)
+        for i, img in enumerate(imgs):
+            s.add_image_lossy(img, i * 1000000)
+        s.flush()
+        errors.append((s.get_low_errors(), s.get_high_errors()))
+        s.close()
+        files.append(filename)
+
+    npt.assert_array_equal(errors[0][0], errors[1][0])
+    npt.assert_array_equal(errors[0][1], errors[1][1])
+    with IRMovie.from_filename(files[0]) as m0, IRMovie.from_filename(files[1]) as m1:
+        assert m0.images == m1.images == len(imgs)
+        for i in range(len(imgs)):
+            npt.assert_array_equal(m0.load_pos(i), m1.load_pos(i))
+    for f in files:
+        os.unlink(f)
+
+
+def test_record_movie_lossy_async_camera(tmp_path):
+    # DL images compressed through an input camera, which the caller keeps reading
+    rng = np.random.default_rng(23)
+    ramp = np.add.outer(np.arange(48), np.arange(64)) * 10 + 1200
+    frames = (ramp[None] + rng.integers(0, 10, (20, 48, 64))).astype(np.uint16)
+    pcr = tmp_path / "camera.pcr"
+    _write_pcr(pcr, frames, 100 + 20 * np.arange(len(frames)))
+
+    cam = open_camera_file(str(pcr))
+    try:
+        frames = load_images(cam, 0, len(frames), 1, 0)
+        files = []
+        errors = []
+        for queue in (0, 4):
+            filename = tmp_path / "camera_async_{}.h264".format(queue)
+            s = IRSaver(filename, 64, 48)
+            s.set_parameter("inputCamera", cam)
+            s.set_parameter("asyncQueue", queue)
+            for i, img in enumerate(frames):
+                s.add_image_lossy(img, i * 1000000)
+                # concurrent use of the input camera by the caller
+                load_image(cam, (i * 7) % len(frames), 0)
+            # get_low_errors()/get_high_errors() flush the pending images
+            errors.append((s.get_low_errors(), s.get_high_errors()))
+            assert len(errors[-1][0]) == len(errors[-1][1]) == len(frames)
+            s.close()
+            files.append(filename)
+    finally:
+        close_camera(cam)
+
+    npt.assert_array_equal(errors[0][0], errors[1][0])
+    npt.assert_array_equal(errors[0][1], errors[1][1])
+    with IRMovie.from_filename(files[0]) as m0, IRMovie.from_filename(files[1]) as m1:
+        assert m0.images == m1.images == len(frames)
+        for i in range(len(frames)):
+            npt.assert_array_equal(m0.load_pos(i), m1.load_pos(i))
+
+    with pytest.raises(RuntimeError):
+        h264_flush(0)
+
+
 def test_calibration_files(movie: IRMovie):
     movie.calibration_files
 
@@ -270,6 +357,410 @@ def test_load_image(movie: IRMovie):
         load_image(movie.handle, movie.images + 1, 0)
 
 
+def test_load_images(movie: IRMovie):
+    count = min(movie.images, 2)
+    imgs = load_images(movie.handle, 0, count, 1, 0)
+    for i in range(count):
+        npt.assert_array_equal(imgs[i], load_image(movie.handle, i, 0))
+    with pytest.raises(RuntimeError):
+        load_images(0, 0, 1, 1, 0)
+    with pytest.raises(RuntimeError):
+        load_images(movie.handle, movie.images - 1, 2, 1, 0)
+
+
+def test_load_imageF(movie: IRMovie, pcr_filename):
+    for pos in range(min(movie.images, 3)):
+        npt.assert_array_equal(
+            load_imageF(movie.handle, pos, 0), load_image(movie.handle, pos, 0)
+        )
+    with pytest.raises(RuntimeError):
+        load_imageF(0, 0, 0)
+    with pytest.raises(RuntimeError):
+        load_imageF(movie.handle, movie.images, 0)
+
+    # float bad pixels correction matches the integer one
+    with IRMovie.from_filename(pcr_filename) as mov:
+        mov.bad_pixels_correction = True
+        for pos in (0, mov.images - 1):
+            img = load_imageF(mov.handle, pos, 0)
+            assert img.dtype == np.float32
+            npt.assert_array_equal(img, load_image(mov.handle, pos, 0))
+
+
+@pytest.fixture(scope="module")
+def h264_frames():
+    rng = np.random.default_rng(3)
+    return rng.integers(0, 8192, (23, 48, 64)).astype(np.uint16)
+
+
+@pytest.fixture(scope="module")
+def h264_filename(h264_frames, tmp_path_factory):
+    # lossless video with several GOPs and an incomplete last one
+    filename = tmp_path_factory.mktemp("h264") / "gop.h264"
+    s = IRSaver(filename, 64, 48)
+    s.set_parameter("GOP", 4)
+    for i, img in enumerate(h264_frames):
+        s.add_image(img, i * 1000000)
+    s.close()
+    return filename
+
+
+def test_h264_prefetch(h264_frames, h264_filename):
+    previous = get_h264_prefetch_size()
+    try:
+        set_h264_prefetch_size(-1)
+        assert get_h264_prefetch_size() == 0
+        set_h264_prefetch_size(8)
+        assert get_h264_prefetch_size() == 8
+        n = len(h264_frames)
+        with IRMovie.from_filename(h264_filename) as mov:
+            # sequential, strided, backward, then sequential again
+            for order in (range(n), range(0, n, 3), range(n - 1, -1, -1), range(n)):
+                for pos in order:
+                    npt.assert_array_equal(
+                        load_image(mov.handle, pos, 0), h264_frames[pos]
+                    )
+    finally:
+        set_h264_prefetch_size(previous)
+
+
+def test_h264_read_threads(h264_frames, h264_filename):
+    previous = get_h264_read_threads()
+    try:
+        set_h264_read_threads(0)
+        assert get_h264_read_threads() == 1
+        set_h264_read_threads(4)
+        assert get_h264_read_threads() == 4
+        n = len(h264_frames)
+        with IRMovie.from_filename(h264_filename) as mov:
+            # whole video, strided ranges crossing GOPs, and the incomplete last GOP
+            npt.assert_array_equal(load_images(mov.handle, 0, n, 1, 0), h264_frames)
+            npt.assert_array_equal(
+                load_images(mov.handle, 1, 7, 3, 0), h264_frames[1:22:3]
+            )
+            npt.assert_array_equal(
+                load_images(mov.handle, 18, 5, 1, 0), h264_frames[18:23]
+            )
+            # single frame reads after parallel reads
+            npt.assert_array_equal(load_image(mov.handle, 5, 0), h264_frames[5])
+    finally:
+        set_h264_read_threads(previous)
+
+
+def test_h264_random_access(h264_frames, h264_filename):
+    n = len(h264_frames)
+    order = list(np.random.default_rng(5).permutation(n))
+    # key frames, last frames and repeated positions
+    order += [0, n - 1, n - 2, 4, 4, 3, 8, n - 1, 0]
+    with IRMovie.from_filename(h264_filename) as mov:
+        assert mov.images == n
+        for pos in order:
+            npt.assert_array_equal(load_image(mov.handle, int(pos), 0), h264_frames[pos])
+
+
+def test_h264_direct_output(h264_frames, h264_filename):
+    # decoded frames are written straight into the caller buffers
+    n = len(h264_frames)
+    cam = open_camera_file(str(h264_filename))
+    try:
+        for _ in range(2):
+            npt.assert_array_equal(load_images(cam, 0, n, 1, 0), h264_frames)
+        npt.assert_array_equal(load_images(cam, 1, 7, 3, 0), h264_frames[1:n:3])
+        first = load_image(cam, 0, 0)
+        # interleave integer, float and multi image reads
+        for pos in (5, 5, 0, n - 1, 6, 2):
+            img = load_image(cam, pos, 0)
+            npt.assert_array_equal(img, h264_frames[pos])
+            npt.assert_array_equal(load_imageF(cam, pos, 0), h264_frames[pos])
+            npt.assert_array_equal(load_images(cam, pos, 1, 1, 0)[0], img)
+        # previously returned arrays are not modified by later reads
+        npt.assert_array_equal(first, h264_frames[0])
+    finally:
+        close_camera(cam)
+
+
+def _write_pcr(filename, frames, times_ms=None):
+    """Write a PCR file, storing times_ms in the last 8 bytes of each image"""
+    frames = np.array(frames, dtype=np.uint16)
+    n, rows, columns = frames.shape
+    if times_ms is not None:
+        times = np.asarray(times_ms, dtype=np.int64)
+        frames.reshape(n, -1)[:, -4:] = times.view(np.uint16).reshape(n, 4)
+    with open(filename, "wb") as f:
+        f.write(create_pcr_header(rows, columns).tobytes())
+        f.write(frames.tobytes())
+
+
+def test_pcr_mapped_reads(tmp_path):
+    # several pages per frame, frames not aligned on page boundaries
+    frames = np.random.default_rng(13).integers(0, 65536, (30, 61, 83), dtype=np.uint16)
+    # valid timestamps (ms) in the last 8 bytes of each image
+    times = (100 + 20 * np.arange(30)).astype(np.int64)
+    frames.reshape(30, -1)[:, -4:] = times.view(np.uint16).reshape(30, 4)
+    filename = tmp_path / "mapped.pcr"
+    _write_pcr(filename, frames)
+
+    cam = open_camera_file(str(filename))
+    try:
+        assert get_image_count(cam) == len(frames)
+        npt.assert_array_equal(load_images(cam, 0, len(frames), 1, 0), frames)
+        npt.assert_array_equal(load_images(cam, 3, 9, 3, 0), frames[3:30:3])
+        # backward and random single image reads
+        order = list(range(len(frames) - 1, -1, -1))
+        order += list(np.random.default_rng(14).permutation(len(frames)))
+        for i in order:
+            npt.assert_array_equal(load_image(cam, int(i), 0), frames[i])
+    finally:
+        close_camera(cam)
+
+
+def _read_corrected(filename):
+    cam = open_camera_file(str(filename))
+    try:
+        enable_bad_pixels(cam, True)
+        return load_images(cam, 0, get_image_count(cam), 1, 0)
+    finally:
+        close_camera(cam)
+
+
+def test_bad_pixels_cache(tmp_path):
+    rng = np.random.default_rng(29)
+    frames = 2000 + rng.integers(0, 20, (10, 40, 48))
+    frames[:, 12, 17] = 0  # dead pixel
+    frames[:, 25, 30] = 8000  # hot pixel
+    filename = tmp_path / "bad_pixels.pcr"
+    cache = Path(str(filename) + ".rirbadpixels")
+    _write_pcr(filename, frames, 100 + 20 * np.arange(10))
+
+    previous = bad_pixels_cache_enabled()
+    try:
+        enable_bad_pixels_cache(False)
+        expected = _read_corrected(filename)
+        assert not cache.exists()
+        assert expected[0, 12, 17] > 1900 and expected[0, 25, 30] < 2100
+
+        enable_bad_pixels_cache(True)
+        assert bad_pixels_cache_enabled()
+        npt.assert_array_equal(_read_corrected(filename), expected)
+        assert cache.exists()
+        # second opening uses the cache
+        npt.assert_array_equal(_read_corrected(filename), expected)
+
+        # a corrupted cache is ignored
+        cache.write_bytes(cache.read_bytes()[:30])
+        npt.assert_array_equal(_read_corrected(filename), expected)
+    finally:
+        enable_bad_pixels_cache(previous)
+
+
+def _read_times(filename):
+    cam = open_camera_file(str(filename))
+    try:
+        return np.array([get_image_time(cam, i) for i in range(get_image_count(cam))])
+    finally:
+        close_camera(cam)
+
+
+def test_timestamp_cache(tmp_path):
+    frames = np.random.default_rng(7).integers(0, 4000, (12, 16, 24))
+    filename = tmp_path / "times.pcr"
+    cache = Path(str(filename) + ".rirtimes")
+    _write_pcr(filename, frames, 100 + 20 * np.arange(12))
+    expected = 20000000 * np.arange(12)
+
+    previous = timestamp_cache_enabled()
+    try:
+        enable_timestamp_cache(False)
+        npt.assert_array_equal(_read_times(filename), expected)
+        assert not cache.exists()
+
+        enable_timestamp_cache(True)
+        assert timestamp_cache_enabled()
+        npt.assert_array_equal(_read_times(filename), expected)
+        assert cache.exists()
+        npt.assert_array_equal(_read_times(filename), expected)
+
+        # same size and modification time: timestamps come from the cache
+        st = os.stat(filename)
+        _write_pcr(filename, frames, 100 + 40 * np.arange(12))
+        os.utime(filename, ns=(st.st_atime_ns, st.st_mtime_ns))
+        npt.assert_array_equal(_read_times(filename), expected)
+
+        # the file was modified: the cache is rebuilt
+        os.utime(filename, ns=(st.st_atime_ns, st.st_mtime_ns + 5 * 10**9))
+        npt.assert_array_equal(_read_times(filename), 2 * expected)
+    finally:
+        enable_timestamp_cache(previous)
+
+
+@pytest.fixture(scope="module")
+def zfile_frames():
+    # smooth images with noise, as IR images
+    rng = np.random.default_rng(11)
+    ramp = np.add.outer(np.arange(40), np.arange(56)) * 20 + 1000
+    return (ramp[None] + rng.integers(0, 16, (9, 40, 56))).astype(np.uint16)
+
+
+def _write_zfile(filename, frames, method=1, threads=0):
+    try:
+        writer = open_video_write(filename, frames.shape[2], frames.shape[1], 50, method)
+    except RuntimeError:
+        if method == 1:
+            pytest.skip("librir built without USE_ZFILE")
+        raise
+    if threads > 1:
+        set_video_write_threads(writer, threads, 3)
+    for i, img in enumerate(frames):
+        image_write(writer, img, i * 20000000)
+    return close_video(writer)
+
+
+def _read_zfile(filename):
+    cam = open_camera_file(str(filename))
+    try:
+        return load_images(cam, 0, get_image_count(cam), 1, 0)
+    finally:
+        close_camera(cam)
+
+
+def test_zfile_async_writer(zfile_frames, tmp_path):
+    sizes = []
+    for threads in (0, 4):
+        filename = tmp_path / "async_{}.z".format(threads)
+        sizes.append(_write_zfile(filename, zfile_frames, threads=threads))
+        assert sizes[-1] == os.stat(filename).st_size
+        npt.assert_array_equal(_read_zfile(filename), zfile_frames)
+    # same on-disk layout and payloads
+    assert sizes[0] == sizes[1]
+
+
+@pytest.mark.parametrize("method", [1, 4, 5])
+def test_zfile_methods(zfile_frames, tmp_path, method):
+    # method 1 is probed first so that the test skips without USE_ZFILE
+    _write_zfile(tmp_path / "probe.z", zfile_frames[:1])
+    filename = tmp_path / "method_{}.z".format(method)
+    size = _write_zfile(filename, zfile_frames, method=method)
+    assert 0 < size < zfile_frames.nbytes
+    npt.assert_array_equal(_read_zfile(filename), zfile_frames)
+
+
+@pytest.mark.parametrize("method", [2, 3])
+def test_zfile_unsupported_methods(zfile_frames, tmp_path, method):
+    _write_zfile(tmp_path / "probe.z", zfile_frames[:1])
+    with pytest.raises(RuntimeError):
+        _write_zfile(tmp_path / "method_{}.z".format(method), zfile_frames, method)
+
+
+def test_zfile_memory_reads(zfile_frames, tmp_path):
+    filename = tmp_path / "memory.z"
+    _write_zfile(filename, zfile_frames, method=5)
+    data = filename.read_bytes()
+    cam = open_camera_memory(data)
+    try:
+        # random order reads use the same decompression context
+        order = np.random.default_rng(5).permutation(len(zfile_frames))
+        for i in list(order) + list(order[::-1]):
+            npt.assert_array_equal(load_image(cam, int(i), 0), zfile_frames[i])
+
+        # concurrent reads of different frames from the same handle
+        def read(i):
+            return load_image(cam, i % len(zfile_frames), 0)
+
+        with ThreadPoolExecutor(4) as pool:
+            res = list(pool.map(read, range(4 * len(zfile_frames))))
+        for i, img in enumerate(res):
+            npt.assert_array_equal(img, zfile_frames[i % len(zfile_frames)])
+    finally:
+        close_camera(cam)
+    npt.assert_array_equal(_read_zfile(filename), zfile_frames)
+
+
+def _lossy_roundtrip(filename, frames, **params):
+    """Compress frames with the lossy algorithm, returns decoded frames, low and high errors"""
+    s = IRSaver(filename, frames.shape[2], frames.shape[1])
+    for k, v in params.items():
+        s.set_parameter(k, v)
+    for i, img in enumerate(frames):
+        s.add_image_lossy(img, i * 1000000)
+    s.flush()
+    low, high = s.get_low_errors(), s.get_high_errors()
+    s.close()
+    cam = open_camera_file(str(filename))
+    try:
+        return load_images(cam, 0, get_image_count(cam), 1, 0), low, high
+    finally:
+        close_camera(cam)
+
+
+@pytest.mark.parametrize("window", [-5, 0, 1, 4, 1000])
+def test_h264_lossy_running_average(tmp_path, window):
+    # uniform frames alternating between 1000 and 1001, always within the error
+    values = 1000 + np.arange(12) % 2
+    frames = np.broadcast_to(values[:, None, None], (12, 32, 40)).astype(np.uint16)
+    decoded, low, high = _lossy_roundtrip(
+        tmp_path / "average.h264",
+        frames,
+        lowValueError=1,
+        highValueError=1,
+        stdFactor=0,
+        runningAverage=window,
+    )
+    npt.assert_array_equal(low, 1)
+    npt.assert_array_equal(high, 1)
+
+    # window clamped to [0, 64]; frame 0 is stored as is and starts the reference
+    window = min(max(window, 0), 64)
+    expected = [values[0]]
+    for k in range(1, len(values)):
+        if window == 0:
+            expected.append(values[0])
+        else:
+            w = values[max(1, k - window + 1) : k + 1]
+            expected.append(w.sum() // len(w))
+    expected = np.array(expected, dtype=np.uint16)[:, None, None]
+    npt.assert_array_equal(decoded, np.broadcast_to(expected, frames.shape))
+
+
+def test_h264_lossy_error_bounds(tmp_path):
+    # noisy background with a moving hot spot
+    rng = np.random.default_rng(17)
+    frames = 1500 + rng.integers(0, 12, (16, 48, 72))
+    for i, img in enumerate(frames):
+        img[10:30, 2 + 3 * i : 22 + 3 * i] += 2000
+    frames = frames.astype(np.uint16)
+    decoded, low, high = _lossy_roundtrip(
+        tmp_path / "bounds.h264",
+        frames,
+        lowValueError=6,
+        highValueError=3,
+        runningAverage=0,
+    )
+    assert len(low) == len(high) == len(frames)
+    assert np.all(high <= low)
+    assert np.all(low <= 6) and np.all(high <= 3)
+    # first image is lossless, then every pixel stays within the frame error
+    npt.assert_array_equal(decoded[0], frames[0])
+    diff = np.abs(decoded.astype(int) - frames.astype(int))
+    assert np.all(diff.reshape(len(frames), -1).max(axis=1) <= low)
+
+
+@pytest.mark.parametrize("shape", [(40, 72), (30, 50)])
+def test_h264_lossless_full_range(tmp_path, shape):
+    # widths not multiple of the SIMD packing size, values using both bytes
+    frames = np.random.default_rng(19).integers(0, 65536, (6,) + shape, dtype=np.uint16)
+    frames[0, 0, :4] = [0, 255, 256, 65535]
+    filename = tmp_path / "full_range.h264"
+    s = IRSaver(filename, shape[1], shape[0])
+    for i, img in enumerate(frames):
+        s.add_image(img, i * 1000000)
+    s.close()
+    cam = open_camera_file(str(filename))
+    try:
+        npt.assert_array_equal(load_images(cam, 0, len(frames), 1, 0), frames)
+    finally:
+        close_camera(cam)
+
+
 # def test_h264_add_loss(movie: IRMovie):
 #     with tempfile.NamedTemporaryFile(delete=False) as f:
 #         pass